@@ -0,0 +1,170 @@
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "batch.h"
+#include "disassembler.h"
+#include "output.h"
+
+/**
+* The jobs a worker starts with. The owner takes jobs from the front; idle workers steal from
+* the back, so neighbouring files tend to stay on one thread.
+*/
+class WorkQueue {
+public:
+    void push(size_t job){
+        m_jobs.push_back(job);
+    }
+
+    bool pop(size_t& job){
+        std::lock_guard<std::mutex> lock(m_lock);
+        if(m_jobs.empty()){
+            return false;
+        }
+        job = m_jobs.front();
+        m_jobs.pop_front();
+        return true;
+    }
+
+    bool steal(size_t& job){
+        std::lock_guard<std::mutex> lock(m_lock);
+        if(m_jobs.empty()){
+            return false;
+        }
+        job = m_jobs.back();
+        m_jobs.pop_back();
+        return true;
+    }
+
+private:
+    std::mutex m_lock;
+    std::deque<size_t> m_jobs;
+};
+
+
+/**
+* Reads a batch manifest. Each line names an object file, its symbol file and optionally the
+* output file; blank lines and lines starting with # are skipped.
+* @param path: The manifest, or "-" for stdin.
+* @param jobs: The jobs are appended here.
+* @param error: Receives a description of the failure, if any.
+* @return False if the manifest cannot be read or a line is malformed.
+*/
+bool read_manifest(const std::string& path, std::vector<BatchJob>& jobs, std::string& error){
+    InputFile input;
+    if(!input.open(path, error)){
+        return false;
+    }
+    LineReader lines(input.text());
+    std::string_view line;
+    std::string_view tokens[4];
+    while(lines.next(line)){
+        int count = split_tokens(line, tokens, 4);
+        if(count == 0 || tokens[0][0] == '#'){
+            continue;
+        }
+        if(count < 2 || count > 3){
+            error = path + ": line " + std::to_string(lines.line_number()) +
+                    ": expected an object file, a symbol file and an optional output file";
+            return false;
+        }
+        jobs.push_back(BatchJob{std::string(tokens[0]), std::string(tokens[1]),
+                                count == 3 ? std::string(tokens[2]) : std::string()});
+    }
+    return true;
+}
+
+
+/**
+* Disassembles every job on a pool of worker threads. Each worker owns one Disassembler, whose
+* buffers are reused from file to file, and writes each listing to its own file. Jobs are dealt
+* out round-robin and idle workers steal from the others. Failures are reported on stderr in job
+* order once all jobs are done.
+* @param jobs: The object and symbol files to disassemble.
+* @param output: The output format shared by all jobs.
+* @param threads: The number of workers; 0 uses one per hardware thread.
+* @param stats: If not null, receives the statistics of all jobs added together.
+* @param cacheDir: Directory of cached object images, or empty for none.
+* @return True if every listing was written.
+*/
+bool run_batch(const std::vector<BatchJob>& jobs, const OutputOptions& output, int threads,
+               RunStats* stats, const std::string& cacheDir){
+    if(threads <= 0){
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max(1, std::min(threads, int(jobs.size())));
+
+    std::vector<WorkQueue> queues(threads);
+    for(size_t i = 0; i < jobs.size(); i++){
+        queues[i % threads].push(i);
+    }
+    std::vector<std::string> errors(jobs.size());
+    std::vector<std::string> warnings(jobs.size());
+    std::vector<RunStats> workerStats(threads);
+
+    auto worker = [&](int self){
+        Disassembler disassembler;
+        disassembler.set_cache(cacheDir);
+        OutputOptions options = output;
+        size_t job;
+        while(true){
+            bool found = queues[self].pop(job);
+            for(int i = 1; !found && i < threads; i++){
+                found = queues[(self + i) % threads].steal(job);
+            }
+            if(!found){                                             // No job is ever added, so every queue
+                return;                                             // being empty means the batch is done.
+            }
+            options.path = jobs[job].outFile.empty() ? batch_output_path(jobs[job].objFile, output.format)
+                                                     : jobs[job].outFile;
+            if(!disassembler.run(jobs[job].objFile, jobs[job].symFile, options, errors[job]) && errors[job].empty()){
+                errors[job] = jobs[job].objFile + ": failed";
+            }
+            else if(errors[job].empty() && !disassembler.warning().empty()){
+                warnings[job] = jobs[job].objFile + ": " + disassembler.warning();
+            }
+            workerStats[self].add(disassembler.stats());
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for(int i = 1; i < threads; i++){
+        pool.emplace_back(worker, i);
+    }
+    worker(0);
+    for(std::thread& thread : pool){
+        thread.join();
+    }
+
+    if(stats){
+        stats->clear();
+        for(const RunStats& worker : workerStats){
+            stats->add(worker);
+        }
+    }
+    for(const std::string& warning : warnings){
+        if(!warning.empty()){
+            std::cerr << "WARNING: " << warning << "." << std::endl;
+        }
+    }
+    bool ok = true;
+    for(const std::string& error : errors){
+        if(!error.empty()){
+            std::cerr << "ERROR: " << error << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+
+/**
+* @param objFile: The object file of a batch job.
+* @param format: The OutputFormat.
+* @return The object file's path with its extension replaced by the format's.
+*/
+std::string batch_output_path(const std::string& objFile, uint8_t format){
+    size_t slash = objFile.rfind('/');
+    size_t dot = objFile.rfind('.');
+    size_t stem = dot != std::string::npos && (slash == std::string::npos || dot > slash) ? dot : objFile.size();
+    return objFile.substr(0, stem) + "." + output_extension(format);
+}
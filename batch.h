@@ -0,0 +1,22 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct OutputOptions;
+struct RunStats;
+
+struct BatchJob {
+    std::string objFile;
+    std::string symFile;
+    std::string outFile;            // Empty for the object file's name with the format's extension.
+};
+
+bool read_manifest(const std::string& path, std::vector<BatchJob>& jobs, std::string& error);
+bool run_batch(const std::vector<BatchJob>& jobs, const OutputOptions& output, int threads,
+               RunStats* stats = nullptr, const std::string& cacheDir = std::string());
+std::string batch_output_path(const std::string& objFile, uint8_t format);
+
+#endif
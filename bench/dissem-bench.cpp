@@ -0,0 +1,677 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "../disassembler.h"
+#include "../output.h"
+
+#if !DISSEM_STATS
+#error "dissem-bench reads the phase timers, which are compiled out with DISSEM_STATS=0"
+#endif
+
+const char* const DEFAULT_BASELINE = "bench/baseline.json";
+const int DEFAULT_RUNS = 5;
+const double DEFAULT_THRESHOLD = 5;             // Percent a median has to worsen by to count as a regression.
+const double SIGNIFICANCE = 0.01;               // Largest p-value of a regression.
+const double MIN_DELTA_MS = 0.05;               // Smaller changes of a phase are timer noise.
+const double MIN_DELTA_ALLOCS = 0.0001;         // Likewise for allocations per instruction.
+
+enum BenchMetric {                              // The phases come first, numbered as StatPhase.
+    METRIC_TOTAL = PHASE_COUNT,                 // Every phase added up.
+    METRIC_RATE,                                // Instructions per second.
+    METRIC_COUNT
+};
+
+/**
+* A named set of object and symbol file pairs, timed together as one workload.
+*/
+struct Workload {
+    std::string name;
+    std::vector<std::string> files;
+};
+
+/**
+* What the runs of one workload measured: every run's time in each phase (ms), in total, and
+* instructions per second, plus the heap allocations per instruction of the first, cold run.
+*/
+struct WorkloadResult {
+    Workload workload;
+    uint64_t instructions = 0;
+    double allocsPerInstr = 0;
+    std::vector<double> samples[METRIC_COUNT];
+};
+
+/**
+* Just enough of a JSON value to read a baseline back.
+*/
+struct JsonValue {
+    enum Type {
+        JSON_NULL,
+        JSON_NUMBER,
+        JSON_STRING,
+        JSON_ARRAY,
+        JSON_OBJECT
+    };
+
+    Type type = JSON_NULL;
+    double number = 0;
+    std::string text;
+    std::vector<JsonValue> items;                           // Of an array, or the values of an object,
+    std::vector<std::string> keys;                          // whose keys are here.
+
+    const JsonValue* get(const std::string& key) const;
+};
+
+bool run_workload(const Workload& workload, int runs, int threads, WorkloadResult& result, std::string& error);
+bool write_baseline(const std::string& path, const std::vector<WorkloadResult>& results, int runs, int threads,
+                    std::string& error);
+bool read_baseline(const std::string& path, std::vector<WorkloadResult>& results, int& runs, int& threads,
+                   std::string& error);
+bool compare_results(const std::vector<WorkloadResult>& baseline, const std::vector<WorkloadResult>& current,
+                     double threshold);
+bool parse_workload(const std::string& spec, Workload& workload);
+void print_usage();
+
+static std::atomic<uint64_t> g_heapAllocations(0);
+
+/**
+* Every heap allocation of the process is counted here, as in phasebench, so allocations per
+* instruction can be compared between builds.
+*/
+void* operator new(size_t size){
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if(!p){
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+
+/**
+* Benchmark driver that keeps a baseline and checks later builds against it.
+* ./dissem-bench record [-o BASELINE] [--runs N] [-j THREADS] [WORKLOAD ...]
+*   runs every workload N times and writes the median and spread of each phase's time, the
+*   instructions per second and the allocations per instruction, with every sample, as JSON.
+* ./dissem-bench compare [BASELINE] [--runs N] [-j THREADS] [--threshold PERCENT] [WORKLOAD ...]
+*   runs the baseline's workloads again (or the ones given) and fails if any of them regressed.
+* A WORKLOAD is NAME=a.obj,a.sym[,b.obj,b.sym...]; the default is the make bench corpus.
+*/
+int main(int argc, char** argv){
+    if(argc < 2 || (std::string(argv[1]) != "record" && std::string(argv[1]) != "compare")){
+        print_usage();
+        return 1;
+    }
+    bool record = std::string(argv[1]) == "record";
+    std::string path;
+    int runs = 0;
+    int threads = 0;
+    double threshold = DEFAULT_THRESHOLD;
+    std::vector<Workload> workloads;
+    for(int i = 2; i < argc; i++){
+        std::string arg = argv[i];
+        Workload workload;
+        if(arg == "-o" && record && i + 1 < argc){
+            path = argv[++i];
+        }
+        else if(arg == "--runs" && i + 1 < argc){
+            runs = std::max(2, std::atoi(argv[++i]));
+        }
+        else if(arg == "-j" && i + 1 < argc){
+            threads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if(arg == "--threshold" && !record && i + 1 < argc){
+            threshold = std::atof(argv[++i]);
+        }
+        else if(parse_workload(arg, workload)){
+            workloads.push_back(workload);
+        }
+        else if(!record && path.empty() && arg[0] != '-'){
+            path = arg;
+        }
+        else{
+            print_usage();
+            return 1;
+        }
+    }
+    if(path.empty()){
+        path = DEFAULT_BASELINE;
+    }
+
+    std::string error;
+    std::vector<WorkloadResult> baseline;
+    if(!record){                                            // Same corpus, runs and threads unless overridden.
+        int baseRuns;
+        int baseThreads;
+        if(!read_baseline(path, baseline, baseRuns, baseThreads, error)){
+            std::cerr << "ERROR: " << path << ": " << error << std::endl;
+            return 1;
+        }
+        runs = runs ? runs : baseRuns;
+        threads = threads ? threads : baseThreads;
+        if(workloads.empty()){
+            for(const WorkloadResult& result : baseline){
+                workloads.push_back(result.workload);
+            }
+        }
+    }
+    runs = runs ? runs : DEFAULT_RUNS;
+    threads = threads ? threads : 1;
+    if(workloads.empty()){
+        workloads.push_back(Workload{"1K", {"bench/data/w1k.obj", "bench/data/w1k.sym"}});
+        workloads.push_back(Workload{"100K", {"bench/data/w100k.obj", "bench/data/w100k.sym"}});
+        Workload large{"10M", {}};
+        for(int n = 1; n <= 4; n++){
+            large.files.push_back("bench/data/w10m-" + std::to_string(n) + ".obj");
+            large.files.push_back("bench/data/w10m-" + std::to_string(n) + ".sym");
+        }
+        workloads.push_back(large);
+    }
+
+    std::vector<WorkloadResult> results(workloads.size());
+    for(size_t w = 0; w < workloads.size(); w++){
+        if(!run_workload(workloads[w], runs, threads, results[w], error)){
+            std::cerr << "ERROR: " << workloads[w].name << ": " << error << std::endl;
+            return 1;
+        }
+        const WorkloadResult& result = results[w];
+        std::vector<double> rates = result.samples[METRIC_RATE];
+        std::nth_element(rates.begin(), rates.begin() + rates.size() / 2, rates.end());
+        std::cerr << workloads[w].name << ": " << runs << " runs, " << std::fixed << std::setprecision(2)
+                  << rates[rates.size() / 2] / 1e6 << " M instr/s" << std::endl;
+    }
+
+    if(record){
+        if(!write_baseline(path, results, runs, threads, error)){
+            std::cerr << "ERROR: " << error << std::endl;
+            return 1;
+        }
+        std::cerr << "Baseline written to " << path << "." << std::endl;
+        return 0;
+    }
+    return compare_results(baseline, results, threshold) ? 0 : 1;
+}
+
+
+/**
+* Prints how the driver is run.
+*/
+void print_usage(){
+    std::cerr << "usage: dissem-bench record [-o BASELINE] [--runs N] [-j THREADS] [WORKLOAD ...]" << std::endl;
+    std::cerr << "       dissem-bench compare [BASELINE] [--runs N] [-j THREADS] [--threshold PERCENT] [WORKLOAD ...]"
+              << std::endl;
+    std::cerr << "BASELINE defaults to " << DEFAULT_BASELINE << "; a WORKLOAD is NAME=a.obj,a.sym[,b.obj,b.sym...]."
+              << std::endl;
+}
+
+
+/**
+* @param spec: NAME=a.obj,a.sym[,b.obj,b.sym...].
+* @param workload: Receives the name and files.
+* @return False if spec is not a workload.
+*/
+bool parse_workload(const std::string& spec, Workload& workload){
+    size_t equals = spec.find('=');
+    if(equals == 0 || equals == std::string::npos){
+        return false;
+    }
+    workload.name = spec.substr(0, equals);
+    workload.files.clear();
+    for(size_t start = equals + 1; start <= spec.size();){
+        size_t comma = std::min(spec.find(',', start), spec.size());
+        workload.files.push_back(spec.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return workload.files.size() % 2 == 0;
+}
+
+
+/**
+* @param metric: The BenchMetric.
+* @return Its name in the baseline.
+*/
+static std::string metric_name(int metric){
+    return metric < PHASE_COUNT ? phase_name(metric) : metric == METRIC_TOTAL ? "total" : "instr_per_sec";
+}
+
+
+/**
+* @param values: Samples of a metric.
+* @return Their median.
+*/
+static double median(std::vector<double> values){
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n == 0 ? 0 : n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+
+/**
+* @param values: Samples of a metric.
+* @return Their median absolute deviation from the median, which outliers barely move.
+*/
+static double spread(const std::vector<double>& values){
+    double middle = median(values);
+    std::vector<double> deviations;
+    for(double value : values){
+        deviations.push_back(std::fabs(value - middle));
+    }
+    return median(deviations);
+}
+
+
+/**
+* One-sided Mann-Whitney U test, which assumes nothing about how run times are distributed:
+* the normal approximation with mid-ranks for ties and a continuity correction.
+* @param higher: The samples suspected of being larger.
+* @param lower: The samples to compare them with.
+* @return The p-value of the samples in higher being no larger than those in lower.
+*/
+static double p_larger(const std::vector<double>& higher, const std::vector<double>& lower){
+    std::vector<std::pair<double, int>> all;                // Value, and 1 if it comes from higher.
+    for(double value : higher){
+        all.push_back({value, 1});
+    }
+    for(double value : lower){
+        all.push_back({value, 0});
+    }
+    std::sort(all.begin(), all.end());
+    double n1 = higher.size();
+    double n2 = lower.size();
+    double n = n1 + n2;
+    double rankSum = 0;
+    double ties = 0;                                        // Sum of t^3 - t over groups of t equal values.
+    for(size_t i = 0; i < all.size();){
+        size_t j = i;
+        while(j < all.size() && all[j].first == all[i].first){
+            j++;
+        }
+        double rank = (i + 1 + j) / 2.0;
+        for(size_t k = i; k < j; k++){
+            rankSum += all[k].second * rank;
+        }
+        double t = j - i;
+        ties += t * t * t - t;
+        i = j;
+    }
+    double u = rankSum - n1 * (n1 + 1) / 2;
+    double variance = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+    if(n1 == 0 || n2 == 0 || variance <= 0){
+        return 1;
+    }
+    double z = (u - n1 * n2 / 2 - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+
+/**
+* Runs a workload: one cold pass to count allocations and warm up the caches, then the timed runs,
+* all on one Disassembler as a long-lived caller would use it.
+* @param workload: The files to disassemble; the listings go to /dev/null.
+* @param runs: The timed runs.
+* @param threads: Threads decoding each program.
+* @param result: Receives the samples.
+* @param error: Receives a description of the failure, if any.
+* @return True if every run succeeded.
+*/
+bool run_workload(const Workload& workload, int runs, int threads, WorkloadResult& result, std::string& error){
+    result = WorkloadResult();
+    result.workload = workload;
+    Disassembler disassembler(threads);
+    OutputOptions output;
+    output.path = "/dev/null";
+    for(int r = -1; r < runs; r++){
+        RunStats total;
+        uint64_t heapBefore = g_heapAllocations.load();
+        for(size_t i = 0; i + 1 < workload.files.size(); i += 2){
+            if(!disassembler.run(workload.files[i], workload.files[i + 1], output, error)){
+                return false;
+            }
+            total.add(disassembler.stats());
+        }
+        if(r < 0){
+            result.instructions = total.instructions();
+            result.allocsPerInstr = double(g_heapAllocations.load() - heapBefore) /
+                                    std::max<uint64_t>(1, result.instructions);
+            continue;
+        }
+        for(int p = 0; p < PHASE_COUNT; p++){
+            result.samples[p].push_back(total.seconds[p] * 1e3);
+        }
+        result.samples[METRIC_TOTAL].push_back(total.total_seconds() * 1e3);
+        result.samples[METRIC_RATE].push_back(total.instructions() / std::max(1e-9, total.total_seconds()));
+    }
+    return true;
+}
+
+
+/**
+* Writes the results as a baseline: for each workload its files and, for each metric, the
+* median, the spread (median absolute deviation) and every sample.
+* @param path: The baseline file.
+* @param results: The workloads' results.
+* @param runs: The runs of each workload.
+* @param threads: The threads decoding each program.
+* @param error: Receives a description of the failure, if any.
+* @return True if the file was written.
+*/
+bool write_baseline(const std::string& path, const std::vector<WorkloadResult>& results, int runs, int threads,
+                    std::string& error){
+    std::ofstream out(path);
+    if(!out){
+        error = "cannot create " + path;
+        return false;
+    }
+    out << std::setprecision(9);
+    out << "{\n  \"version\": 1,\n  \"runs\": " << runs << ",\n  \"threads\": " << threads << ",\n  \"workloads\": [";
+    for(size_t w = 0; w < results.size(); w++){
+        const WorkloadResult& result = results[w];
+        out << (w ? "," : "") << "\n    {\n      \"name\": \"" << result.workload.name << "\",\n      \"files\": [";
+        for(size_t f = 0; f < result.workload.files.size(); f++){
+            out << (f ? ", " : "") << '"' << result.workload.files[f] << '"';
+        }
+        out << "],\n      \"instructions\": " << result.instructions << ",\n      \"allocs_per_instr\": "
+            << result.allocsPerInstr << ",\n      \"metrics\": {";
+        for(int m = 0; m < METRIC_COUNT; m++){
+            const std::vector<double>& samples = result.samples[m];
+            out << (m ? "," : "") << "\n        \"" << metric_name(m) << "\": {\"median\": " << median(samples)
+                << ", \"spread\": " << spread(samples) << ", \"samples\": [";
+            for(size_t s = 0; s < samples.size(); s++){
+                out << (s ? ", " : "") << samples[s];
+            }
+            out << "]}";
+        }
+        out << "\n      }\n    }";
+    }
+    out << "\n  ]\n}\n";
+    out.close();
+    if(!out){
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+
+/**
+* @param key: A member name.
+* @return The member of this object with that name, or null if it has none.
+*/
+const JsonValue* JsonValue::get(const std::string& key) const {
+    for(size_t i = 0; i < keys.size(); i++){
+        if(keys[i] == key){
+            return &items[i];
+        }
+    }
+    return nullptr;
+}
+
+
+/**
+* Recursive-descent reader for the JSON the baseline is written in: objects, arrays, numbers,
+* strings without escapes beyond \" and \\, true, false and null.
+*/
+class JsonReader {
+public:
+    explicit JsonReader(std::string_view text) : m_text(text) {}
+
+    bool read(JsonValue& value){
+        return read_value(value, 0) && (skip_space(), m_pos == m_text.size());
+    }
+
+    size_t position() const {
+        return m_pos;
+    }
+
+private:
+    void skip_space(){
+        while(m_pos < m_text.size() && std::isspace(uint8_t(m_text[m_pos]))){
+            m_pos++;
+        }
+    }
+
+    bool take(char c){
+        skip_space();
+        if(m_pos < m_text.size() && m_text[m_pos] == c){
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool read_string(std::string& text){
+        if(!take('"')){
+            return false;
+        }
+        text.clear();
+        while(m_pos < m_text.size() && m_text[m_pos] != '"'){
+            if(m_text[m_pos] == '\\' && m_pos + 1 < m_text.size()){
+                m_pos++;
+            }
+            text += m_text[m_pos++];
+        }
+        return take('"');
+    }
+
+    bool read_value(JsonValue& value, int depth){
+        skip_space();
+        if(m_pos == m_text.size() || depth > 16){
+            return false;
+        }
+        char c = m_text[m_pos];
+        if(c == '{' || c == '['){
+            bool object = c == '{';
+            value.type = object ? JsonValue::JSON_OBJECT : JsonValue::JSON_ARRAY;
+            m_pos++;
+            if(take(object ? '}' : ']')){
+                return true;
+            }
+            do{
+                if(object){
+                    value.keys.emplace_back();
+                    if(!read_string(value.keys.back()) || !take(':')){
+                        return false;
+                    }
+                }
+                value.items.emplace_back();
+                if(!read_value(value.items.back(), depth + 1)){
+                    return false;
+                }
+            } while(take(','));
+            return take(object ? '}' : ']');
+        }
+        if(c == '"'){
+            value.type = JsonValue::JSON_STRING;
+            return read_string(value.text);
+        }
+        for(const char* word : {"true", "false", "null"}){
+            size_t length = std::strlen(word);
+            if(m_text.compare(m_pos, length, word) == 0){
+                m_pos += length;
+                value.type = word[0] == 'n' ? JsonValue::JSON_NULL : JsonValue::JSON_NUMBER;
+                value.number = word[0] == 't';
+                return true;
+            }
+        }
+        std::string number(m_text.substr(m_pos, 32));
+        char* end;
+        value.number = std::strtod(number.c_str(), &end);
+        if(end == number.c_str()){
+            return false;
+        }
+        value.type = JsonValue::JSON_NUMBER;
+        m_pos += end - number.c_str();
+        return true;
+    }
+
+    std::string_view m_text;
+    size_t m_pos = 0;
+};
+
+
+/**
+* Reads a baseline written by write_baseline().
+* @param path: The baseline file.
+* @param results: Receives the workloads with their samples; medians are recomputed from those.
+* @param runs: Receives the runs of each workload.
+* @param threads: Receives the threads decoding each program.
+* @param error: Receives a description of the failure, if any.
+* @return True if the baseline was read.
+*/
+bool read_baseline(const std::string& path, std::vector<WorkloadResult>& results, int& runs, int& threads,
+                   std::string& error){
+    InputFile input;
+    if(!input.open(path, error)){
+        return false;
+    }
+    JsonReader reader(input.text());
+    JsonValue root;
+    if(!reader.read(root)){
+        error = "malformed JSON near byte " + std::to_string(reader.position());
+        return false;
+    }
+    const JsonValue* version = root.get("version");
+    const JsonValue* workloads = root.get("workloads");
+    if(!version || version->number != 1 || !workloads || workloads->type != JsonValue::JSON_ARRAY){
+        error = "not a dissem-bench baseline";
+        return false;
+    }
+    const JsonValue* runsValue = root.get("runs");
+    const JsonValue* threadsValue = root.get("threads");
+    runs = runsValue ? int(runsValue->number) : DEFAULT_RUNS;
+    threads = threadsValue ? int(threadsValue->number) : 1;
+
+    results.clear();
+    for(const JsonValue& item : workloads->items){
+        WorkloadResult result;
+        const JsonValue* name = item.get("name");
+        const JsonValue* files = item.get("files");
+        const JsonValue* metrics = item.get("metrics");
+        if(!name || !files || !metrics){
+            error = "workload without a name, files or metrics";
+            return false;
+        }
+        result.workload.name = name->text;
+        for(const JsonValue& file : files->items){
+            result.workload.files.push_back(file.text);
+        }
+        if(const JsonValue* instructions = item.get("instructions")){
+            result.instructions = uint64_t(instructions->number);
+        }
+        if(const JsonValue* allocs = item.get("allocs_per_instr")){
+            result.allocsPerInstr = allocs->number;
+        }
+        for(int m = 0; m < METRIC_COUNT; m++){
+            const JsonValue* metric = metrics->get(metric_name(m));
+            const JsonValue* samples = metric ? metric->get("samples") : nullptr;
+            if(samples){
+                for(const JsonValue& sample : samples->items){
+                    result.samples[m].push_back(sample.number);
+                }
+            }
+        }
+        results.push_back(result);
+    }
+    return true;
+}
+
+
+/**
+* Prints each workload's metrics next to the baseline's and flags the regressions: metrics whose
+* median got worse by more than threshold percent (and more than timer noise), where the
+* Mann-Whitney test also finds the runs slower with p below SIGNIFICANCE. Allocations per
+* instruction do not vary between runs, so they regress on the threshold alone.
+* @param baseline: The baseline's results.
+* @param current: This build's results.
+* @param threshold: Percent a median has to worsen by.
+* @return True if nothing regressed.
+*/
+bool compare_results(const std::vector<WorkloadResult>& baseline, const std::vector<WorkloadResult>& current,
+                     double threshold){
+    int regressions = 0;
+    std::cout << std::left << std::setw(10) << "workload" << std::setw(18) << "metric" << std::right
+              << std::setw(14) << "baseline" << std::setw(14) << "current" << std::setw(10) << "change"
+              << std::setw(10) << "p" << std::endl;
+    for(const WorkloadResult& now : current){
+        const WorkloadResult* before = nullptr;
+        for(const WorkloadResult& result : baseline){
+            if(result.workload.name == now.workload.name){
+                before = &result;
+            }
+        }
+        if(!before){
+            std::cout << std::left << std::setw(10) << now.workload.name << "not in the baseline" << std::endl;
+            continue;
+        }
+        std::vector<double> slow;
+        std::vector<double> fast;
+        for(size_t i = 0; i < now.samples[METRIC_TOTAL].size(); i++){
+            slow.push_back(1 + i);
+        }
+        for(size_t i = 0; i < before->samples[METRIC_TOTAL].size(); i++){
+            fast.push_back(-double(i));
+        }
+        if(p_larger(slow, fast) >= SIGNIFICANCE){                 // Even runs all slower would not be significant.
+            std::cerr << "WARNING: " << now.workload.name << ": " << slow.size() << " runs against the baseline's "
+                      << fast.size() << " cannot show a regression; use --runs " << DEFAULT_RUNS << " or more."
+                      << std::endl;
+        }
+        auto print_row = [&](const std::string& metric, double was, double is, double p, bool regressed){
+            double change = was != 0 ? (is - was) / was * 100 : 0;
+            std::cout << std::left << std::setw(10) << now.workload.name << std::setw(18) << metric << std::right
+                      << std::fixed << std::setprecision(4) << std::setw(14) << was << std::setw(14) << is
+                      << std::setprecision(1) << std::setw(9) << std::showpos << change << '%' << std::noshowpos
+                      << std::setprecision(4) << std::setw(10);
+            if(p >= 0){
+                std::cout << p;
+            }
+            else{
+                std::cout << "-";                               // Not sampled.
+            }
+            std::cout << (regressed ? "  REGRESSION" : "") << std::endl;
+            regressions += regressed;
+        };
+        for(int m = 0; m < METRIC_COUNT; m++){
+            if(before->samples[m].empty() || now.samples[m].empty()){
+                continue;
+            }
+            double was = median(before->samples[m]);
+            double is = median(now.samples[m]);
+            if(m == METRIC_RATE){                               // Fewer instructions per second is worse.
+                double p = p_larger(before->samples[m], now.samples[m]);
+                print_row("M instr/s", was / 1e6, is / 1e6, p, p < SIGNIFICANCE && is < was * (1 - threshold / 100));
+            }
+            else{
+                double p = p_larger(now.samples[m], before->samples[m]);
+                print_row(metric_name(m) + " ms", was, is, p, p < SIGNIFICANCE && is > was * (1 + threshold / 100) &&
+                                                              is - was > MIN_DELTA_MS);
+            }
+        }
+        double was = before->allocsPerInstr;
+        double is = now.allocsPerInstr;
+        print_row("allocs/instr", was, is, -1, is > was * (1 + threshold / 100) && is - was > MIN_DELTA_ALLOCS);
+    }
+    if(regressions){
+        std::cerr << "ERROR: " << regressions << " regression" << (regressions == 1 ? "" : "s")
+                  << " against the baseline." << std::endl;
+        return false;
+    }
+    std::cerr << "No regressions against the baseline." << std::endl;
+    return true;
+}
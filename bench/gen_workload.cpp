@@ -0,0 +1,546 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+* Synthetic SIC/XE workload generator. Emits a valid object file and symbol file pair whose size,
+* instruction mix and addressing mode densities are configurable, so the disassembler can be
+* measured on inputs far larger than the sample program.
+*/
+
+const uint32_t MAX_ADDRESS = 0xFFFF00;          // Addresses are 24 bits; leave room for a last instruction.
+
+struct GenOptions {
+    long long instructions = 0;                 // -n and -o are required.
+    std::string prefix;
+    unsigned seed = 1;
+    int mix[3] = {2, 6, 2};                     // Weights for Format 2, 3 and 4 instructions.
+    int pcPct = 70;                             // Format 3 operands that prefer PC-relative addressing.
+    int basePct = 20;                           // Format 3 operands that prefer base-relative addressing.
+    int indexedPct = 10;                        // Memory operands that are also indexed.
+    int literalPct = 5;                         // Memory operands that reference a literal.
+    int gapPermille = 10;                       // Instructions after which a RESW/RESB gap may follow.
+    int recordBytes = 30;                       // Most object code bytes in one text record.
+    bool resb = true;                           // Allow gaps that are not a multiple of 3 bytes.
+    bool legacy = false;                        // Only emit what the original string decoder understood.
+    uint32_t start = 0;
+};
+
+enum ItemKind : uint8_t {
+    ITEM_F1,
+    ITEM_F2,
+    ITEM_F3,
+    ITEM_F4,
+    ITEM_RSUB,
+    ITEM_LITERAL
+};
+
+struct Item {
+    uint32_t addr;
+    uint8_t kind;
+    uint8_t size;
+    int32_t literal;                            // Literal index for literal data or literal references, else -1.
+};
+
+struct GenSymbol {
+    std::string name;
+    uint32_t addr;
+};
+
+struct GenLiteral {
+    std::string name;
+    uint32_t addr;
+    uint8_t bytes[3];
+};
+
+const static uint8_t g_memOps[] = {0x18, 0x00, 0x0C, 0x1C, 0x28, 0x50, 0x54, 0x14, 0xE0, 0xD8, 0xDC,
+                                   0x20, 0x24, 0x40, 0x44, 0x74, 0x6C, 0x10, 0x84, 0x7C};
+const static uint8_t g_jumpOps[] = {0x3C, 0x30, 0x34, 0x38, 0x48};
+const static uint8_t g_format1Ops[] = {0xC4, 0xC0, 0xC8, 0xF0, 0xF4, 0xF8};
+const static uint8_t g_safeRegs[] = {0, 2, 4, 5, 6};   // Registers other than X and B, which operands depend on.
+const static char g_hexDigits[] = "0123456789ABCDEF";
+
+/**
+* Lays out a program, encodes it and writes the object and symbol files.
+*/
+class Generator {
+public:
+    explicit Generator(const GenOptions& opts) : m_opts(opts), m_random(opts.seed) {}
+
+    bool run(){
+        if(!layout()){
+            return false;
+        }
+        encode();
+        return write_obj() && write_sym();
+    }
+
+private:
+    const GenOptions& m_opts;
+    std::mt19937_64 m_random;
+    std::vector<uint8_t> m_memory;
+    std::vector<Item> m_items;
+    std::vector<std::pair<uint32_t, uint32_t>> m_extents;  // Byte ranges covered by text records.
+    std::vector<GenSymbol> m_symbols;
+    std::vector<GenLiteral> m_literals;
+    std::vector<uint32_t> m_dataAddrs;
+    std::vector<uint32_t> m_codeAddrs;
+    std::vector<uint32_t> m_mods;
+    uint32_t m_length = 0;
+    uint32_t m_base = 0;
+
+    int rand_int(int lo, int hi){
+        return std::uniform_int_distribution<int>(lo, hi)(m_random);
+    }
+
+    bool chance(int pct){
+        return rand_int(0, 99) < pct;
+    }
+
+    /**
+    * @return A six character symbol name: the prefix and n in base 36.
+    */
+    static std::string name_for(char prefix, size_t n){
+        static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        std::string name(5, '0');
+        for(int i = 4; i >= 0; i--){
+            name[i] = digits[n % 36];
+            n /= 36;
+        }
+        return prefix + name;
+    }
+
+    /**
+    * Plans the address of every instruction, literal pool and reserved gap so that every symbol
+    * address is known before any operand is encoded.
+    * @return False if the instructions don't fit in the address space.
+    */
+    bool layout(){
+        uint32_t addr = m_opts.start;
+        uint32_t extentStart = addr;
+        long long emitted = 0;
+        std::vector<int32_t> pending;                       // Literals waiting for the next pool.
+
+        auto add_item = [&](uint8_t kind, uint8_t size, int32_t literal){
+            m_items.push_back(Item{addr, kind, size, literal});
+            addr += size;
+        };
+
+        m_symbols.push_back(GenSymbol{"FIRST", addr});
+        m_codeAddrs.push_back(addr);
+        add_item(ITEM_F4, 4, -1);                           // +LDB #data, sets the base register.
+        add_item(ITEM_F3, 3, -1);                           // LDX #0, keeps indexed operands resolvable.
+        emitted = 2;
+
+        int totalMix = m_opts.mix[0] + m_opts.mix[1] + m_opts.mix[2];
+        while(emitted < m_opts.instructions && addr <= MAX_ADDRESS){
+            uint32_t segStart = addr;
+            while(emitted < m_opts.instructions && addr - segStart < 1500 && pending.size() < 10 && addr <= MAX_ADDRESS){
+                if(emitted > 2 && chance(8)){
+                    m_symbols.push_back(GenSymbol{name_for('C', m_symbols.size()), addr});
+                    m_codeAddrs.push_back(addr);
+                }
+                int pick = rand_int(0, totalMix - 1);
+                if(!m_opts.legacy && rand_int(0, 99) < 2){
+                    add_item(ITEM_F1, 1, -1);
+                }
+                else if(pick < m_opts.mix[0]){
+                    add_item(ITEM_F2, 2, -1);
+                }
+                else if(pick < m_opts.mix[0] + m_opts.mix[1]){
+                    if(chance(2)){
+                        add_item(ITEM_RSUB, 3, -1);
+                    }
+                    else if(chance(m_opts.literalPct)){
+                        m_literals.push_back(GenLiteral{"", 0, {0, 0, 0}});
+                        pending.push_back(m_literals.size() - 1);
+                        add_item(ITEM_F3, 3, m_literals.size() - 1);
+                    }
+                    else{
+                        add_item(ITEM_F3, 3, -1);
+                    }
+                }
+                else{
+                    add_item(ITEM_F4, 4, -1);
+                }
+                emitted++;
+                if(rand_int(0, 999) < m_opts.gapPermille){
+                    break;
+                }
+            }
+            for(int32_t literal : pending){                 // Literal pool at the end of the segment.
+                m_literals[literal].addr = addr;
+                add_item(ITEM_LITERAL, 3, literal);
+            }
+            pending.clear();
+
+            bool last = emitted >= m_opts.instructions;
+            if(last || rand_int(0, 999) < m_opts.gapPermille * 20 || addr - extentStart > 20000){
+                m_extents.push_back(std::make_pair(extentStart, addr));
+                int symbolsInGap = rand_int(1, 3);
+                for(int s = 0; s < symbolsInGap && addr < MAX_ADDRESS - 0xF00; s++){
+                    m_symbols.push_back(GenSymbol{name_for('D', m_symbols.size()), addr});
+                    m_dataAddrs.push_back(addr);
+                    uint32_t bytes = 3 * rand_int(1, 40);
+                    if(m_opts.resb && chance(30)){
+                        bytes = rand_int(1, 100);
+                    }
+                    addr += bytes;
+                }
+                extentStart = addr;
+            }
+        }
+        if(emitted < m_opts.instructions){
+            std::fprintf(stderr, "ERROR: %lld instructions do not fit in the 24-bit address space; "
+                                 "split the workload over several programs.\n", m_opts.instructions);
+            return false;
+        }
+        if(extentStart != addr){
+            m_extents.push_back(std::make_pair(extentStart, addr));
+        }
+        m_length = addr - m_opts.start;
+        m_memory.assign(m_length, 0);
+        std::sort(m_dataAddrs.begin(), m_dataAddrs.end());
+        std::sort(m_codeAddrs.begin(), m_codeAddrs.end());
+        return true;
+    }
+
+    /**
+    * Picks a random address from a sorted list.
+    * @return False if no address lies in [lo, hi].
+    */
+    bool pick_in_range(const std::vector<uint32_t>& addrs, long lo, long hi, uint32_t& picked){
+        auto first = std::lower_bound(addrs.begin(), addrs.end(), uint32_t(std::max(lo, 0L)));
+        auto last = std::upper_bound(addrs.begin(), addrs.end(), uint32_t(std::max(hi, 0L)));
+        if(hi < 0 || first >= last){
+            return false;
+        }
+        picked = *(first + rand_int(0, int(last - first) - 1));
+        return true;
+    }
+
+    uint8_t* at(uint32_t addr){
+        return &m_memory[addr - m_opts.start];
+    }
+
+    void encode_f3(uint32_t addr, uint8_t op, int ni, bool x, int bp, int disp){
+        uint8_t* bytes = at(addr);
+        bytes[0] = op | ni;
+        bytes[1] = (x ? 0x80 : 0) | (bp << 4) | ((disp >> 8) & 0x0F);
+        bytes[2] = disp & 0xFF;
+    }
+
+    void encode_f4(uint32_t addr, uint8_t op, int ni, bool x, uint32_t target){
+        uint8_t* bytes = at(addr);
+        bytes[0] = op | ni;
+        bytes[1] = (x ? 0x80 : 0) | 0x10 | ((target >> 16) & 0x0F);
+        bytes[2] = (target >> 8) & 0xFF;
+        bytes[3] = target & 0xFF;
+    }
+
+    /**
+    * Encodes a Format 3 memory reference to one of the given targets, preferring PC-relative or
+    * base-relative addressing as configured and falling back to an immediate constant.
+    */
+    void encode_mem3(uint32_t addr, uint8_t op, const std::vector<uint32_t>& targets, bool allowIndexed){
+        long pc = long(addr) + 3;
+        bool x = allowIndexed && chance(m_opts.indexedPct);
+        int ni = 3;
+        if(!x){
+            int r = rand_int(0, 99);
+            ni = r < 10 ? 1 : (r < 20 ? 2 : 3);
+        }
+        uint32_t target;
+        int mode = rand_int(0, 99);
+        bool wantBase = mode >= m_opts.pcPct && mode < m_opts.pcPct + m_opts.basePct;
+        if(!wantBase && pick_in_range(targets, pc - 2048, pc + 2047, target)){
+            encode_f3(addr, op, ni, x, 2, int(long(target) - pc) & 0xFFF);
+        }
+        else if(pick_in_range(targets, m_base, long(m_base) + 4095, target)){
+            encode_f3(addr, op, ni, x, 4, int(target - m_base));
+        }
+        else if(pick_in_range(targets, pc - 2048, pc + 2047, target)){
+            encode_f3(addr, op, ni, x, 2, int(long(target) - pc) & 0xFFF);
+        }
+        else{
+            encode_f3(addr, op, 1, false, 0, rand_int(0, 4095));   // Immediate constant.
+        }
+    }
+
+    /**
+    * Fills in the object code of every planned item.
+    */
+    void encode(){
+        m_base = m_dataAddrs.empty() ? m_opts.start : m_dataAddrs[m_dataAddrs.size() / 2];
+        std::vector<uint32_t> allTargets(m_dataAddrs);
+        allTargets.insert(allTargets.end(), m_codeAddrs.begin(), m_codeAddrs.end());
+        std::sort(allTargets.begin(), allTargets.end());
+        std::vector<uint32_t> farTargets;                   // Reachable by a Format 4 address.
+        for(uint32_t addr : allTargets){
+            if(addr <= 0xFFFFF){
+                farTargets.push_back(addr);
+            }
+        }
+
+        for(size_t i = 0; i < m_items.size(); i++){
+            const Item& item = m_items[i];
+            uint8_t* bytes = at(item.addr);
+            if(i == 0){
+                encode_f4(item.addr, 0x68, 1, false, m_base);   // +LDB #data
+                m_mods.push_back(item.addr + 1);
+                continue;
+            }
+            if(i == 1){
+                encode_f3(item.addr, 0x04, 1, false, 0, 0);     // LDX #0
+                continue;
+            }
+            switch(item.kind){
+            case ITEM_F1:
+                bytes[0] = g_format1Ops[rand_int(0, sizeof(g_format1Ops) - 1)];
+                break;
+            case ITEM_F2:
+                encode_f2(bytes);
+                break;
+            case ITEM_RSUB:
+                bytes[0] = 0x4F;
+                bytes[1] = 0;
+                bytes[2] = 0;
+                break;
+            case ITEM_LITERAL:
+                std::memcpy(bytes, m_literals[item.literal].bytes, 3);
+                break;
+            case ITEM_F3:
+                if(item.literal >= 0){
+                    GenLiteral& literal = m_literals[item.literal];
+                    make_literal(literal);
+                    long disp = long(literal.addr) - long(item.addr + 3);
+                    encode_f3(item.addr, g_memOps[rand_int(0, 7)], 3, false, 2, int(disp) & 0xFFF);
+                }
+                else if(chance(15)){
+                    encode_mem3(item.addr, g_jumpOps[rand_int(0, sizeof(g_jumpOps) - 1)], m_codeAddrs, false);
+                }
+                else{
+                    encode_mem3(item.addr, g_memOps[rand_int(0, sizeof(g_memOps) - 1)], allTargets, true);
+                }
+                break;
+            case ITEM_F4:{
+                const std::vector<uint32_t>& pool = farTargets.empty() ? m_codeAddrs : farTargets;
+                uint32_t target = pool[rand_int(0, pool.size() - 1)];
+                bool jump = chance(15);
+                uint8_t op = jump ? g_jumpOps[rand_int(0, sizeof(g_jumpOps) - 1)]
+                                  : g_memOps[rand_int(0, sizeof(g_memOps) - 1)];
+                bool x = !jump && chance(m_opts.indexedPct);
+                encode_f4(item.addr, op, x ? 3 : (chance(15) ? 1 : 3), x, target & 0xFFFFF);
+                m_mods.push_back(item.addr + 1);
+                break;
+            }
+            }
+        }
+    }
+
+    void encode_f2(uint8_t* bytes){
+        int r1 = g_safeRegs[rand_int(0, sizeof(g_safeRegs) - 1)];
+        int r2 = g_safeRegs[rand_int(0, sizeof(g_safeRegs) - 1)];
+        if(m_opts.legacy){
+            bytes[0] = 0xB4;                                            // CLEAR r1
+            bytes[1] = uint8_t(r1 << 4);
+            return;
+        }
+        switch(rand_int(0, 6)){
+        case 0: bytes[0] = 0xB4; bytes[1] = uint8_t(r1 << 4); break;                    // CLEAR r1
+        case 1: bytes[0] = 0xA0; bytes[1] = uint8_t(r1 << 4 | r2); break;               // COMPR r1,r2
+        case 2: bytes[0] = 0x90; bytes[1] = uint8_t(r1 << 4 | r2); break;               // ADDR r1,r2
+        case 3: bytes[0] = 0x94; bytes[1] = uint8_t(r1 << 4 | r2); break;               // SUBR r1,r2
+        case 4: bytes[0] = 0xAC; bytes[1] = uint8_t(r1 << 4 | r2); break;               // RMO r1,r2
+        case 5: bytes[0] = 0xA4; bytes[1] = uint8_t(r1 << 4 | rand_int(0, 15)); break;  // SHIFTL r1,n
+        default: bytes[0] = 0xB0; bytes[1] = uint8_t(rand_int(0, 15) << 4); break;      // SVC n
+        }
+    }
+
+    /**
+    * Gives a literal three random bytes, written either as =X'hhhhhh' or as =C'ccc'.
+    */
+    void make_literal(GenLiteral& literal){
+        char name[16];
+        if(chance(50)){
+            for(int k = 0; k < 3; k++){
+                literal.bytes[k] = uint8_t(rand_int(0, 255));
+            }
+            std::snprintf(name, sizeof(name), "=X'%c%c%c%c%c%c'",
+                          g_hexDigits[literal.bytes[0] >> 4], g_hexDigits[literal.bytes[0] & 15],
+                          g_hexDigits[literal.bytes[1] >> 4], g_hexDigits[literal.bytes[1] & 15],
+                          g_hexDigits[literal.bytes[2] >> 4], g_hexDigits[literal.bytes[2] & 15]);
+        }
+        else{
+            for(int k = 0; k < 3; k++){
+                literal.bytes[k] = uint8_t('A' + rand_int(0, 25));
+            }
+            std::snprintf(name, sizeof(name), "=C'%c%c%c'", literal.bytes[0], literal.bytes[1], literal.bytes[2]);
+        }
+        literal.name = name;
+    }
+
+    /**
+    * Writes the header, text, modification and end records. Text records hold at most
+    * recordBytes bytes and never split an instruction; literal pools start their own record.
+    */
+    bool write_obj(){
+        std::string path = m_opts.prefix + ".obj";
+        FILE* file = std::fopen(path.c_str(), "w");
+        if(file == nullptr){
+            std::perror(path.c_str());
+            return false;
+        }
+        std::fprintf(file, "H%-6s%06X%06X\n", "WORKLD", m_opts.start, m_length);
+
+        size_t itemIdx = 0;
+        std::string line;
+        for(const auto& extent : m_extents){
+            while(itemIdx < m_items.size() && m_items[itemIdx].addr < extent.first){
+                itemIdx++;
+            }
+            while(itemIdx < m_items.size() && m_items[itemIdx].addr < extent.second){
+                uint32_t recStart = m_items[itemIdx].addr;
+                uint32_t recEnd = recStart;
+                while(itemIdx < m_items.size() && m_items[itemIdx].addr < extent.second &&
+                      recEnd + m_items[itemIdx].size - recStart <= uint32_t(m_opts.recordBytes)){
+                    if(recEnd != recStart && m_items[itemIdx].kind == ITEM_LITERAL &&
+                       m_items[itemIdx - 1].kind != ITEM_LITERAL){
+                        break;
+                    }
+                    recEnd += m_items[itemIdx].size;
+                    itemIdx++;
+                }
+                char head[16];
+                std::snprintf(head, sizeof(head), "T%06X%02X", recStart, recEnd - recStart);
+                line.assign(head);
+                for(uint32_t addr = recStart; addr < recEnd; addr++){
+                    uint8_t byte = *at(addr);
+                    line.push_back(g_hexDigits[byte >> 4]);
+                    line.push_back(g_hexDigits[byte & 15]);
+                }
+                line.push_back('\n');
+                std::fwrite(line.data(), 1, line.size(), file);
+            }
+        }
+        for(uint32_t mod : m_mods){
+            std::fprintf(file, "M%06X05\n", mod);
+        }
+        std::fprintf(file, "E%06X\n", m_opts.start);
+        return std::fclose(file) == 0;
+    }
+
+    /**
+    * Writes the symbol table and literal table in the layout of the sample symbol file.
+    */
+    bool write_sym(){
+        std::string path = m_opts.prefix + ".sym";
+        FILE* file = std::fopen(path.c_str(), "w");
+        if(file == nullptr){
+            std::perror(path.c_str());
+            return false;
+        }
+        std::fprintf(file, "Symbol  Value   Flags:\n-----------------------\n");
+        for(const GenSymbol& symbol : m_symbols){
+            std::fprintf(file, "%-8s%06X  R\n", symbol.name.c_str(), symbol.addr);
+        }
+        std::fprintf(file, "\nName    Lit_Const  Length Address:\n----------------------------------\n");
+        for(const GenLiteral& literal : m_literals){
+            if(!literal.name.empty()){
+                std::fprintf(file, "        %-10s   3    %06X\n", literal.name.c_str(), literal.addr);
+            }
+        }
+        return std::fclose(file) == 0;
+    }
+};
+
+
+/**
+* Prints how the generator is run and exits.
+*/
+void usage(){
+    std::fprintf(stderr,
+        "Usage: gen_workload -n INSTRUCTIONS -o PREFIX [options]\n"
+        "Writes PREFIX.obj and PREFIX.sym.\n"
+        "  --seed N          random seed (default 1)\n"
+        "  --mix F2:F3:F4    format weights (default 2:6:2)\n"
+        "  --pc PCT          format 3 operands preferring PC-relative addressing (default 70)\n"
+        "  --base PCT        format 3 operands preferring base-relative addressing (default 20)\n"
+        "  --indexed PCT     indexed memory operands (default 10)\n"
+        "  --literals PCT    memory operands referencing a literal (default 5)\n"
+        "  --gaps PERMILLE   instructions followed by a reserved gap (default 10)\n"
+        "  --record-bytes N  most object code bytes per text record, 4 to 255 (default 30)\n"
+        "  --start ADDR      hexadecimal load address (default 0)\n"
+        "  --no-resb         only reserve whole words\n"
+        "  --legacy          restrict to CLEAR-only format 2, no format 1 and whole-word gaps\n");
+    std::exit(1);
+}
+
+
+int main(int argc, char** argv){
+    GenOptions opts;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        auto value = [&]() -> const char* {
+            if(i + 1 >= argc){
+                usage();
+            }
+            return argv[++i];
+        };
+        if(arg == "-n"){
+            opts.instructions = std::atoll(value());
+        }
+        else if(arg == "-o"){
+            opts.prefix = value();
+        }
+        else if(arg == "--seed"){
+            opts.seed = unsigned(std::atol(value()));
+        }
+        else if(arg == "--mix"){
+            if(std::sscanf(value(), "%d:%d:%d", &opts.mix[0], &opts.mix[1], &opts.mix[2]) != 3){
+                usage();
+            }
+        }
+        else if(arg == "--pc"){
+            opts.pcPct = std::atoi(value());
+        }
+        else if(arg == "--base"){
+            opts.basePct = std::atoi(value());
+        }
+        else if(arg == "--indexed"){
+            opts.indexedPct = std::atoi(value());
+        }
+        else if(arg == "--literals"){
+            opts.literalPct = std::atoi(value());
+        }
+        else if(arg == "--gaps"){
+            opts.gapPermille = std::atoi(value());
+        }
+        else if(arg == "--record-bytes"){
+            opts.recordBytes = std::atoi(value());
+        }
+        else if(arg == "--start"){
+            opts.start = uint32_t(std::strtoul(value(), nullptr, 16));
+        }
+        else if(arg == "--no-resb"){
+            opts.resb = false;
+        }
+        else if(arg == "--legacy"){
+            opts.legacy = true;
+            opts.resb = false;
+        }
+        else{
+            usage();
+        }
+    }
+    if(opts.instructions < 2 || opts.prefix.empty() || opts.mix[0] + opts.mix[1] + opts.mix[2] <= 0 ||
+       opts.recordBytes < 4 || opts.recordBytes > 255){
+        usage();
+    }
+    return Generator(opts).run() ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../hex.h"
+
+bool check_kernel(uint8_t kernel);
+void time_kernel(uint8_t kernel, const std::string& hex, int iterations);
+
+/**
+* Micro-benchmark and correctness check for the hex decode kernels.
+* ./hexbench [--check] [--bytes N] [--iterations N]
+* --check compares every kernel the CPU can run with the scalar kernel on every pair of
+* characters in every position of a vector step, and on odd lengths and misaligned input.
+*/
+int main(int argc, char** argv){
+    bool check = false;
+    size_t numBytes = 1 << 20;
+    int iterations = 200;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--check"){
+            check = true;
+        }
+        else if(arg == "--bytes" && i + 1 < argc){
+            numBytes = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--iterations" && i + 1 < argc){
+            iterations = std::atoi(argv[++i]);
+        }
+        else{
+            std::cerr << "usage: hexbench [--check] [--bytes N] [--iterations N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if(check){
+        bool ok = true;
+        for(uint8_t kernel = 0; kernel < HEX_KERNEL_COUNT; kernel++){
+            if(hex_kernel_available(kernel)){
+                bool passed = check_kernel(kernel);
+                std::cout << hex_kernel_name(kernel) << ": " << (passed ? "ok" : "FAILED") << std::endl;
+                ok = ok && passed;
+            }
+        }
+        return ok ? 0 : 1;
+    }
+
+    std::mt19937 random(1);
+    std::string hex(numBytes * 2, '0');
+    for(char& c : hex){
+        c = "0123456789ABCDEF"[random() & 0x0F];
+    }
+    for(uint8_t kernel = 0; kernel < HEX_KERNEL_COUNT; kernel++){
+        if(hex_kernel_available(kernel)){
+            time_kernel(kernel, hex, iterations);
+        }
+    }
+    return 0;
+}
+
+
+/**
+* @param kernel: The kernel to check against the scalar kernel.
+* @return True if the kernel agrees with the scalar kernel on every input tried.
+*/
+bool check_kernel(uint8_t kernel){
+    HexDecoder decoder = hex_decoder(kernel);
+    const size_t block = 64;                                // Bytes per check: two AVX2 steps.
+    std::vector<char> hex(block * 2 + 1);
+    std::vector<uint8_t> expected(block);
+    std::vector<uint8_t> actual(block);
+
+    for(int pair = 0; pair < 65536; pair++){                // Every pair of characters, in every byte position.
+        for(size_t pos = 0; pos < block; pos++){
+            std::memset(hex.data(), '5', block * 2);
+            hex[pos * 2] = char(pair >> 8);
+            hex[pos * 2 + 1] = char(pair & 0xFF);
+            bool wanted = decode_hex_scalar(hex.data(), block, expected.data());
+            bool got = decoder(hex.data(), block, actual.data());
+            if(wanted != got || (wanted && expected != actual)){
+                std::cerr << hex_kernel_name(kernel) << ": mismatch on characters " << (pair >> 8) << ","
+                          << (pair & 0xFF) << " at byte " << pos << std::endl;
+                return false;
+            }
+        }
+    }
+
+    std::mt19937 random(2);
+    std::vector<char> buffer(4096 + 64);
+    std::vector<uint8_t> wantedBytes(2048);
+    std::vector<uint8_t> gotBytes(2048);
+    for(int trial = 0; trial < 20000; trial++){             // Any length and alignment, with and without a bad character.
+        size_t offset = random() % 64;
+        size_t numBytes = random() % 2048;
+        char* text = buffer.data() + offset;
+        for(size_t i = 0; i < numBytes * 2; i++){
+            text[i] = "0123456789ABCDEFabcdef"[random() % 22];
+        }
+        if(numBytes > 0 && trial % 2 == 1){
+            text[random() % (numBytes * 2)] = char(random());
+        }
+        bool wanted = decode_hex_scalar(text, numBytes, wantedBytes.data());
+        bool got = decoder(text, numBytes, gotBytes.data());
+        if(wanted != got || (wanted && std::memcmp(wantedBytes.data(), gotBytes.data(), numBytes) != 0)){
+            std::cerr << hex_kernel_name(kernel) << ": mismatch on " << numBytes << " bytes at offset "
+                      << offset << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+* Prints the kernel's throughput in input characters per second.
+*/
+void time_kernel(uint8_t kernel, const std::string& hex, int iterations){
+    HexDecoder decoder = hex_decoder(kernel);
+    std::vector<uint8_t> bytes(hex.size() / 2);
+    bool ok = true;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++){
+        ok = decoder(hex.data(), bytes.size(), bytes.data()) && ok;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double gbps = double(hex.size()) * iterations / elapsed.count() / 1e9;
+    std::cout << hex_kernel_name(kernel) << ": " << gbps << " GB/s" << (ok ? "" : " (rejected input)") << std::endl;
+}
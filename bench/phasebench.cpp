@@ -0,0 +1,149 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../disassembler.h"
+#include "../output.h"
+
+#if !DISSEM_STATS
+#error "phasebench reads the phase timers, which are compiled out with DISSEM_STATS=0"
+#endif
+
+static std::atomic<uint64_t> g_heapAllocations(0);
+
+/**
+* Every heap allocation of the process is counted here, whether or not it goes through a
+* counting allocator, so allocations left in the decode and output paths show up.
+*/
+void* operator new(size_t size){
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if(!p){
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+
+/**
+* Times each phase of the disassembler on one or more object and symbol file pairs, which are
+* treated as one workload (a workload too large for the 24-bit address space is split over
+* several programs). Also counts the heap allocations of the first pass, which starts cold like a
+* run of dissem, and of the last, by when the Disassembler's buffers have grown to size: with
+* --max-allocs-per-instr it fails if the first pass made more per instruction than that, and with
+* --max-warm-allocs if the last one made more in all (which it would, if anything allocated per line).
+* ./phasebench [--name NAME] [-j THREADS] [-o OUTPUT] [--repeat N] [--max-allocs-per-instr LIMIT]
+*              [--max-warm-allocs LIMIT] a.obj a.sym [b.obj b.sym ...]
+*/
+int main(int argc, char** argv){
+    std::string name;
+    int threads = 1;
+    int repeat = 1;
+    double maxAllocs = -1;
+    long maxWarmAllocs = -1;
+    OutputOptions output;
+    output.path = "/dev/null";
+    std::vector<std::string> files;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--name" && i + 1 < argc){
+            name = argv[++i];
+        }
+        else if(arg == "-j" && i + 1 < argc){
+            threads = std::atoi(argv[++i]);
+        }
+        else if(arg == "-o" && i + 1 < argc){
+            output.path = argv[++i];
+        }
+        else if(arg == "--repeat" && i + 1 < argc){
+            repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if(arg == "--max-allocs-per-instr" && i + 1 < argc){
+            maxAllocs = std::atof(argv[++i]);
+        }
+        else if(arg == "--max-warm-allocs" && i + 1 < argc){
+            maxWarmAllocs = std::atol(argv[++i]);
+        }
+        else{
+            files.push_back(arg);
+        }
+    }
+    if(files.empty() || files.size() % 2 != 0){
+        std::cerr << "usage: phasebench [--name NAME] [-j THREADS] [-o OUTPUT] [--repeat N]"
+                  << " [--max-allocs-per-instr LIMIT] [--max-warm-allocs LIMIT] a.obj a.sym ..." << std::endl;
+        return 1;
+    }
+    if(name.empty()){
+        name = files[0];
+    }
+
+    Disassembler disassembler(threads);
+    RunStats best;
+    MemStats cold;
+    uint64_t warmAllocs = 0;
+    mem_reset_peaks();
+    for(int r = 0; r < repeat; r++){                        // Keep the fastest pass of each phase.
+        RunStats total;
+        uint64_t heapBefore = g_heapAllocations.load();
+        for(size_t i = 0; i < files.size(); i += 2){
+            std::string error;
+            if(!disassembler.run(files[i], files[i + 1], output, error)){
+                std::cerr << "ERROR: " << error << std::endl;
+                return 1;
+            }
+            total.add(disassembler.stats());
+        }
+        if(r == 0){
+            best = total;
+            cold = mem_snapshot();
+        }
+        if(r == repeat - 1){
+            warmAllocs = g_heapAllocations.load() - heapBefore;
+        }
+        else{
+            for(int p = 0; p < PHASE_COUNT; p++){
+                best.seconds[p] = std::min(best.seconds[p], total.seconds[p]);
+            }
+        }
+    }
+
+    double parse = best.seconds[PHASE_PARSE_OBJ] + best.seconds[PHASE_PARSE_SYM];
+    double decode = best.seconds[PHASE_DECODE] + best.seconds[PHASE_REGISTERS];
+    uint64_t instructions = best.instructions();
+    double seconds = best.total_seconds();
+    double allocs = double(cold.total.allocations) / std::max<uint64_t>(1, instructions);
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(12) << name << std::right
+              << std::setw(12) << instructions << " instr"
+              << "  parse " << std::setw(9) << parse * 1e3 << " ms"
+              << "  gaps " << std::setw(8) << best.seconds[PHASE_GAPS] * 1e3 << " ms"
+              << "  decode " << std::setw(9) << decode * 1e3 << " ms"
+              << "  output " << std::setw(9) << best.seconds[PHASE_OUTPUT] * 1e3 << " ms"
+              << "  " << std::setw(8) << std::setprecision(2) << instructions / seconds / 1e6 << " M instr/s"
+              << "  " << std::setw(8) << std::setprecision(4) << allocs << " allocs/instr"
+              << "  " << std::setw(6) << warmAllocs << " warm allocs"
+              << "  peak heap " << std::setw(7) << std::setprecision(1) << cold.total.peak / 1048576.0 << " MiB"
+              << std::endl;
+    if(maxAllocs >= 0 && allocs > maxAllocs){
+        std::cerr << "ERROR: " << name << ": " << allocs << " allocations per instruction, over the budget of "
+                  << maxAllocs << "." << std::endl;
+        return 1;
+    }
+    if(maxWarmAllocs >= 0 && repeat > 1 && warmAllocs > uint64_t(maxWarmAllocs)){
+        std::cerr << "ERROR: " << name << ": " << warmAllocs << " allocations in a warm pass, over the budget of "
+                  << maxWarmAllocs << "." << std::endl;
+        return 1;
+    }
+    return 0;
+}
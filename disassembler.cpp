@@ -1,595 +1,1307 @@
-#include "disassembler.h"
-#include "output.h"
-
-const static std::string g_ops[] = {                // Data structure provided by prompt. Program does not
-"18", "58", "90", "40", "B4", "28",                 // support Opcodes that represent Format 1 instructions.
-"88", "A0", "24", "64", "9C", "C4",
-"C0", "F4", "3C", "30", "34", "38",
-"48", "00", "68", "50", "70", "08",
-"6C", "74", "04", "D0", "20", "60",
-"98", "C8", "44", "D8", "AC", "4C",
-"A4", "A8", "F0", "EC", "0C", "78",
-"54", "80", "D4", "14", "7C", "E8",
-"84", "10", "1C", "5C", "94", "B0",
-"E0", "F8", "2C", "B8", "DC"
-};
-
-const static std::string g_mnemonics[] = {          // Data structure provided by prompt. Program does not
-"ADD", "ADDF", "ADDR", "AND", "CLEAR", "COMP",      // support Format 1 one instructions.
-"COMPF", "COMPR", "DIV", "DIVF", "DIVR", "FIX",
-"FLOAT", "HIO", "J", "JEQ", "JGT", "JLT",
-"JSUB", "LDA", "LDB", "LDCH", "LDF", "LDL",
-"LDS", "LDT", "LDX", "LPS", "MUL", "MULF",
-"MULR", "NORM", "OR", "RD", "RMO", "RSUB",
-"SHIFTL", "SHIFTR", "SIO", "SSK", "STA", "STB",
-"STCH", "STF", "STI", "STL","STS", "STSW",
-"STT", "STX", "SUB", "SUBF", "SUBR", "SVC",
-"TD", "TIO", "TIX", "TIXR", "WD"
-};
-
-const static std::string g_registers[7] = {"A", "X", "L", "B", "S", "T", "F"};
-int g_registerValues[7] = {0,0,0,0,0,0,0};
-
-static std::vector<std::string> g_records;
-static std::map <int, std::string> g_symMap;
-
-static std::vector<int> g_programCounter;
-static std::vector<std::string> g_labels;
-static std::vector<std::string> g_opCodes;
-static std::vector<std::string> g_operands;
-static std::vector<std::string> g_objectCodes;
-
-/**
-* Converts a given object file and its symbol table into assembly language. 
-* Goes through each object code and deciphers and stores the necessary information
-* for each line. Additional functionalties are included to account for "non-standard"
-* cases such as LTORG and BASE directives, CLEAR, LOAD, and RSUB instructions, and literals.
-* @param objFile: The object file.
-* @param symTab: The symbol file.
-*/ 
-void disassemble(std::string objFile, std::string symTab){
-    parse_obj(objFile);
-    parse_sym(symTab);
-    int currAddr = std::stoi(g_records[0].substr(7,6), nullptr, 16);    // Starting address of the object file.
-    g_programCounter.push_back(currAddr);
-    g_labels.push_back(g_records[0].substr(1,6));                       // Name of the program.
-    g_opCodes.push_back("START");                                       
-    if(currAddr == 0){                                                  
-        g_operands.push_back("0");
-    }
-    else{                                                               // Format issues fixed if starting address
-        std::string startOperand = g_records[0].substr(7,6);            // isn't 0.
-        startOperand.erase(0, startOperand.find_first_not_of('0'));
-        g_operands.push_back(startOperand);
-    }
-    g_objectCodes.push_back("");
-    
-    for(int i = 0; i < g_records.size(); i++){                          // Iteration through each text record.
-        if(g_records[i].find("T") != 0){
-            continue;
-        }
-        currAddr = stoi(g_records[i].substr(1,6), nullptr, 16);         // Starting address of the text record.
-
-        for(int j = 9; j < g_records[i].length() - 3;){                 // Iteration through object codes up to 
-                                                                        // the last possible object code to extract
-                                                                        // three hexadecimals (excluding literals)
-            if((g_symMap.find(currAddr)->second).find("=") == 0){       // Checking for literals.
-                add_LTORG();
-                while((g_symMap.find(currAddr)->second).find("=") == 0){// Accounts for literal(s) being called
-                    std::string lit = g_symMap.find(currAddr)->second;  // before the LTORG directive was used.
-                    int length;
-                    if(lit.find("=X") == 0){                            // Length of literal's object code differs
-                        length = lit.rfind("'") - 3;                    // depending on the type of literal 
-                    }                                                   // (X for Hexadecimal, C for Character).
-                    else if(lit.find("=C") == 0){
-                        length = (lit.rfind("'") - 3) * 2;
-                    }
-                    int bytes = length / 2;
-                    std::string litObjCode = g_records[i].substr(j, length);
-                    add_literal(lit, litObjCode, currAddr);
-                    currAddr = currAddr + bytes;
-                    j = j + length;
-                } 
-                continue;
-            }
-
-            std::string firstHex = g_records[i].substr(j, 1);
-            std::string secondHex = g_records[i].substr(j + 1, 1);
-            std::string thirdHex = g_records[i].substr(j + 2, 1);
-            std::string mnemonic = get_mnemonic(firstHex, secondHex);
-            int format = get_format(mnemonic, thirdHex);
-            std::string objCode = g_records[i].substr(j, format * 2);
-            int targetAddr = get_TA(format, currAddr, objCode, addr_mode_TA(thirdHex), is_indexed(thirdHex));
-            std::string operand = get_operand(targetAddr, format, mnemonic, objCode, addr_mode_OP(secondHex), 
-                                              is_indexed(thirdHex));
-
-            g_programCounter.push_back(currAddr);
-            add_label(currAddr);
-
-            if(mnemonic.find("LD") == 0){                               // Checking for specific instructions.
-                load_reg(targetAddr, format, mnemonic, objCode);
-            }
-            else if(mnemonic == "CLEAR"){
-                clear_reg(objCode);
-            }
-
-            if(format == 4){
-                mnemonic = "+" + mnemonic;
-            }
-
-            g_opCodes.push_back(mnemonic);
-
-            if(mnemonic != "RSUB"){
-                g_operands.push_back(operand);
-            }
-            else{                                                       // The RSUB instruction does NOT
-                g_operands.push_back("");                               // have an operand.
-            }
-
-            g_objectCodes.push_back(objCode);
-
-            if(get_mnemonic(firstHex, secondHex) == "LDB"){             // The instruction is LOAD BASE.
-                g_programCounter.push_back(32);                         // See output.cpp.
-                g_labels.push_back("");
-                g_opCodes.push_back("BASE");
-                g_operands.push_back(g_symMap.find(targetAddr)->second);
-                g_objectCodes.push_back("");
-            }
-
-            j = j + (format * 2);                                       // Next iteration through the current text    
-                                                                        // record starts at the first hexadecimal
-                                                                        // of the next object code.
-            currAddr = currAddr + format;                                                        
-        }
-        fill_gap(currAddr, i);
-    }
-    g_programCounter.push_back(32);                                     
-    g_labels.push_back("");
-    g_opCodes.push_back("END");
-    g_operands.push_back(g_symMap.find(stoi(g_records[g_records.size() - 1].substr(1,6) , nullptr, 16))->second);
-    g_objectCodes.push_back("");
-
-    create_output(g_programCounter, g_labels, g_opCodes, g_operands, g_objectCodes);
-
-    g_programCounter.clear();
-    g_labels.clear();
-    g_opCodes.clear();
-    g_operands.clear();
-    g_objectCodes.clear();
-
-    return;
-}
-
-
-/**
-* Parses the object code file and stores each individual record into a vector.
-* @param objFile: The file containing the object code.
-* @return A vector containing the object code, parsed line by line into distinct index positions.
-*/ 
-void parse_obj(std::string objFile){
-    std::ifstream textFile(objFile);
-    std::string line;
-
-    while(std::getline(textFile, line)){
-        g_records.push_back(line);
-    }
-}
-
-
-/**
-* Parses the symbol file and stores the symbols and their addresses as keys and values respectively into a map.
-* Any other lines and information will be ignored (Addressing type, lines without important information).
-* @param symFile: The file containing the symbols and their information.
-*/ 
-void parse_sym(std::string symFile){
-    std::ifstream symbols(symFile);
-    std::string line;
-    std::string token1;
-    std::string token2;
-    std::string token3;
-
-    while(std::getline(symbols, line)){
-        if(line.find("Symbol") == 0 || line.find("-") == 0 || line.find("Name") == 0 || line.length() == 0){
-            // Current line has no relevant information.
-            continue;
-        }
-        else{
-            std::istringstream symLine(line);
-            symLine >> token1 >> token2 >> token3;
-            if(token3.find("R") == 0 || token3.find("A") == 0) {
-                // Current line has information about symbols.
-                g_symMap.insert(std::pair<int, std::string>(stoi(token2, nullptr, 16), token1));
-            }
-            else{
-                // Current line has information about literals.
-                g_symMap.insert(std::pair<int, std::string>(stoi(token3, nullptr, 16), token1)); 
-            }
-        }
-    }
-}
-
-
-/**
-* Determines and returns the object code's corresponding mnemonic. A pattern
-* of omitting the last two bits in the second hexadecimal is used to determine 
-* the true opCode to find the correct mnemonic.
-* @param firstHex: The first hexadecimal of the object code.
-* @param secondHex: The second hexadecimal of the obejct code.
-* @return The object code's corresponding mnemonic.
-*/
-std::string get_mnemonic(std::string firstHex, std::string secondHex){
-    std::string opCode;
-    int opIndex = 0;
-    if(secondHex == "0" || secondHex == "1" || secondHex == "2" || secondHex == "3"){
-        opCode = firstHex + "0";
-    }
-    else if(secondHex == "4" || secondHex == "5" || secondHex == "6" || secondHex == "7"){
-        opCode = firstHex + "4";
-    }
-    else if(secondHex == "8" || secondHex == "9" || secondHex == "A" || secondHex == "B"){
-        opCode = firstHex + "8";
-    }
-    else if(secondHex == "C" || secondHex == "D" || secondHex == "E" || secondHex == "F"){
-        opCode = firstHex + "C";
-    }
-
-    for(int i = 0; i < sizeof(g_ops); i++){
-        if(g_ops[i] == opCode){
-            opIndex = i;
-            break;
-        }
-    }
-
-    return g_mnemonics[opIndex];    
-}
-
-
-/**
-* Determines and returns the format of the object code. Excludes format 1 instructions.
-* @param mnemonic: The object code's corresponding instruction.
-* @param thirdHex: The third hexadecimal of the object code.
-* @return The format of the object code.
-*/ 
-int get_format(std::string mnemonic, std::string thirdHex){
-    int format = 0;
-    if(mnemonic == "ADDR" || mnemonic == "CLEAR" || mnemonic == "COMPR" || mnemonic == "MULR" || 
-       mnemonic == "RMO" || mnemonic == "SHIFTL" || mnemonic == "SHIFTR" || mnemonic == "SUBR" ||
-       mnemonic == "SUBR" || mnemonic == "SVC" || mnemonic == "TIXR"){ //Every mnemonic associated with format 2.
-
-       format = 2;    
-    }
-    else if(thirdHex == "0" || thirdHex == "2" || thirdHex == "4" || thirdHex == "6" || thirdHex == "8" ||
-            thirdHex == "A" || thirdHex == "C" || thirdHex == "E"){    // flag bit e = 0
-
-       format = 3;
-    }
-    else{ // Hexadecimals not listed above have a 'e' flag bit value of 1, which indicates a format 4 instruction.
-        format = 4;
-    }
-    return format;
-}
-
-
-/**
-* Determines and returns the addressing mode of for the Operand Value.
-* @param secondHex: The second hexadecimal of the object code. Contains the n and i bits required
-*                   to calculate this specific addressing mode.
-* @return The addressing mode for the Operand Value.
-*/ 
-std::string addr_mode_OP(std::string secondHex){
-    std::string addrOp;
-    if(secondHex == "1" || secondHex == "5" || secondHex == "9" || secondHex == "D"){      // flag bits i = 1, n = 0
-        addrOp = "Immediate";
-    }
-    else if(secondHex == "2" || secondHex == "6" || secondHex == "A" || secondHex == "E"){ // flag bits i = 0, n = 1
-        addrOp = "Indirect";
-    }
-    else{ 
-        addrOp = "Simple";
-    }
-    return addrOp;
-}
-
-
-/**
-* Determines and returns the addressing mode for calculating the Target Address.
-* The pattern of bits provided by the third hexadecimal determines which mode.
-* @param thirdHex: The third hexadecimal of the object code. Contains the b and p bits required
-*                  to calculate this specific addressing mode.
-* @return The addressing mode of for calculating the Target Address.
-*/ 
-std::string addr_mode_TA(std::string thirdHex){
-    std::string addrTA;
-    if(thirdHex == "2" || thirdHex == "3" || thirdHex == "A" || thirdHex == "B"){      // flag bits b = 0, p = 1
-        addrTA = "PC-Relative";
-    }
-    else if(thirdHex == "4" || thirdHex == "5" || thirdHex == "C" || thirdHex == "D"){ // flag bits b = 1, p = 0
-        addrTA = "Base Relative";
-    }
-    else if(thirdHex == "0" || thirdHex == "1" || thirdHex == "8" || thirdHex == "9"){ // flat bits b = 0, p = 0 
-        addrTA = "Direct";
-    }
-    return addrTA;
-}
-
-
-/**
-* Determines if the addressing mode to calculate the Target Address is also Indexed.
-* @param thirdHex: The third hexadecimal of the object code. Contains the x bit required
-*                  to calculate this specific addressing mode.
-* @return True: The addressing mode to calculate the Target Address is also Indexed.
-*         False: The addressing mode to calculate the Target Address is not Indexed.
-*/ 
-bool is_indexed(std::string thirdHex){
-    if(thirdHex == "A" || thirdHex == "B" || thirdHex == "C" || thirdHex == "D" || thirdHex == "8" || thirdHex == "9"){
-        // flag bit x = 1
-        return true;
-    }
-    else{
-        return false;
-    }
-}
-
-
-/**
-* Calculates and returns the Target Address based on the specific conditions of the given parameters.
-* @param format: The format of the object code instruction.
-* @param locAddr: The address of where the instruction is located.
-* @param objCode: The object code.
-* @param addrTA: The addressing mode of how to calculate the Target Address.
-* @param isIndex: Provides whether Indexed addressing must be accounted for or not.
-* @return The Target Address of the object code.
-*/ 
-int get_TA(int format, int locAddr, std::string objCode, std::string addrTA, bool isIndex){
-    int taADDR = 0;
-    int dispOrAddr;
-    if(format == 2){                                                // Format 2 instructions don't have TA's.
-        return 0;
-    }
-    else if(format == 3){                                           // Extracting disp/Addr section from object code.
-        dispOrAddr = std::stoi(objCode.substr(3,3), nullptr, 16);
-        if(dispOrAddr > 2047){                                      // stoi() function always returns unsigned 
-            dispOrAddr = dispOrAddr - 4096;                         // hexadecimal value in decimal. Any decimals 
-        }                                                           // not within [-2048, 2047] must be subtracted by
-    }                                                               // 4096 to store the correct, signed value.
-    else if(format == 4){
-        dispOrAddr = std::stoi(objCode.substr(3,5), nullptr, 16);
-    }
-    
-    if(addrTA == "PC-Relative"){                                    // Altering TA value depending on its addressing mode.
-        taADDR = dispOrAddr + (locAddr + format);
-    }
-    else if(addrTA == "Base Relative"){
-        taADDR = dispOrAddr + g_registerValues[3];
-    }
-    else if(addrTA == "Direct"){
-        taADDR = dispOrAddr;
-    }
-
-    if(isIndex){                                                    // Adds the current value stored in the X register.
-        taADDR = taADDR + g_registerValues[1];
-    }
-
-    return taADDR;
-}
-
-
-/**
-* Determines and returns the operand of the current object code being analyzed based on the given parameters.
-* @param targetAddr: The Target Address of the object code.
-* @param format: The format of the instruction.
-* @param mnemonic: The object code's corresponding instruction.
-* @param objCode: The current object code being analyzed.
-* @param addrOP: The addressing mode for the Operand Value.
-* @param isIndexed: Helps determine whether the value of the register will be added to the Target Address or not.
-* @return The operand of the object code.
-*/ 
-std::string get_operand(int targetAddr, int format, std::string mnemonic, std::string objCode, std::string addrOP, 
-                        bool isIndex){
-    std::string operand;
-    if(format == 2){                                                    // Operand is a register. Program accounts
-        operand = g_registers[stoi(objCode.substr(2,1), nullptr, 16)];  // for CLEAR instructions only.
-        return operand;     
-    }
-    
-    if(format == 3 && three_bits_zero(objCode.substr(2,1))){            // Operand is a constant.
-        int constant = stoi(objCode.substr(3,3), nullptr, 16);
-        operand = std::to_string(constant);
-    }
-    else if(format == 4 && three_bits_zero(objCode.substr(2,1))){
-        int constant = stoi(objCode.substr(3,5), nullptr, 16);
-        operand = std::to_string(constant);
-    }    
-    else{                                                               // Operand is a symbol.
-        operand = (g_symMap.find(targetAddr)->second);
-    }
-
-    if(addrOP == "Immediate"){
-        operand = "#" + operand;
-    }
-    else if(addrOP == "Indirect"){
-        operand = "@" + operand;
-    }
-    else if(addrOP == "Simple"){
-        operand = operand;
-    }
-
-    if(isIndex){
-        operand = operand + ",X";
-    }
-
-    return operand;
-}
-
-
-/**
-* Determines whether the last three bits in the third hexadecimal of the object code are zeros or not.
-* The last three bits in a the third hexadecimal indicates that the operand is a constant. See get_operand().
-* @param thirdHex: The third hexadecimal of the current object code being analyzed.
-* @return True: The last three bits in the hexadecimal are zero.
-          False: The last three bits in the hexadecimal are not all zero.
-*/ 
-bool three_bits_zero(std::string thirdHex){
-    if(thirdHex == "0" || thirdHex == "8"){ // Only hexadecimals where flag bits b, p and e are all zero.
-        return true;
-    }
-    else{
-        return false;
-    }
-}
-
-
-/**
-* Adds a symbol to the list of labels if the current address matches the address where that symbol 
-* is located. If there the current address does not satisfy that condition, there is no label
-* for that specific line of instruction.
-* @param currAddr: The address of the to be disassembled object code.
-*/ 
-void add_label(int currAddr){
-   if(g_symMap.find(currAddr) != g_symMap.end()){ // The current address is associated with a symbol.
-        g_labels.push_back((g_symMap.find(currAddr)->second));
-    }
-    else{
-        g_labels.push_back("");
-    } 
-}
-
-
-/**
-* Inserts lines of instruction for symbols whose addresses are not within the range of a text record in respect
-* to both a text records specified length and the length of the entire program in bytes. The range of which
-* symbols and their address will be added during a specific calling of this function is explained in the
-* find_addr_gap_matches() function. RESW instructions will be used to reserve the number of bytes it takes to
-* get from one address to the next. This is repeated until all symbols within that range have been created a
-* line of instruction.
-* @param endAddr: The ending address of a text record.
-* @param currItr: The current iteration through the text records.
-*/ 
-void fill_gap(int endAddr, int currItr){
-    std::vector<int> matches = find_addr_gap_matches(endAddr, currItr);
-    int currAddr = endAddr;
-    for(int i = 0; i < matches.size() - 1; i++){ 
-        g_programCounter.push_back(currAddr);           
-        add_label(currAddr);                            // Each of the found addresses is associated with a label.
-        g_opCodes.push_back("RESW");
-        int numBytes = (matches[i + 1] - currAddr) / 3; // The number of bytes to reserve.
-        g_operands.push_back(std::to_string(numBytes));
-        g_objectCodes.push_back("");                    
-        currAddr = matches[i + 1];                      // Update the address to the next one in the vector.
-    } 
-}
-
-
-/**
-* Finds, stores, and returns the addresses of symbols not within the range of a text record in respect to
-* its specified length in bytes. Both cases where symbols with addresses between text records and symbols
-* with addresses between the last text record and the entire length of the program are accounted for with
-* both having different matching conditions.
-* @param currAddr: The address the text record leaves off on.
-* @param currItr: The current iteration through the object code records.
-*/ 
-std::vector<int> find_addr_gap_matches(int currAddr, int currItr){
-    std::vector<int> matches;
-
-    if(g_records[currItr + 1].find("T") == 0){ // Next record is a text record.
-       for(const auto& pair : g_symMap){       // Iteration through the map.
-            if(pair.first >= currAddr && pair.first < std::stoi(g_records[currItr + 1].substr(1,6), nullptr, 16)){
-                matches.push_back(pair.first);
-            } 
-        }
-        matches.push_back(std::stoi(g_records[currItr + 1].substr(1,6), nullptr, 16));  
-    }
-    else{                                      // Current record is the last text record.
-        for(const auto& pair : g_symMap){ 
-            if(pair.first >= currAddr && pair.first < std::stoi(g_records[0].substr(13,6), nullptr, 16)){
-                matches.push_back(pair.first);
-            } 
-        }
-        matches.push_back(std::stoi(g_records[0].substr(13,6), nullptr, 16)); // The length of the program in bytes,
-    }                                                                         // extracted from the Header record.
-
-    return matches;
-}
-
-
-/**
-* Loads a specific value into a specific register when a load instruction is detected.
-* @param targetAddr: The target address of the load instruction.
-* @param format: The format of the load instruction. It can be either only format 3 or 4.
-* @param mnemonic: The instruction mnemonic. Used to determine what register is being addressed.
-* @param objCode: The object code of the instruction. 
-*/  
-void load_reg(int targetAddr, int format, std::string mnemonic, std::string objCode){
-    std::string registerName = mnemonic.substr(2,1);
-    int regValIdx = -1;
-    for(int i = 0; i < sizeof(g_registers)/sizeof(g_registers[0]); i++){ // Match register name to its value index.
-        if(registerName == g_registers[i]){
-            regValIdx = i;
-        }
-    }
-
-    if(regValIdx == -1){                                                // Accounts for possible "LDCH" instruction 
-        return;                                                         // passed in, which is not a required case
-    }                                                                   // to address in this implementation.
-
-    if(format == 3 && three_bits_zero(objCode.substr(2,1))){            // Constant is to be stored.
-        int constant = stoi(objCode.substr(3,3), nullptr, 16);
-        g_registerValues[regValIdx] = constant;
-    }
-    else if(format == 4 && three_bits_zero(objCode.substr(2,1))){
-        int constant = stoi(objCode.substr(3,5), nullptr, 16);
-        g_registerValues[regValIdx] = constant;
-    }
-    else{                                                               // Address that references a symbol is stored.
-        g_registerValues[regValIdx] = targetAddr;
-    }
-    
-}
-
-
-/**
-* Clears a specific register if the disassembler detects a CLEAR instruction. 
-* The register being cleared depends on the 2nd bit in the object code.
-* @param objCode: The object code of the CLEAR instruction.
-*/ 
-void clear_reg(std::string objCode){
-    std::string regClear = objCode.substr(2,1);
-    for(int i = 0; i < sizeof(g_registers)/sizeof(g_registers[0]); i++){ // Match register to its corresponding value index.
-        if(regClear == g_registers[i]){
-            g_registerValues[i] = 0;
-            return;
-        }
-    }
-}
-
-
-/**
-* Creates a LTORG instruction when the disassembler detects that the current program counter address matches
-* any address of a literal.
-*/ 
-void add_LTORG(){
-    g_programCounter.push_back(32); // The reason 32 is added is explained in output.cpp.
-    g_labels.push_back("");
-    g_opCodes.push_back("LTORG");
-    g_operands.push_back("");
-    g_objectCodes.push_back("");
-}
-
-
-/**
-* Defines any literal referenced before a detected LTORG instruction was declared. 
-* @param literal: The literal to be added to a line of instruction.
-* @param objCode: The object code of the literal.
-* @param currAddr: The address where the literal is according to the symbol table.
-*/ 
-void add_literal(std::string literal, std::string objCode, int currAddr){
-    g_programCounter.push_back(currAddr);
-    g_labels.push_back("*");
-    g_opCodes.push_back(literal);
-    g_operands.push_back("");
-    g_objectCodes.push_back(objCode);
-}
-
-
-
-
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+#include "disassembler.h"
+#include "output.h"
+
+/**
+* @param texts: The text records of an object file.
+* @return True if they ascend without overlapping.
+*/
+static bool records_in_order(const ArrayView<TextRecord>& texts){
+    for(size_t i = 1; i < texts.size(); i++){
+        if(texts[i - 1].start + texts[i - 1].length > texts[i].start){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+* @param a: A loaded object file.
+* @param b: Another.
+* @return True if they have the same header and end records and their text records cover the same
+*         addresses, so that only their object code may differ.
+*/
+static bool same_layout(const ObjectImage& a, const ObjectImage& b){
+    if(a.header.name != b.header.name || a.header.start != b.header.start || a.header.length != b.header.length ||
+       a.end.firstInstr != b.end.firstInstr || a.texts.size() != b.texts.size()){
+        return false;
+    }
+    for(size_t i = 0; i < a.texts.size(); i++){
+        if(a.texts[i].start != b.texts[i].start || a.texts[i].length != b.texts[i].length){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+* Converts a given object file and its symbol table into assembly language and writes the listing.
+* All state lives in the object and is reset here, so one Disassembler can be reused for many
+* files (keeping its buffers' capacity) and separate Disassemblers can run on separate threads.
+* @param objFile: The object file.
+* @param symTab: The symbol file.
+* @param output: Where and in which format to write the listing.
+* @param error: Receives a description of the failure, if any.
+* @return True if the listing was written.
+*/ 
+bool Disassembler::run(const std::string& objFile, const std::string& symTab, const OutputOptions& output,
+                       std::string& error){
+    RunStats opening;
+    {
+        STAT_TIMER(opening, PHASE_PARSE_OBJ);
+        if(!m_objInput.open(objFile, error)){
+            return false;
+        }
+    }
+    {
+        STAT_TIMER(opening, PHASE_PARSE_SYM);
+        if(!m_symInput.open(symTab, error) ||
+           (is_symbol_index(m_symInput.text()) && !check_index_source(m_symInput.text(), symTab, error))){
+            m_symInput.close();
+            m_objInput.close();
+            return false;
+        }
+    }
+    bool decoded = decode(m_objInput.text(), m_symInput.text(), error, true);
+    m_stats.add(opening);
+    m_objInput.close();
+    if(!decoded){
+        m_symbols.clear();
+        m_symInput.close();
+        error = objFile + ": " + error;
+        return false;
+    }
+    bool written = write(output, error);
+    m_listing.clear();
+    if(m_symbols.is_mapped()){                                          // It points into the file.
+        m_symbols.clear();
+    }
+    m_symInput.close();
+    if(m_image.is_mapped()){
+        m_image.clear();
+    }
+    m_imageInput.close();
+    return written;
+}
+
+
+/**
+* Decodes an object file and its symbol table, held in memory, into the listing.
+* Goes through each object code and deciphers and stores the necessary information
+* for each line. Additional functionalties are included to account for "non-standard"
+* cases such as LTORG and BASE directives, CLEAR, LOAD, and RSUB instructions, and literals.
+* Nothing refers back to the texts afterwards, unless borrowSymbols is set.
+* @param objText: The contents of the object file.
+* @param symText: The contents of the symbol file, or of a precompiled symbol index.
+* @param error: Receives a description of the failure, if any.
+* @param borrowSymbols: Whether symText outlives the use of the symbols, so that a symbol index
+*                       is used in place rather than copied.
+* @return False if the object file (or the symbol index) is malformed.
+*/
+bool Disassembler::decode(std::string_view objText, std::string_view symText, std::string& error,
+                          bool borrowSymbols){
+    if(!load(objText, symText, error, borrowSymbols)){
+        return false;
+    }
+    decode_listing();
+    return true;
+}
+
+
+/**
+* Decodes the loaded program into the listing, from the START directive to the END directive.
+*/
+void Disassembler::decode_listing(){
+    int currAddr = m_image.header.start;                                // Starting address of the object file.
+    {
+        STAT_TIMER(m_stats, PHASE_GAPS);
+        add_line(m_listing, LINE_START, currAddr).value = currAddr;     // Name of the program comes from the header.
+        plan_gaps(m_image, m_symbols, m_gaps);
+        size_t nextGap = 0;
+        fill_gap(m_listing, GAP_LEADING, nextGap, m_stats.counters);
+    }
+    {
+        STAT_TIMER(m_stats, PHASE_DECODE);
+        decode_texts();
+        add_sections();
+    }
+    {
+        STAT_TIMER(m_stats, PHASE_REGISTERS);                           // Target addresses that depend on the B and X
+        build_flow();                                                   // registers are completed afterwards, along
+        reset_registers();                                              // the jumps where they can be followed.
+        m_unresolved = 0;
+        resolve_registers(m_listing);
+        report_unresolved();
+        ListingLine& end = add_line(m_listing, LINE_END, m_image.end.firstInstr);
+        end.value = m_image.end.firstInstr;
+        end.operand = add_label(m_image.end.firstInstr, m_stats.counters);
+    }
+    if(m_buildXref){
+        STAT_TIMER(m_stats, PHASE_XREF);
+        m_xref.build(m_listing);
+    }
+    else{
+        m_xref.clear();
+    }
+    STAT_ADD(m_stats.counters, STAT_LINES, m_listing.size());
+}
+
+
+/**
+* Loads an object file and its symbol table, held in memory, ready for decode_range(). The
+* listing is left empty. An object file of several control sections is linked (see load_linked()).
+* @param objText: The contents of the object file.
+* @param symText: The contents of the symbol file, or of a precompiled symbol index.
+* @param error: Receives a description of the failure, if any.
+* @param borrowSymbols: Whether symText outlives the use of the symbols, as for decode().
+* @return False if the object file (or the symbol index) is malformed.
+*/
+bool Disassembler::load(std::string_view objText, std::string_view symText, std::string& error,
+                        bool borrowSymbols){
+    if(has_control_sections(objText)){
+        return load_linked(std::vector<std::string_view>{objText}, std::vector<std::string_view>{symText}, error);
+    }
+    m_stats.clear();
+    m_image.clear();
+    m_imageInput.close();
+    m_symbols.clear();
+    m_listing.clear();
+    m_checkpoints.clear();
+    m_flow.clear();
+    m_sectionStarts.clear();
+    m_externalRefs.clear();
+    m_linked = false;
+    {
+        STAT_TIMER(m_stats, PHASE_PARSE_OBJ);
+        if(!load_image(objText, error)){
+            return false;
+        }
+    }
+    {
+        STAT_TIMER(m_stats, PHASE_PARSE_SYM);
+        if(!load_symbols(symText, borrowSymbols, error)){
+            return false;
+        }
+    }
+    count_loaded(1);
+    return true;
+}
+
+
+/**
+* Links object files of one or more control sections into one program and decodes it into the
+* listing, as decode() does a single object file. Nothing refers back to the texts afterwards.
+* @param objTexts: The contents of the object files, in link order.
+* @param symTexts: The contents of their symbol files, in the same order.
+* @param error: Receives a description of the failure, if any.
+* @return False if the object files cannot be linked.
+*/
+bool Disassembler::decode_linked(const std::vector<std::string_view>& objTexts,
+                                 const std::vector<std::string_view>& symTexts, std::string& error){
+    if(!load_linked(objTexts, symTexts, error)){
+        return false;
+    }
+    decode_listing();
+    return true;
+}
+
+
+/**
+* Links object files into one program (see Linker) and loads their symbol files against it, ready
+* for decode_listing() or decode_range(). Each symbol file lists the symbols of its object file's
+* control sections as add_symbols() reads them, and they go in first, so their labels win the
+* addresses they share with anything else. The symbols that define records export come next and the
+* names of the sections after the first last, so each only names an address the ones before leave
+* unnamed; every section's CSECT line carries its own name regardless. A Format 4 instruction whose
+* address a modification record adds an exported symbol to names that symbol, whatever else shares
+* its address. Everything goes into one symbol index, built once; the threads decoding the listing
+* only read it.
+* @param objTexts: The contents of the object files, in link order.
+* @param symTexts: The contents of their symbol files, in the same order.
+* @param error: Receives a description of the failure, if any.
+* @return False if the object files cannot be linked, or a symbol file is a precompiled index.
+*/
+bool Disassembler::load_linked(const std::vector<std::string_view>& objTexts,
+                               const std::vector<std::string_view>& symTexts, std::string& error){
+    m_stats.clear();
+    m_image.clear();
+    m_imageInput.close();
+    m_symbols.clear();
+    m_listing.clear();
+    m_checkpoints.clear();
+    m_flow.clear();
+    m_sectionStarts.clear();
+    m_externalRefs.clear();
+    m_linked = true;
+    if(objTexts.empty() || objTexts.size() != symTexts.size()){
+        error = "every object file needs a symbol file";
+        return false;
+    }
+    {
+        STAT_TIMER(m_stats, PHASE_PARSE_OBJ);
+        if(!m_linker.scan(objTexts, error)){
+            return false;
+        }
+        int threads = m_threads > 0 ? m_threads : int(std::max(1u, std::thread::hardware_concurrency()));
+        if(!m_linker.load(m_image, m_linker.length() >= MIN_PARALLEL_BYTES ? threads : 1, error)){
+            return false;
+        }
+    }
+    {
+        STAT_TIMER(m_stats, PHASE_PARSE_SYM);
+        for(size_t i = 0; i < symTexts.size(); i++){
+            if(is_symbol_index(symTexts[i])){
+                error = "a symbol index cannot be relocated; link with the symbol file";
+                return false;
+            }
+            add_symbols(symTexts[i], m_symbols, m_linker.offsets(i));
+        }
+        const auto& externals = m_linker.externals().entries();
+        std::vector<uint32_t> externalIds(externals.size());                // Symbol id of each.
+        for(size_t e = 0; e < externals.size(); e++){                       // The first is the program's START.
+            if(e == 0 || !externals[e].section){
+                externalIds[e] = m_symbols.add(externals[e].name, externals[e].address, SYMBOL_LABEL);
+            }
+        }
+        for(size_t e = 1; e < externals.size(); e++){
+            if(externals[e].section){
+                externalIds[e] = m_symbols.add(externals[e].name, externals[e].address, SYMBOL_LABEL);
+                m_sectionStarts.push_back(SectionStart{externals[e].address, externalIds[e]});
+            }
+        }
+        std::vector<uint32_t> byName(externals.size());                     // Indexes of the externals, by name.
+        for(uint32_t e = 0; e < byName.size(); e++){
+            byName[e] = e;
+        }
+        std::sort(byName.begin(), byName.end(), [&](uint32_t a, uint32_t b){
+            return externals[a].name < externals[b].name;
+        });
+        for(const ModRecord& mod : m_image.mods){
+            if(mod.sign != '+' || mod.halfBytes != 5){                      // Only a Format 4 address names its target.
+                continue;
+            }
+            std::string_view name(mod.symbol, sizeof(mod.symbol));
+            name = name.substr(0, name.find(' '));
+            auto found = std::lower_bound(byName.begin(), byName.end(), name, [&](uint32_t e, std::string_view n){
+                return externals[e].name < n;
+            });
+            if(found != byName.end() && externals[*found].name == name){
+                m_externalRefs.push_back(ExternalRef{mod.addr - 1, externalIds[*found], externals[*found].address});
+            }
+        }
+        std::sort(m_externalRefs.begin(), m_externalRefs.end(), [](const ExternalRef& a, const ExternalRef& b){
+            return a.address < b.address;
+        });
+        m_symbols.build();
+    }
+    count_loaded(m_linker.sections().size());
+    return true;
+}
+
+
+/**
+* Counts what load() or load_linked() loaded.
+* @param sections: The control sections of the program.
+*/
+void Disassembler::count_loaded(size_t sections){
+    STAT_ADD(m_stats.counters, STAT_RECORDS, m_image.texts.size() + m_image.mods.size() + m_image.hasHeader +
+                                             m_image.hasEnd);
+    STAT_ADD(m_stats.counters, STAT_TEXT_RECORDS, m_image.texts.size());
+    STAT_ADD(m_stats.counters, STAT_MOD_RECORDS, m_image.mods.size());
+    STAT_ADD(m_stats.counters, STAT_SECTIONS, sections);
+    STAT_ADD(m_stats.counters, STAT_SYMBOLS, m_symbols.size());
+}
+
+
+/**
+* Brings the listing of the last decode() up to date with a new version of the same object file.
+* When its records lie where they did, only the text records whose object code changed are decoded
+* again, each from where the last literal pool ended going into it (and the next one, if that
+* moved); the lines of the others are kept, put back to the Target Addresses decode_record() gave
+* them. The B and X registers are then resolved again over the whole listing, as one changed load
+* can move operands anywhere its value flows. Anything else is decoded in full. The symbols are
+* kept: a new symbol file needs decode(), as does a linked program, whose symbols move with its
+* control sections.
+* @param objText: The contents of the object file.
+* @param edits: Receives the runs of lines that changed, in listing order; none if nothing did.
+* @param error: Receives a description of the failure, if any.
+* @return False if the object file is malformed or linked; the listing is then left as it was.
+*/
+bool Disassembler::update(std::string_view objText, std::vector<ListingEdit>& edits, std::string& error){
+    m_stats.clear();
+    edits.clear();
+    if(m_linked || has_control_sections(objText)){
+        error = "a program of several control sections is only decoded in full";
+        return false;
+    }
+    {
+        STAT_TIMER(m_stats, PHASE_PARSE_OBJ);
+        m_nextImage.clear();
+        if(!parse_obj(objText, m_nextImage, error)){
+            return false;
+        }
+    }
+    std::swap(m_image, m_nextImage);                                    // Keeps the old image to compare with.
+    std::swap(m_listing, m_prevListing);
+    m_listing.clear();
+    m_checkpoints.clear();
+    const ObjectImage& prevImage = m_nextImage;
+    const Listing& prev = m_prevListing;
+    if(prev.empty() || !same_layout(prevImage, m_image) || !records_in_order(m_image.texts)){
+        decode_listing();
+        edits.push_back(ListingEdit{0, prev.size(), 0, m_listing.size()});
+        m_imageInput.close();                                           // The cached image it was loaded from.
+        return true;
+    }
+
+    std::vector<ListingEdit> decoded;                                   // The records decoded again, in order.
+    {
+        STAT_TIMER(m_stats, PHASE_DECODE);
+        size_t line = 0;
+        uint32_t prevLiteralEnd = 0;                                    // Where the last literal pool ended, in
+        uint32_t literalEnd = 0;                                        // the old listing and in the new one.
+        m_listing.reserve(prev.size());
+        auto copy_lines = [&](size_t last){
+            size_t copied = m_listing.size();
+            m_listing.insert(m_listing.end(), prev.begin() + line, prev.begin() + last);
+            line = last;
+            for(size_t i = copied; i < m_listing.size(); i++){
+                ListingLine& copy = m_listing[i];
+                if(copy.kind == LINE_LITERAL){
+                    prevLiteralEnd = literalEnd = copy.address + copy.length;
+                }
+                else if(copy.kind == LINE_BASE){                        // Right after its LDB.
+                    copy.value = raw_target(m_listing[i - 1]);
+                    copy.operand = add_label(copy.value, m_stats.counters);
+                }
+                else if(copy.kind == LINE_INSTRUCTION && uses_registers(copy.flags) &&
+                        g_operandKinds[copy.mnemonic] == OPERAND_MEMORY && !has_constant_operand(copy.flags)){
+                    copy.value = raw_target(copy);                      // Resolved again below.
+                    copy.operand = NO_SYMBOL;
+                }
+            }
+        };
+        for(const TextRecord& text : m_image.texts){
+            uint32_t endAddr = text.start + text.length;
+            size_t first = line;                                        // Past the START line and the gaps.
+            while(first < prev.size() && (prev[first].kind == LINE_START || prev[first].kind == LINE_RESW ||
+                                          prev[first].kind == LINE_RESB)){
+                first++;
+            }
+            size_t last = first;                                        // An LTORG goes with the literal after it.
+            while(last < prev.size() && prev[last].kind != LINE_END && prev[last].kind != LINE_RESW &&
+                  prev[last].kind != LINE_RESB && prev[last + (prev[last].kind == LINE_LTORG)].address < endAddr){
+                last++;
+            }
+            copy_lines(first);
+            if(literalEnd == prevLiteralEnd &&
+               std::memcmp(prevImage.at(text.start), m_image.at(text.start), text.length) == 0){
+                copy_lines(last);
+                continue;
+            }
+            for(; line < last; line++){
+                if(prev[line].kind == LINE_LITERAL){
+                    prevLiteralEnd = prev[line].address + prev[line].length;
+                }
+            }
+            DecodeChunk state;
+            state.literalEnd = literalEnd;
+            size_t newFirst = m_listing.size();
+            decode_record(text, state, m_listing);
+            STAT_MERGE(m_stats.counters, state.counters);
+            STAT_ADD(m_stats.counters, STAT_REDECODED, 1);
+            literalEnd = state.literalEnd;
+            decoded.push_back(ListingEdit{first, last, newFirst, m_listing.size()});
+        }
+        copy_lines(prev.size());                                        // The last gaps and the END directive.
+    }
+    {
+        STAT_TIMER(m_stats, PHASE_REGISTERS);
+        build_flow();
+        reset_registers();
+        m_unresolved = 0;
+        resolve_registers(m_listing);
+        report_unresolved();
+    }
+    m_imageInput.close();
+
+    auto same = [&](size_t prevLine, size_t line){                      // Object code is rendered from the image.
+        const ListingLine& before = prev[prevLine];
+        return std::memcmp(&before, &m_listing[line], sizeof(ListingLine)) == 0 &&
+               std::memcmp(prevImage.bytes.data() + before.objOffset, m_image.bytes.data() + before.objOffset,
+                           before.length) == 0;
+    };
+    auto add_edit = [&](const ListingEdit& edit){
+        if(!edits.empty() && edits.back().oldLast == edit.oldFirst && edits.back().newLast == edit.newFirst){
+            edits.back().oldLast = edit.oldLast;
+            edits.back().newLast = edit.newLast;
+        }
+        else{
+            edits.push_back(edit);
+        }
+    };
+    size_t prevLine = 0;                                                // Lines between the records decoded again
+    size_t line = 0;                                                    // match one for one.
+    auto compare_up_to = [&](size_t prevEnd){
+        while(prevLine < prevEnd){
+            if(same(prevLine, line)){
+                prevLine++;
+                line++;
+                continue;
+            }
+            ListingEdit edit{prevLine, prevLine, line, line};
+            while(prevLine < prevEnd && !same(prevLine, line)){
+                edit.oldLast = ++prevLine;
+                edit.newLast = ++line;
+            }
+            add_edit(edit);
+        }
+    };
+    for(ListingEdit edit : decoded){                                    // Without the lines that came out the same.
+        compare_up_to(edit.oldFirst);
+        while(edit.oldFirst < edit.oldLast && edit.newFirst < edit.newLast && same(edit.oldFirst, edit.newFirst)){
+            edit.oldFirst++;
+            edit.newFirst++;
+        }
+        while(edit.oldFirst < edit.oldLast && edit.newFirst < edit.newLast &&
+              same(edit.oldLast - 1, edit.newLast - 1)){
+            edit.oldLast--;
+            edit.newLast--;
+        }
+        if(edit.oldFirst < edit.oldLast || edit.newFirst < edit.newLast){
+            add_edit(edit);
+        }
+        prevLine = edit.oldLast;
+        line = edit.newLast;
+    }
+    compare_up_to(prev.size());
+
+    if(m_buildXref){
+        STAT_TIMER(m_stats, PHASE_XREF);
+        m_xref.build(m_listing);
+    }
+    STAT_ADD(m_stats.counters, STAT_LINES, m_listing.size());
+    return true;
+}
+
+
+/**
+* Decodes the part of the loaded program from one address to another into the listing: the lines
+* a full decode() would list at those addresses, in the same order, without the START and END
+* directives. Only the text records overlapping the range are decoded. Each starts from its
+* checkpoint, the register and literal pool state a full decode would carry into it, which a
+* light scan of every record works out the first time, along with the register flow analysis;
+* later ranges reuse both, so a window of a large program costs a binary search and the records
+* in it.
+* @param start: The first address of the range.
+* @param end: The last address of the range.
+*/
+void Disassembler::decode_range(uint32_t start, uint32_t end){
+    const ArrayView<TextRecord>& texts = m_image.texts;
+    size_t numTexts = texts.size();
+    m_listing.clear();
+    m_unresolved = 0;
+    if(m_checkpoints.empty()){
+        STAT_TIMER(m_stats, PHASE_REGISTERS);
+        m_textsInOrder = records_in_order(texts);
+        scan_texts();
+    }
+    size_t first = 0;                                                   // Records out of order are all checked.
+    size_t last = numTexts;
+    if(m_textsInOrder){                                                 // From the record the range starts in (or
+        auto after = [&](uint32_t addr){                                // in the gap after) to the last one starting
+            return std::upper_bound(texts.begin(), texts.end(), addr, [](uint32_t a, const TextRecord& text){
+                return a < text.start;                                  // in it.
+            }) - texts.begin();
+        };
+        first = std::max<size_t>(after(start), 1) - 1;
+        last = after(end);
+    }
+
+    STAT_TIMER(m_stats, PHASE_DECODE);
+    GapPlanner planner(m_symbols, NO_ADDRESS);                          // The first gap searches for its symbols.
+    GapList& regions = m_gaps;
+    auto pick = [&](const Listing& lines){
+        for(size_t i = 0; i < lines.size(); i++){                       // An LTORG goes with the literal after it.
+            const ListingLine& line = lines[i + (lines[i].kind == LINE_LTORG && i + 1 < lines.size())];
+            if(line.kind != LINE_LTORG && line.address >= start && line.address <= end){
+                m_listing.push_back(lines[i]);
+            }
+        }
+    };
+    auto add_gaps = [&](int after, uint32_t lo, uint32_t hi){
+        regions.clear();
+        if(lo <= end && hi > start){
+            planner.plan(after, lo, hi, regions);
+        }
+        m_rangeLines.clear();
+        for(const GapRegion& gap : regions){
+            add_gap(m_rangeLines, gap, m_stats.counters);
+        }
+        pick(m_rangeLines);
+    };
+
+    uint32_t programEnd = m_image.end_addr();
+    if(first == 0){
+        add_gaps(GAP_LEADING, m_image.header.start, numTexts ? texts[0].start : programEnd);
+    }
+    for(size_t i = first; i < last; i++){
+        const TextRecord& text = texts[i];
+        uint32_t next = i + 1 < numTexts ? texts[i + 1].start : programEnd;
+        if(text.start > end || std::max(text.start + text.length, next) <= start){
+            continue;
+        }
+        const RecordCheckpoint& checkpoint = m_checkpoints[i];
+        DecodeChunk state;
+        state.literalEnd = checkpoint.literalEnd;
+        reset_registers();
+        m_registerValues[1] = checkpoint.index;
+        m_registerValues[3] = checkpoint.base;
+        m_rangeLines.clear();
+        decode_record(text, state, m_rangeLines);
+        resolve_registers(m_rangeLines);
+        STAT_MERGE(m_stats.counters, state.counters);
+        pick(m_rangeLines);
+        add_gaps(i, text.start + text.length, next);
+    }
+    report_unresolved();
+    if(m_buildXref){
+        m_xref.build(m_listing);
+    }
+    STAT_ADD(m_stats.counters, STAT_LINES, m_listing.size());
+}
+
+
+/**
+* Writes the listing of the last decode(), rendering large listings on the decoding threads.
+* @param output: Where and in which format to write the listing.
+* @param error: Receives a description of the failure, if any.
+* @return True if the listing was written.
+*/
+bool Disassembler::write(const OutputOptions& output, std::string& error){
+    STAT_TIMER(m_stats, PHASE_OUTPUT);
+    return create_output(m_listing, m_image, m_symbols, output, error, m_threads, &m_outputChunks);
+}
+
+
+/**
+* Writes the cross-reference index of the last decode(), which must have been built.
+* @param path: The file to write (see XrefHeader), or "-" for stdout.
+* @param error: Receives a description of the failure, if any.
+* @return True if the file was written.
+*/
+bool Disassembler::write_xref(const std::string& path, std::string& error) const {
+    return m_xref.write(path, m_listing, m_symbols, m_image.header.name, error);
+}
+
+
+/**
+* Decodes every text record into the listing. Large programs are split into chunks of
+* consecutive text records of about the same size, which are decoded on separate threads and
+* then joined in order. Chunks are decoded without knowing what came before them: operands that
+* depend on register values are left for resolve_registers(), and the LTORG before a chunk's first
+* literal pool is dropped when joining if the previous chunk's last pool runs straight into it.
+* A single chunk goes through the same code, so the listing doesn't depend on the thread count.
+*/
+void Disassembler::decode_texts(){
+    size_t numTexts = m_image.texts.size();
+    int threads = m_threads > 0 ? m_threads : int(std::max(1u, std::thread::hardware_concurrency()));
+    size_t numChunks = 1;
+    if(threads > 1 && m_image.bytes.size() >= MIN_PARALLEL_BYTES){
+        numChunks = std::min(numTexts, size_t(threads) * CHUNKS_PER_THREAD);
+    }
+    if(numChunks <= 1){
+        DecodeChunk whole;
+        whole.firstText = 0;
+        whole.lastText = numTexts;
+        whole.literalEnd = 0;
+        decode_chunk(whole, m_listing);
+        STAT_MERGE(m_stats.counters, whole.counters);
+        return;
+    }
+
+    uint64_t totalBytes = 0;
+    for(const TextRecord& text : m_image.texts){
+        totalBytes += text.length;
+    }
+    m_chunks.resize(numChunks);
+    size_t first = 0;
+    uint64_t bytes = 0;
+    for(size_t c = 0; c < numChunks; c++){                              // Cut where the running byte count passes
+        DecodeChunk& chunk = m_chunks[c];                               // the next multiple of total / numChunks.
+        chunk.firstText = first;
+        while(first < numTexts && (c + 1 == numChunks || bytes * numChunks < totalBytes * (c + 1))){
+            bytes += m_image.texts[first++].length;
+        }
+        chunk.lastText = first;
+        chunk.literalEnd = NO_ADDRESS;
+        chunk.lines.clear();
+        chunk.counters = StatCounters();
+    }
+
+    std::atomic<size_t> nextChunk(0);
+    auto worker = [&](){
+        size_t c;
+        while((c = nextChunk++) < numChunks){
+            decode_chunk(m_chunks[c], m_chunks[c].lines);
+        }
+    };
+    std::vector<std::thread> pool;
+    for(int i = 1; i < threads && size_t(i) < numChunks; i++){
+        pool.emplace_back(worker);
+    }
+    worker();
+    for(std::thread& thread : pool){
+        thread.join();
+    }
+
+    uint32_t literalEnd = 0;
+    for(const DecodeChunk& chunk : m_chunks){
+        for(size_t i = 0; i < chunk.lines.size(); i++){
+            if(i != chunk.firstLtorg || chunk.firstLtorgAddr != literalEnd){
+                m_listing.push_back(chunk.lines[i]);
+                STAT_ADD(m_stats.counters, STAT_LTORGS, i == chunk.firstLtorg);
+            }
+        }
+        STAT_MERGE(m_stats.counters, chunk.counters);
+        if(chunk.literalEnd != NO_ADDRESS){
+            literalEnd = chunk.literalEnd;
+        }
+    }
+}
+
+
+/**
+* Puts a CSECT line where each control section after the first starts in a linked program, before
+* the first line at or past its address, moving the lines after it up in place. The line it comes
+* before loses its label if that is the section's name, which the CSECT line now carries; a label of
+* its own stays.
+*/
+void Disassembler::add_sections(){
+    size_t count = m_sectionStarts.size();
+    if(count == 0){
+        return;
+    }
+    size_t from = m_listing.size();
+    m_listing.resize(from + count);
+    size_t to = m_listing.size();
+    for(size_t s = count; s-- > 0;){
+        const SectionStart& section = m_sectionStarts[s];
+        while(from > 1){                                                // Never above the START line.
+            const ListingLine& line = m_listing[from - 1];              // An LTORG goes with the pool after it.
+            if((line.kind == LINE_LTORG && to < m_listing.size() ? m_listing[to] : line).address < section.address){
+                break;
+            }
+            m_listing[--to] = m_listing[--from];
+        }
+        if(to < m_listing.size() && m_listing[to].address == section.address && m_listing[to].label == section.name){
+            m_listing[to].label = NO_SYMBOL;
+        }
+        uint32_t offset = section.address - m_image.header.start;
+        m_listing[--to] = ListingLine{section.address, section.name, NO_SYMBOL, 0, offset, LINE_CSECT, MN_INVALID, 0, 0};
+    }
+}
+
+
+/**
+* Decodes a run of consecutive text records, with the reserved regions that follow them.
+* @param chunk: The text records to decode and the literal pool state coming into them (NO_ADDRESS
+*               if unknown). Receives the state going out and where the first LTORG went.
+* @param listing: The lines are appended here.
+*/
+void Disassembler::decode_chunk(DecodeChunk& chunk, Listing& listing){
+    chunk.firstLtorg = NO_LINE;
+    size_t nextGap = std::partition_point(m_gaps.begin(), m_gaps.end(), [&](const GapRegion& gap){
+        return gap.after < int(chunk.firstText);
+    }) - m_gaps.begin();
+
+    for(size_t i = chunk.firstText; i < chunk.lastText; i++){           // Iteration through each text record.
+        decode_record(m_image.texts[i], chunk, listing);
+        fill_gap(listing, i, nextGap, chunk.counters);
+    }
+}
+
+
+/**
+* Decodes the object code of one text record, which must lie in the current image.
+* @param text: The text record.
+* @param chunk: The literal pool state coming into the record, and going out of it; also receives
+*               where the first LTORG went if the state coming in is unknown, and the counts.
+* @param listing: The lines are appended here.
+*/
+void Disassembler::decode_record(const TextRecord& text, DecodeChunk& chunk, Listing& listing){
+    uint32_t literalEnd = chunk.literalEnd;                             // Address just past the last literal defined.
+    uint32_t currAddr = text.start;                                     // Starting address of the text record.
+    uint32_t endAddr = text.start + text.length;
+    while(currAddr < endAddr){                                          // Iteration through object codes up to 
+                                                                        // the last byte of the text record.
+        if(is_literal(currAddr)){                                       // Checking for literals.
+            if(literalEnd == NO_ADDRESS){                               // Whether the LTORG stays is decided when
+                chunk.firstLtorg = listing.size();                      // the chunks are joined.
+                chunk.firstLtorgAddr = currAddr;
+            }
+            if(currAddr != literalEnd){                                 // A pool split across text records
+                add_LTORG(listing);                                     // only gets one LTORG directive.
+                STAT_ADD(chunk.counters, STAT_LTORGS, literalEnd != NO_ADDRESS);
+            }
+            while(currAddr < endAddr && is_literal(currAddr)){          // Accounts for literal(s) being called
+                uint32_t lit = m_symbols.find(currAddr);                // before the LTORG directive was used.
+                int bytes = literal_length(lit, endAddr - currAddr);
+                add_literal(listing, lit, currAddr, bytes);
+                STAT_ADD(chunk.counters, STAT_LITERALS, 1);
+                currAddr = currAddr + bytes;
+            }
+            literalEnd = currAddr;
+            continue;
+        }
+
+        Instruction instr;
+        int format = decode_instruction(m_image.at(currAddr), endAddr - currAddr, instr);
+        if(format == 0){                                                // Instruction runs past the end of the record;
+            instr = Instruction{MN_INVALID, 1, OPERAND_BYTE, 0, 0, 0, *m_image.at(currAddr)};
+            format = 1;                                                 // its bytes are listed one by one.
+            STAT_ADD(chunk.counters, STAT_TRUNCATED, 1);
+        }
+        else{
+            STAT_ADD(chunk.counters, STAT_FORMAT1 + format - 1, 1);
+        }
+        int targetAddr = get_TA(instr, currAddr);
+
+        ListingLine& line = add_line(listing, LINE_INSTRUCTION, currAddr);
+        line.label = add_label(currAddr, chunk.counters);
+        line.mnemonic = instr.mnemonic;
+        line.length = format;
+        line.flags = instr.flags;
+        line.objOffset = currAddr - m_image.header.start;
+        set_operand(line, instr, targetAddr, chunk.counters);
+        if(format == 4 && !m_externalRefs.empty() && line.operand != NO_SYMBOL){
+            line.operand = external_operand(currAddr, targetAddr, line.operand);
+        }
+
+        if(instr.mnemonic == MN_LDB){                                   // The instruction is LOAD BASE.
+            ListingLine& base = add_line(listing, LINE_BASE, currAddr);
+            base.value = targetAddr;
+            base.operand = add_label(targetAddr, chunk.counters);
+            STAT_ADD(chunk.counters, STAT_BASES, 1);
+        }
+
+        currAddr = currAddr + format;                                   // Next iteration starts at the first byte
+    }                                                                   // of the next object code.
+    chunk.literalEnd = literalEnd;
+}
+
+
+/**
+* Walks listing lines in order, tracking the registers loaded by the load instructions and CLEAR,
+* and completes the Target Addresses of the instructions that are base-relative or indexed
+* (and the BASE directive following such a LDB). Where the flow analysis knows what B or X holds
+* on every path to an instruction, that value is used. Where paths reach it with different values
+* the operand is left as its displacement and counted in m_unresolved, as no one value is right;
+* code no known path reaches takes the one left by the lines before it. A streamed listing follows
+* the registers with m_forward instead. Those registers carry over from the previous call until
+* reset_registers(), so a listing can be resolved a piece at a time.
+* @param listing: The next lines of the listing.
+*/
+void Disassembler::resolve_registers(Listing& listing){
+    int baseTA = m_baseTA;
+    bool resolvedBase = m_resolvedBase;
+    bool unresolvedBase = m_unresolvedBase;
+    uint32_t block = NO_BLOCK;                                          // Of the last line looked up in m_flow.
+    for(ListingLine& line : listing){
+        if(line.kind == LINE_BASE){
+            if(resolvedBase){
+                line.value = baseTA;
+                line.operand = add_label(baseTA, m_stats.counters);
+            }
+            else if(unresolvedBase){
+                line.value = baseTA;
+                line.operand = NO_SYMBOL;
+                line.flags = FLAG_UNRESOLVED;
+            }
+            continue;
+        }
+        if(line.kind != LINE_INSTRUCTION){
+            continue;
+        }
+        RegisterState streamed{0, 0, 0};
+        if(m_streaming){
+            streamed = m_forward.reach(line.address);
+            m_forward.step(line);
+        }
+        if(line.mnemonic == MN_CLEAR){                                  // Checking for specific instructions.
+            clear_reg(line.value >> 4);
+            continue;
+        }
+        if(g_operandKinds[line.mnemonic] != OPERAND_MEMORY){
+            continue;
+        }
+
+        int loaded = line.value;                                        // What the lines before would load.
+        resolvedBase = uses_registers(line.flags);
+        unresolvedBase = false;
+        if(resolvedBase){
+            RegisterState known = streamed;
+            if(!m_flow.empty()){
+                block = m_flow.find(line.address, block);
+                known = m_flow.state_at(line.address, block);
+            }
+            bool followed = true;                                       // Whether the flow analysis knew them all.
+            baseTA = line.value;                                        // Without the registers yet.
+            if(target_mode(line.flags) == TA_BASE_RELATIVE){
+                followed = known.known & REG_KNOWN_BASE;
+                baseTA = baseTA + (followed ? known.base : m_registerValues[3]);
+                loaded = loaded + m_registerValues[3];
+            }
+            if(line.flags & FLAG_X){                                    // Adds the value stored in the X register.
+                bool knownIndex = known.known & REG_KNOWN_INDEX;
+                baseTA = baseTA + (knownIndex ? known.index : m_registerValues[1]);
+                loaded = loaded + m_registerValues[1];
+                followed = followed && knownIndex;
+            }
+            if(has_constant_operand(line.flags)){
+                loaded = line.value;
+            }
+            else if((known.known & REG_REACHED) && !followed){
+                baseTA = line.value;                                    // Left as the displacement.
+                line.flags |= FLAG_UNRESOLVED;
+                resolvedBase = false;
+                unresolvedBase = true;
+                m_unresolved++;
+            }
+            else{
+                if(m_streaming && (!(known.known & REG_REACHED) || baseTA != loaded)){
+                    m_forward.note_operand(line.address);               // A jump back may yet change it.
+                }
+                line.value = baseTA;
+                line.operand = add_label(baseTA, m_stats.counters);
+                STAT_ADD(m_stats.counters, STAT_FOLLOWED_OPERANDS, followed);
+            }
+        }
+        load_reg(line.mnemonic, loaded);
+    }
+    m_baseTA = baseTA;
+    m_resolvedBase = resolvedBase;
+    m_unresolvedBase = unresolvedBase;
+}
+
+
+/**
+* Says in m_warning how many operands resolve_registers() left as their displacement, if any.
+*/
+void Disassembler::report_unresolved(){
+    m_warning.clear();
+    if(m_unresolved > 0){
+        m_warning = std::to_string(m_unresolved) + (m_unresolved == 1 ? " base-relative or indexed operand is"
+                    : " base-relative or indexed operands are") + " left as a displacement, as B or X differs"
+                    " between the paths reaching it";
+    }
+}
+
+
+/**
+* Cuts the instructions of the listing into basic blocks and works out what B and X hold going
+* into each, for resolve_registers().
+*/
+void Disassembler::build_flow(){
+    m_flow.clear();
+    for(const ListingLine& line : m_listing){
+        if(line.kind == LINE_INSTRUCTION){
+            m_flow.add(line);
+        }
+    }
+    m_flow.solve(m_image.end.firstInstr);
+    STAT_ADD(m_stats.counters, STAT_BLOCKS, m_flow.size());
+}
+
+
+/**
+* Scans every text record for its checkpoint, and feeds the instructions to the flow analysis
+* as build_flow() would from the listing.
+*/
+void Disassembler::scan_texts(){
+    RecordCheckpoint state{0, 0, 0};                                    // As decode() starts.
+    m_checkpoints.clear();
+    m_flow.clear();
+    for(const TextRecord& text : m_image.texts){
+        m_checkpoints.push_back(state);
+        scan_record(text, state);
+    }
+    m_flow.solve(m_image.end.firstInstr);
+    STAT_ADD(m_stats.counters, STAT_BLOCKS, m_flow.size());
+}
+
+
+/**
+* Follows a text record as decode_record() and resolve_registers() would, but only as far as the
+* B and X registers and the literal pools go: nothing is listed, and symbols are only looked up
+* where the literal table has an entry. Each instruction is added to the flow analysis.
+* @param text: The text record.
+* @param state: The state going into the record; receives the state going out of it.
+*/
+void Disassembler::scan_record(const TextRecord& text, RecordCheckpoint& state){
+    const SymbolTable& literals = m_symbols.literals();
+    size_t nextLiteral = literals.lower_bound(text.start);
+    uint32_t currAddr = text.start;
+    uint32_t endAddr = text.start + text.length;
+    while(currAddr < endAddr){
+        while(nextLiteral < literals.size() && literals.addresses[nextLiteral] < currAddr){
+            nextLiteral++;
+        }
+        if(nextLiteral < literals.size() && literals.addresses[nextLiteral] == currAddr && is_literal(currAddr)){
+            while(currAddr < endAddr && is_literal(currAddr)){
+                currAddr += literal_length(m_symbols.find(currAddr), endAddr - currAddr);
+            }
+            state.literalEnd = currAddr;
+            continue;
+        }
+        Instruction instr;
+        int format = decode_instruction(m_image.at(currAddr), endAddr - currAddr, instr);
+        ListingLine line{currAddr, NO_SYMBOL, NO_SYMBOL, 0, 0, LINE_INSTRUCTION, instr.mnemonic, uint8_t(format),
+                         instr.flags};
+        if(format == 0){                                                // Listed byte by byte.
+            line.mnemonic = MN_INVALID;
+            line.length = 1;
+            m_flow.add(line);
+            currAddr++;
+            continue;
+        }
+        if(instr.operand == OPERAND_MEMORY){                            // As set_operand() leaves it.
+            line.value = has_constant_operand(instr.flags) ? instr.field : get_TA(instr, currAddr);
+        }
+        else if(instr.operand != OPERAND_BYTE){
+            line.value = (instr.r1 << 4) | instr.r2;
+        }
+        m_flow.add(line);
+        if(instr.mnemonic == MN_CLEAR){
+            if(instr.r1 == 1){
+                state.index = 0;
+            }
+            else if(instr.r1 == 3){
+                state.base = 0;
+            }
+        }
+        else if(instr.mnemonic == MN_LDB || instr.mnemonic == MN_LDX){  // The value load_reg() would see.
+            int value = instr.field;
+            if(!has_constant_operand(instr.flags)){
+                value = get_TA(instr, currAddr);
+                if(target_mode(instr.flags) == TA_BASE_RELATIVE){
+                    value = value + state.base;
+                }
+                if(instr.flags & FLAG_X){
+                    value = value + state.index;
+                }
+            }
+            (instr.mnemonic == MN_LDB ? state.base : state.index) = value;
+        }
+        currAddr = currAddr + format;
+    }
+}
+
+
+/**
+* Clears the registers before the first line of a listing is resolved.
+*/
+void Disassembler::reset_registers(){
+    std::fill(std::begin(m_registerValues), std::end(m_registerValues), 0);
+    m_baseTA = 0;
+    m_resolvedBase = false;
+    m_unresolvedBase = false;
+}
+
+/**
+* Loads the symbols from a symbol file, or from a symbol index written by dissem index-sym.
+* @param text: The contents of the file.
+* @param borrow: Whether text outlives the use of the symbols, so an index is used in place.
+* @param error: Receives a description of the failure, if any.
+* @return False if the text is a malformed symbol index.
+*/
+bool Disassembler::load_symbols(std::string_view text, bool borrow, std::string& error){
+    if(is_symbol_index(text)){
+        return m_symbols.load(text, !borrow, error);
+    }
+    parse_symbols(text, m_symbols);
+    return true;
+}
+
+
+/**
+* Loads the object file into m_image. With a cache directory, the image is looked up there by a
+* hash of the object file's contents and mapped in place, skipping the parse; an object file not
+* seen before is parsed and its image added to the cache for the next run. The cache only ever
+* saves time: a file that cannot be read or written there is parsed as if there were no cache.
+* @param objText: The contents of the object file.
+* @param error: Receives a description of the failure, if any.
+* @return False if the object file is malformed.
+*/
+bool Disassembler::load_image(std::string_view objText, std::string& error){
+    if(m_cacheDir.empty()){
+        return parse_obj(objText, m_image, error);
+    }
+    static std::atomic<unsigned> tempFiles(0);
+    uint64_t hash = hash_text(objText);
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.dsobj", static_cast<unsigned long long>(hash));
+    std::string path = m_cacheDir + name;
+    std::string ignored;
+    if(m_imageInput.open(path, ignored)){
+        if(m_image.load(m_imageInput.text(), hash, objText.size(), ignored)){
+            STAT_ADD(m_stats.counters, STAT_CACHE_HITS, 1);
+            return true;
+        }
+        m_imageInput.close();                                           // Stale or damaged: replaced below.
+    }
+    if(!parse_obj(objText, m_image, error)){
+        return false;
+    }
+    STAT_ADD(m_stats.counters, STAT_CACHE_MISSES, 1);
+    std::string temp = path + "." + std::to_string(getpid()) + "." + std::to_string(tempFiles++);
+    if(!write_object_image(m_image, hash, objText.size(), temp, ignored) ||   // Renamed into place whole, so
+       std::rename(temp.c_str(), path.c_str()) != 0){                       // others never map half a file.
+        std::remove(temp.c_str());
+    }
+    return true;
+}
+
+
+/**
+* @param line: The listing line of an instruction in the current image.
+* @return Its Target Address less the B and X registers, as decode_record() works it out.
+*/
+int Disassembler::raw_target(const ListingLine& line){
+    Instruction instr;
+    decode_instruction(m_image.at(line.address), line.length, instr);
+    return get_TA(instr, line.address);
+}
+
+
+/**
+* Calculates and returns the Target Address of a decoded instruction, as far as it can be known
+* without the register values: the B and X registers are added by resolve_registers(). PC-relative
+* Format 3 displacements are signed; base-relative displacements are not.
+* @param instr: The decoded instruction.
+* @param locAddr: The address of where the instruction is located.
+* @return The Target Address of the object code, less the B and X registers.
+*/ 
+int Disassembler::get_TA(const Instruction& instr, int locAddr){
+    int taADDR = 0;
+    int dispOrAddr = instr.field;
+    if(instr.format < 3){                                           // Format 1 and 2 instructions don't have TA's.
+        return 0;
+    }
+
+    switch(target_mode(instr.flags)){                               // Altering TA value depending on its addressing mode.
+    case TA_PC_RELATIVE:
+        if(instr.format == 3 && dispOrAddr > 2047){                 // Displacements not within [-2048, 2047] must be
+            dispOrAddr = dispOrAddr - 4096;                         // subtracted by 4096 to store the correct, signed value.
+        }
+        taADDR = dispOrAddr + (locAddr + instr.format);
+        break;
+    case TA_BASE_RELATIVE:
+    case TA_DIRECT:
+        taADDR = dispOrAddr;
+        break;
+    default:
+        break;
+    }
+
+    return taADDR;
+}
+
+
+/**
+* Stores what is needed to render the operand of a decoded instruction in its listing line.
+* @param line: The instruction's listing line.
+* @param instr: The decoded instruction.
+* @param targetAddr: The Target Address of the instruction, less the B and X registers.
+* @param counters: Counts the symbol lookups.
+*/ 
+void Disassembler::set_operand(ListingLine& line, const Instruction& instr, int targetAddr, StatCounters& counters){
+    switch(instr.operand){
+    case OPERAND_MEMORY:
+        if(has_constant_operand(instr.flags)){                          // Operand is a constant.
+            line.value = instr.field;
+        }
+        else{                                                           // Operand is a symbol, looked up once the
+            line.value = targetAddr;                                    // registers are known if it needs them.
+            if(!uses_registers(instr.flags)){
+                line.operand = add_label(targetAddr, counters);
+            }
+        }
+        break;
+    case OPERAND_BYTE:
+        line.value = instr.field;
+        break;
+    default:                                                            // Registers and numbers of Format 2.
+        line.value = (instr.r1 << 4) | instr.r2;
+        break;
+    }
+}
+
+
+/**
+* @param currAddr: The address of a Format 4 instruction in a linked program.
+* @param targetAddr: Its Target Address.
+* @param operand: The symbol at its Target Address.
+* @return The exported symbol a modification record adds to its address, if the instruction
+*         targets that symbol itself; otherwise the operand given.
+*/
+uint32_t Disassembler::external_operand(uint32_t currAddr, uint32_t targetAddr, uint32_t operand){
+    auto found = std::lower_bound(m_externalRefs.begin(), m_externalRefs.end(), currAddr,
+                                  [](const ExternalRef& ref, uint32_t addr){
+        return ref.address < addr;
+    });
+    return found != m_externalRefs.end() && found->address == currAddr && found->target == targetAddr ?
+           found->name : operand;
+}
+
+
+/**
+* Finds the symbol located at an address, which becomes the label of the line at that address or
+* the operand of an instruction targeting it.
+* @param currAddr: The address to look up.
+* @param counters: Counts the lookup, and whether it missed.
+* @return The id of the symbol at that address, NO_SYMBOL if there is none.
+*/ 
+uint32_t Disassembler::add_label(int currAddr, StatCounters& counters){
+    uint32_t id = m_symbols.find(currAddr);
+    STAT_ADD(counters, STAT_LOOKUPS, 1);
+    STAT_ADD(counters, STAT_MISSES, id == NO_SYMBOL);
+    return id;
+}
+
+
+/**
+* @param literal: The symbol id of a literal.
+* @param available: The bytes left in its text record.
+* @return The length of the literal's object code, from its name, within what is left.
+*/
+int Disassembler::literal_length(uint32_t literal, uint32_t available){
+    std::string_view name = m_symbols.name(literal);
+    int bytes = 0;
+    if(name.find("=X") == 0){                                           // Length of literal's object code differs
+        bytes = (name.rfind("'") - 3) / 2;                              // depending on the type of literal
+    }                                                                   // (X for Hexadecimal, C for Character).
+    else if(name.find("=C") == 0){
+        bytes = name.rfind("'") - 3;
+    }
+    return std::max(1, std::min(bytes, int(available)));
+}
+
+
+/**
+* @param currAddr: The address to check.
+* @return True if the symbol at the address is a literal.
+*/
+bool Disassembler::is_literal(int currAddr){
+    return m_symbols.is_literal(m_symbols.find(currAddr));
+}
+
+
+/**
+* Appends a line to a listing.
+* @param listing: The whole listing or the lines of one chunk.
+* @param kind: The LineKind of the line.
+* @param address: The address of the line.
+* @return The new line, with no label, operand or object code.
+*/
+ListingLine& Disassembler::add_line(Listing& listing, uint8_t kind, uint32_t address){
+    listing.push_back(ListingLine{address, NO_SYMBOL, NO_SYMBOL, 0, 0, kind, MN_INVALID, 0, 0});
+    return listing.back();
+}
+
+
+/**
+* Lists the reserved regions that follow a text record, as planned by plan_gaps(). Each region
+* starts at a symbol (or at the end of the record) and runs up to the next symbol, the next text
+* record or the end of the program. Regions that are a whole number of words are reserved with
+* RESW, anything else with RESB.
+* @param listing: The whole listing or the lines of one chunk.
+* @param currItr: The current iteration through the text records, GAP_LEADING before the first.
+* @param nextGap: The first region not yet listed; advanced past the regions listed.
+* @param counters: Counts the lines listed.
+*/ 
+void Disassembler::fill_gap(Listing& listing, int currItr, size_t& nextGap, StatCounters& counters){
+    for(; nextGap < m_gaps.size() && m_gaps[nextGap].after == currItr; nextGap++){
+        add_gap(listing, m_gaps[nextGap], counters);
+    }
+}
+
+
+/**
+* Lists one reserved region.
+* @param listing: The whole listing or the lines of one chunk.
+* @param gap: The region.
+* @param counters: Counts the line listed.
+*/
+void Disassembler::add_gap(Listing& listing, const GapRegion& gap, StatCounters& counters){
+    bool words = gap.length % 3 == 0;
+    ListingLine& line = add_line(listing, words ? LINE_RESW : LINE_RESB, gap.address);
+    line.label = gap.label;
+    line.value = words ? gap.length / 3 : gap.length;                  // The number of words or bytes to reserve.
+    STAT_ADD(counters, STAT_GAP_LINES, 1);
+}
+
+
+/**
+* Loads a specific value into a specific register when a load instruction is detected.
+* Other instructions, including LDCH, leave the registers untouched.
+* @param mnemonic: The instruction's mnemonic, which determines what register is being addressed.
+* @param value: Its constant, or its Target Address with the registers left by the lines before it.
+*/  
+void Disassembler::load_reg(uint8_t mnemonic, int value){
+    int regValIdx;
+    switch(mnemonic){                                                   // Match load instruction to its register.
+    case MN_LDA: regValIdx = 0; break;
+    case MN_LDX: regValIdx = 1; break;
+    case MN_LDL: regValIdx = 2; break;
+    case MN_LDB: regValIdx = 3; break;
+    case MN_LDS: regValIdx = 4; break;
+    case MN_LDT: regValIdx = 5; break;
+    case MN_LDF: regValIdx = 6; break;
+    default:
+        return;
+    }
+
+    m_registerValues[regValIdx] = value;                                // Either the constant or the address
+}                                                                       // that references a symbol.
+
+
+/**
+* Clears a specific register if the disassembler detects a CLEAR instruction. 
+* @param reg: The register number from the CLEAR instruction's r1 field.
+*/ 
+void Disassembler::clear_reg(int reg){
+    if(reg < 7){
+        m_registerValues[reg] = 0;
+    }
+}
+
+
+/**
+* Creates a LTORG instruction when the disassembler detects that the current program counter address matches
+* any address of a literal.
+*/ 
+void Disassembler::add_LTORG(Listing& listing){
+    add_line(listing, LINE_LTORG, 0);
+}
+
+
+/**
+* Defines any literal referenced before a detected LTORG instruction was declared. 
+* @param listing: The whole listing or the lines of one chunk.
+* @param literal: The symbol id of the literal.
+* @param currAddr: The address where the literal is according to the symbol table.
+* @param bytes: The length of the literal's object code.
+*/ 
+void Disassembler::add_literal(Listing& listing, uint32_t literal, int currAddr, int bytes){
+    ListingLine& line = add_line(listing, LINE_LITERAL, currAddr);
+    line.operand = literal;
+    line.length = bytes;
+    line.objOffset = currAddr - m_image.header.start;
+}
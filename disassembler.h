@@ -1,26 +1,205 @@
-#include <iostream>
-#include <string>
-#include <iomanip>
-#include <vector>
-#include <fstream>
-#include <sstream>
-#include <map>
-
-void disassemble(std::string objFile, std::string symFile);
-void parse_obj(std::string objFile);
-void parse_sym(std::string symTab); 
-std::string get_mnemonic(std::string firstHex, std::string secondHex);
-int get_format(std::string mnemonic, std::string thirdHex);
-std::string addr_mode_OP(std::string secondHex);
-std::string addr_mode_TA(std::string thirdHex);
-bool is_indexed(std::string thirdHex);
-int get_TA(int format, int locAddr, std::string objCode, std::string addrTA, bool isIndex);
-std::string get_operand(int targetAddr, int format, std::string mnemonic, std::string objCode, std::string addrOP, bool isIndex);
-bool three_bits_zero(std::string thirdHex);
-void add_label(int currAddr);
-void fill_gap(int currAddr, int currItr);
-std::vector<int> find_addr_gap_matches(int endAddr, int currentItr);
-void load_reg(int targetAddr, int format, std::string mnemonic, std::string objCode);
-void clear_reg(std::string objCode);
-void add_LTORG();
-void add_literal(std::string literal, std::string objCode, int currAddr);
\ No newline at end of file
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+
+#include <iostream>
+#include <string>
+#include <iomanip>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include "optable.h"
+#include "loader.h"
+#include "input.h"
+#include "listing.h"
+#include "symbols.h"
+#include "gaps.h"
+#include "stats.h"
+#include "xref.h"
+#include "flow.h"
+#include "link.h"
+
+struct OutputOptions;
+
+const uint32_t NO_ADDRESS = 0xFFFFFFFF;
+const size_t NO_LINE = size_t(-1);
+const size_t MIN_PARALLEL_BYTES = 1 << 16;         // Smaller programs are decoded on one thread.
+const size_t CHUNKS_PER_THREAD = 4;                 // Extra chunks even out uneven text records.
+
+/**
+* A run of consecutive text records decoded on its own, possibly on another thread.
+*/
+struct DecodeChunk {
+    size_t firstText;
+    size_t lastText;                                // One past the last text record.
+    uint32_t literalEnd;                            // Address just past the last literal pool; NO_ADDRESS if unknown.
+    size_t firstLtorg;                              // The LTORG before the first pool, if it may have to go.
+    uint32_t firstLtorgAddr;
+    Listing lines;
+    StatCounters counters;
+};
+
+/**
+* The decoder's state going into a text record, as far as the lines of the record depend on it:
+* the registers Target Addresses are completed with, and where the last literal pool ended.
+*/
+struct RecordCheckpoint {
+    int base;                                       // The B register.
+    int index;                                      // The X register.
+    uint32_t literalEnd;
+};
+
+/**
+* Where a control section after the first starts in a linked program, for its CSECT line.
+*/
+struct SectionStart {
+    uint32_t address;
+    uint32_t name;                                  // Symbol id of the section's name.
+};
+
+/**
+* A Format 4 instruction of a linked program whose address a modification record adds an exported
+* symbol to.
+*/
+struct ExternalRef {
+    uint32_t address;                               // Of the instruction.
+    uint32_t name;                                  // Symbol id of the exported symbol.
+    uint32_t target;                                // The exported symbol's address.
+};
+
+/**
+* A run of lines update() replaced: the lines from oldFirst up to oldLast of the listing before it
+* are now the lines from newFirst up to newLast.
+*/
+struct ListingEdit {
+    size_t oldFirst;
+    size_t oldLast;
+    size_t newFirst;
+    size_t newLast;
+};
+
+/**
+* Disassembles object files one at a time. Everything a run needs is held here, so a
+* Disassembler can be reused for any number of files and separate ones can run concurrently.
+*/
+class Disassembler {
+public:
+    explicit Disassembler(int threads = 1) : m_threads(threads) {}
+
+    bool run(const std::string& objFile, const std::string& symTab, const OutputOptions& output,
+             std::string& error);
+    bool stream(const std::string& objFile, const std::string& symTab, const OutputOptions& output,
+                std::string& error);
+    bool decode(std::string_view objText, std::string_view symText, std::string& error,
+                bool borrowSymbols = false);
+    bool load(std::string_view objText, std::string_view symText, std::string& error,
+              bool borrowSymbols = false);
+    bool decode_linked(const std::vector<std::string_view>& objTexts, const std::vector<std::string_view>& symTexts,
+                       std::string& error);
+    bool load_linked(const std::vector<std::string_view>& objTexts, const std::vector<std::string_view>& symTexts,
+                     std::string& error);
+    void decode_range(uint32_t start, uint32_t end);
+    bool update(std::string_view objText, std::vector<ListingEdit>& edits, std::string& error);
+    bool write(const OutputOptions& output, std::string& error);
+    bool write_xref(const std::string& path, std::string& error) const;
+
+    void set_xref(bool build){                      // Whether decode() builds the cross-reference index.
+        m_buildXref = build;
+    }
+    void set_cache(const std::string& dir){         // Where decode() keeps object images; empty for nowhere.
+        m_cacheDir = dir;
+    }
+
+    bool is_linked() const {                        // Whether the last load went through the linker.
+        return m_linked;
+    }
+
+    const ObjectImage& image() const {
+        return m_image;
+    }
+    const SymbolIndex& symbols() const {
+        return m_symbols;
+    }
+    const Listing& listing() const {                // Of the last decode(); run() empties it when done.
+        return m_listing;
+    }
+
+    const XrefIndex& xref() const {                 // Empty unless set_xref(true).
+        return m_xref;
+    }
+
+    const std::string& warning() const {            // Of the last decode, update or stream: operands it could not
+                                                    // resolve, and for stream() whether a full run may differ.
+        return m_warning;
+    }
+
+    const RunStats& stats() const {                 // Of the last run; all zero if built without DISSEM_STATS.
+        return m_stats;
+    }
+
+private:
+    void decode_listing();
+    void decode_texts();
+    void add_sections();
+    void count_loaded(size_t sections);
+    void decode_chunk(DecodeChunk& chunk, Listing& listing);
+    void decode_record(const TextRecord& text, DecodeChunk& chunk, Listing& listing);
+    void resolve_registers(Listing& listing);
+    void reset_registers();
+    void report_unresolved();
+    void build_flow();
+    void scan_texts();
+    void scan_record(const TextRecord& text, RecordCheckpoint& state);
+    int literal_length(uint32_t literal, uint32_t available);
+    bool load_image(std::string_view objText, std::string& error);
+    bool load_symbols(std::string_view text, bool borrow, std::string& error);
+    int get_TA(const Instruction& instr, int locAddr);
+    int raw_target(const ListingLine& line);
+    void set_operand(ListingLine& line, const Instruction& instr, int targetAddr, StatCounters& counters);
+    uint32_t add_label(int currAddr, StatCounters& counters);
+    uint32_t external_operand(uint32_t currAddr, uint32_t targetAddr, uint32_t operand);
+    bool is_literal(int currAddr);
+    ListingLine& add_line(Listing& listing, uint8_t kind, uint32_t address);
+    void fill_gap(Listing& listing, int currItr, size_t& nextGap, StatCounters& counters);
+    void add_gap(Listing& listing, const GapRegion& gap, StatCounters& counters);
+    void load_reg(uint8_t mnemonic, int value);
+    void clear_reg(int reg);
+    void add_LTORG(Listing& listing);
+    void add_literal(Listing& listing, uint32_t literal, int currAddr, int bytes);
+
+    int m_threads;                                  // Threads decoding and writing large programs; 0 for one per core.
+    InputFile m_objInput;
+    InputFile m_symInput;
+    InputFile m_imageInput;                         // The cached image m_image was loaded from, if any.
+    std::string m_cacheDir;
+    ObjectImage m_image;
+    ObjectImage m_nextImage;                        // What update() parses into; the image before it afterwards.
+    SymbolIndex m_symbols;
+    Listing m_listing;
+    Listing m_prevListing;                          // The listing before update().
+    GapList m_gaps;                                 // Reserved regions in listing order.
+    Linker m_linker;
+    MemVector<SectionStart, MEM_LISTING> m_sectionStarts;  // After the first, when linked.
+    MemVector<ExternalRef, MEM_SYMBOLS> m_externalRefs;    // By address, when linked.
+    bool m_linked = false;
+    std::vector<DecodeChunk> m_chunks;
+    std::vector<MemVector<char, MEM_OUTPUT>> m_outputChunks;   // What write() renders large listings into.
+    MemVector<RecordCheckpoint, MEM_RANGE> m_checkpoints;  // Going into each text record, for decode_range().
+    bool m_textsInOrder = false;                    // Whether the text records ascend without overlapping.
+    Listing m_rangeLines;                           // The lines of one record, before they are picked.
+    RegisterFlow m_flow;                            // What B and X hold along every path, unless streaming.
+    ForwardFlow m_forward;                          // What they hold along the paths seen so far, when streaming.
+    bool m_streaming = false;
+    uint32_t m_unresolved = 0;                      // Operands left as displacements.
+    std::string m_warning;
+    int m_registerValues[7] = {0, 0, 0, 0, 0, 0, 0};
+    int m_baseTA = 0;                               // Whether the last memory instruction depended on the
+    bool m_resolvedBase = false;                    // registers and its target, for a BASE following a LDB,
+    bool m_unresolvedBase = false;                  // or was left as its displacement.
+    bool m_buildXref = false;
+    XrefIndex m_xref;
+    RunStats m_stats;
+};
+
+#endif
@@ -0,0 +1,240 @@
+#include "dissem.h"
+
+/**
+* Exposes the fields the formatters render, for lines that are kept rather than written.
+*/
+class FieldRenderer : public ListingFormatter {
+public:
+    using ListingFormatter::ListingFormatter;
+    using ListingFormatter::fields;
+
+    void line(const ListingLine&, OutputBuffer&) override {}
+};
+
+
+Disassembly::Disassembly() : m_disassembler(new Disassembler) {}
+Disassembly::Disassembly(Disassembly&&) = default;
+Disassembly& Disassembly::operator=(Disassembly&&) = default;
+Disassembly::~Disassembly() = default;
+
+
+/**
+* Disassembles an object file and its symbol table held in memory. The symbol table may also be
+* a precompiled symbol index (see write_symbol_index()). The inputs are only read during the call
+* unless options.borrowInputs is set. With options.cacheDir, the object file's image is loaded from
+* (or added to) the cache there.
+* @param obj: The contents of the object file.
+* @param sym: The contents of the symbol file.
+* @param options: Threads to use, whether to render the lines, whether to index references and
+*                 where to cache object images.
+* @return The disassembly; check ok(), and error() for what went wrong.
+*/
+Disassembly disassemble(std::string_view obj, std::string_view sym, const DisassemblyOptions& options){
+    Disassembly result;
+    result.m_disassembler.reset(new Disassembler(options.threads));
+    result.m_disassembler->set_xref(options.xref);
+    result.m_disassembler->set_cache(options.cacheDir);
+    result.m_renderLines = options.lines;
+    if(!result.m_disassembler->decode(obj, sym, result.m_error, options.borrowInputs)){
+        if(result.m_error.empty()){
+            result.m_error = "cannot decode the object file";
+        }
+        return result;
+    }
+    if(options.lines){
+        result.render_lines();
+    }
+    return result;
+}
+
+
+/**
+* Disassembles only the part of a program from one address to another: the lines disassemble()
+* would give for those addresses, without the START and END directives. Only the text records
+* around the range are decoded, so a small window of a large program costs little more than
+* loading it. More windows of the same program can then be had from decode_range().
+* @param obj: The contents of the object file.
+* @param sym: The contents of the symbol file, or a precompiled symbol index.
+* @param start: The first address of the range.
+* @param end: The last address of the range.
+* @param options: As for disassemble().
+* @return The disassembly of the range; check ok(), and error() for what went wrong.
+*/
+Disassembly disassemble_range(std::string_view obj, std::string_view sym, uint32_t start, uint32_t end,
+                              const DisassemblyOptions& options){
+    Disassembly result;
+    result.m_disassembler.reset(new Disassembler(options.threads));
+    result.m_disassembler->set_xref(options.xref);
+    result.m_disassembler->set_cache(options.cacheDir);
+    result.m_renderLines = options.lines;
+    if(!result.m_disassembler->load(obj, sym, result.m_error, options.borrowInputs)){
+        if(result.m_error.empty()){
+            result.m_error = "cannot load the object file";
+        }
+        return result;
+    }
+    result.decode_range(start, end);
+    return result;
+}
+
+
+/**
+* Links object files of one or more control sections into one program and disassembles it, with
+* a CSECT line where each section after the first starts. Each symbol file lists the symbols of its
+* object file's sections, one table per section, and must be a symbol file rather than an index, as
+* its addresses are moved with the sections. Images are never cached for a linked program.
+* @param objs: The contents of the object files, in link order.
+* @param syms: The contents of their symbol files, in the same order.
+* @param options: As for disassemble(), less cacheDir and borrowInputs.
+* @return The disassembly; check ok(), and error() for what went wrong.
+*/
+Disassembly disassemble_linked(const std::vector<std::string_view>& objs, const std::vector<std::string_view>& syms,
+                               const DisassemblyOptions& options){
+    Disassembly result;
+    result.m_disassembler.reset(new Disassembler(options.threads));
+    result.m_disassembler->set_xref(options.xref);
+    result.m_renderLines = options.lines;
+    if(!result.m_disassembler->decode_linked(objs, syms, result.m_error)){
+        if(result.m_error.empty()){
+            result.m_error = "cannot link the object files";
+        }
+        return result;
+    }
+    if(options.lines){
+        result.render_lines();
+    }
+    return result;
+}
+
+
+/**
+* Renders every listing line into an AsmLine. The operands and object code go into one text
+* buffer, which is only pointed into once complete so that growing it cannot move the text.
+*/
+void Disassembly::render_lines(){
+    static const char hexDigits[] = "0123456789ABCDEF";
+    const Listing& listing = m_disassembler->listing();
+    RenderContext ctx{&m_disassembler->image(), &m_disassembler->symbols()};
+    FieldRenderer renderer(ctx);
+
+    MemVector<uint32_t, MEM_LISTING> operandLengths;
+    operandLengths.reserve(listing.size());
+    m_text.clear();
+    m_lines.clear();
+    m_lines.reserve(listing.size());
+    for(const ListingLine& line : listing){
+        const LineFields& f = renderer.fields(line);
+        AsmLine asmLine;
+        asmLine.kind = line.kind;
+        asmLine.hasAddress = f.hasAddress;
+        asmLine.extended = f.extended;
+        asmLine.address = f.address;
+        asmLine.label = f.label;
+        asmLine.opCode = f.opCode;
+        asmLine.objBytes = f.objCode;
+        asmLine.objLength = f.objLength;
+        operandLengths.push_back(f.operand.size());
+        m_text.insert(m_text.end(), f.operand.begin(), f.operand.end());
+        for(int i = 0; i < f.objLength; i++){
+            m_text.push_back(hexDigits[f.objCode[i] >> 4]);
+            m_text.push_back(hexDigits[f.objCode[i] & 0x0F]);
+        }
+        m_lines.push_back(asmLine);
+    }
+
+    const char* text = m_text.data();
+    for(size_t i = 0; i < m_lines.size(); i++){
+        AsmLine& asmLine = m_lines[i];
+        asmLine.operand = std::string_view(text, operandLengths[i]);
+        text += operandLengths[i];
+        asmLine.objCode = std::string_view(text, asmLine.objLength * 2);
+        text += asmLine.objLength * 2;
+    }
+}
+
+
+/**
+* @return The program name from the header record.
+*/
+std::string_view Disassembly::program() const {
+    return m_disassembler->image().header.name;
+}
+
+
+/**
+* @return The time spent in each phase and what was decoded, including any write().
+*/
+const RunStats& Disassembly::stats() const {
+    return m_disassembler->stats();
+}
+
+
+/**
+* @return How many operands were left as their displacement, as B or X differs between the paths
+*         reaching them; empty if none were.
+*/
+const std::string& Disassembly::warning() const {
+    return m_disassembler->warning();
+}
+
+
+/**
+* @return Every reference to an address, if options.xref was set.
+*/
+const XrefIndex& Disassembly::xref() const {
+    return m_disassembler->xref();
+}
+
+
+/**
+* Writes the cross-reference index for dissem query (see XrefHeader).
+* @param path: The file to write, or "-" for stdout.
+* @param error: Receives a description of the failure, if any.
+* @return True if the file was written.
+*/
+bool Disassembly::write_xref(const std::string& path, std::string& error) const {
+    if(!ok()){
+        error = m_error;
+        return false;
+    }
+    return m_disassembler->write_xref(path, error);
+}
+
+
+/**
+* Replaces the lines with those of another range of the same program, as disassemble_range()
+* would give them. The text record checkpoints found so far are kept, so a debugger stepping
+* through windows of a large program only decodes the records in each.
+* @param start: The first address of the range.
+* @param end: The last address of the range.
+* @return False if the program could not be loaded.
+*/
+bool Disassembly::decode_range(uint32_t start, uint32_t end){
+    if(!ok()){
+        return false;
+    }
+    m_disassembler->decode_range(start, end);
+    if(m_renderLines){
+        render_lines();
+    }
+    else{
+        m_text.clear();
+        m_lines.clear();
+    }
+    return true;
+}
+
+
+/**
+* Writes the listing in any OutputFormat, exactly as the command line tool does.
+* @param output: Where and in which format to write the listing.
+* @param error: Receives a description of the failure, if any.
+* @return True if the listing was written.
+*/
+bool Disassembly::write(const OutputOptions& output, std::string& error){
+    if(!ok()){
+        error = m_error;
+        return false;
+    }
+    return m_disassembler->write(output, error);
+}
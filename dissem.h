@@ -0,0 +1,104 @@
+#ifndef DISSEM_H
+#define DISSEM_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "output.h"
+
+/**
+* How disassemble() works on an object file held in memory.
+*/
+struct DisassemblyOptions {
+    int threads = 1;                // Threads decoding large programs; 0 for one per hardware thread.
+    bool lines = true;              // Render the AsmLines; off when only write() is wanted.
+    bool xref = false;              // Build the cross-reference index, for xref() and write_xref().
+    bool borrowInputs = false;      // The inputs outlive the Disassembly, so a symbol index is used in place.
+    std::string cacheDir;           // Directory of cached object images, keyed by content; empty for none.
+};
+
+/**
+* One line of a disassembly, with the same fields as the listing columns. The views point into
+* the Disassembly (or into static tables) and stay valid as long as it does, moves included.
+*/
+struct AsmLine {
+    uint8_t kind;                   // LineKind.
+    bool hasAddress;                // Directives (LTORG, BASE, END) don't represent an address.
+    bool extended;                  // Format 4 instructions are prefixed with '+'.
+    uint32_t address;
+    std::string_view label;
+    std::string_view opCode;        // Mnemonic or directive, without the '+'.
+    std::string_view operand;
+    std::string_view objCode;       // Object code in hexadecimals.
+    const uint8_t* objBytes;        // The same object code as bytes, objLength of them.
+    int objLength;
+};
+
+/**
+* The result of disassembling an object file in memory: the lines of the listing, which can
+* also be written out in any OutputFormat. Nothing refers back to the input buffers
+* unless DisassemblyOptions::borrowInputs is set.
+*/
+class Disassembly {
+public:
+    typedef MemVector<AsmLine, MEM_LISTING>::const_iterator const_iterator;
+
+    Disassembly();
+    Disassembly(Disassembly&&);
+    Disassembly& operator=(Disassembly&&);
+    ~Disassembly();
+
+    bool ok() const {
+        return m_error.empty();
+    }
+    const std::string& error() const {
+        return m_error;
+    }
+
+    const_iterator begin() const {
+        return m_lines.begin();
+    }
+    const_iterator end() const {
+        return m_lines.end();
+    }
+    size_t size() const {
+        return m_lines.size();
+    }
+    const AsmLine& operator[](size_t i) const {
+        return m_lines[i];
+    }
+
+    std::string_view program() const;
+    const RunStats& stats() const;
+    const XrefIndex& xref() const;
+    const std::string& warning() const;
+    bool write(const OutputOptions& output, std::string& error);
+    bool write_xref(const std::string& path, std::string& error) const;
+    bool decode_range(uint32_t start, uint32_t end);
+
+private:
+    friend Disassembly disassemble(std::string_view obj, std::string_view sym, const DisassemblyOptions& options);
+    friend Disassembly disassemble_range(std::string_view obj, std::string_view sym, uint32_t start, uint32_t end,
+                                         const DisassemblyOptions& options);
+    friend Disassembly disassemble_linked(const std::vector<std::string_view>& objs,
+                                          const std::vector<std::string_view>& syms,
+                                          const DisassemblyOptions& options);
+
+    void render_lines();
+
+    std::unique_ptr<Disassembler> m_disassembler;   // Holds the image, symbols and listing.
+    MemVector<char, MEM_LISTING> m_text;            // Every rendered operand and object code.
+    MemVector<AsmLine, MEM_LISTING> m_lines;
+    std::string m_error;
+    bool m_renderLines = true;                      // DisassemblyOptions::lines.
+};
+
+Disassembly disassemble(std::string_view obj, std::string_view sym,
+                        const DisassemblyOptions& options = DisassemblyOptions());
+Disassembly disassemble_range(std::string_view obj, std::string_view sym, uint32_t start, uint32_t end,
+                              const DisassemblyOptions& options = DisassemblyOptions());
+Disassembly disassemble_linked(const std::vector<std::string_view>& objs, const std::vector<std::string_view>& syms,
+                               const DisassemblyOptions& options = DisassemblyOptions());
+
+#endif
@@ -0,0 +1,472 @@
+#include <algorithm>
+#include "flow.h"
+#include "optable.h"
+
+const uint32_t UNKNOWN_TARGET = 0xFFFFFFFF;         // A jump whose target depends on memory or registers.
+const int REG_X = 1;                                // Register numbers of Format 2 instructions.
+const int REG_B = 3;
+const uint32_t NO_TARGET = 0xFFFFFFFF;              // FlowEvent::target of anything but a jump known statically.
+const uint32_t NO_EVENT = 0xFFFFFFFF;               // Stands for the entry among the jumps.
+const uint32_t FIND_NEAR_BLOCKS = 4;                // Blocks find() tries after its hint before searching.
+
+
+/**
+* @return True for the instructions that may not go on to the next one.
+*/
+static bool is_jump(uint8_t mnemonic){
+    return mnemonic == MN_J || mnemonic == MN_JEQ || mnemonic == MN_JGT || mnemonic == MN_JLT ||
+           mnemonic == MN_JSUB || mnemonic == MN_RSUB;
+}
+
+
+/**
+* @return The address a jump goes to, if the instruction alone says: not for RSUB, indirect
+*         jumps or jumps relative to B or X.
+*/
+static uint32_t jump_target(uint8_t mnemonic, uint8_t flags, uint32_t value){
+    if(mnemonic == MN_RSUB || uses_registers(flags) || operand_mode(flags) == OP_INDIRECT){
+        return UNKNOWN_TARGET;
+    }
+    return value;
+}
+
+
+/**
+* @param mnemonic: The instruction's mnemonic.
+* @param value: Its ListingLine::value; the registers of a Format 2 instruction.
+* @return The register (REG_X or REG_B) the instruction writes, or -1 if neither.
+*/
+static int written_register(uint8_t mnemonic, uint32_t value){
+    int reg = -1;
+    switch(mnemonic){
+    case MN_LDB:
+        return REG_B;
+    case MN_LDX:
+    case MN_TIX:
+    case MN_TIXR:
+        return REG_X;
+    case MN_CLEAR:
+    case MN_SHIFTL:
+    case MN_SHIFTR:
+        reg = value >> 4;
+        break;
+    case MN_RMO:
+    case MN_ADDR:
+    case MN_SUBR:
+    case MN_MULR:
+    case MN_DIVR:
+        reg = value & 0x0F;
+        break;
+    default:
+        break;
+    }
+    return reg == REG_X || reg == REG_B ? reg : -1;
+}
+
+
+/**
+* Follows the B and X registers through one instruction. Loads and CLEAR leave a known value when
+* what they load is known; the arithmetic, shifts, TIX and TIXR leave an unknown one, as does RMO
+* from any register but B and X. A load from memory stands for its operand's address, as the
+* listing has always shown it, since what memory holds is never known statically: a register
+* known here is followed along every path, not proven.
+* @param state: The registers before the instruction; receives them after it.
+* @param mnemonic: The instruction's mnemonic.
+* @param flags: Its nixbpe bits.
+* @param value: Its ListingLine::value, before the registers are added.
+*/
+void step_registers(RegisterState& state, uint8_t mnemonic, uint8_t flags, uint32_t value){
+    int reg = written_register(mnemonic, value);
+    if(reg < 0 || !(state.known & REG_REACHED)){                    // Code nothing reaches knows nothing.
+        return;
+    }
+    int loaded = 0;
+    bool known = false;
+    if(mnemonic == MN_CLEAR){
+        known = true;
+    }
+    else if(mnemonic == MN_LDB || mnemonic == MN_LDX){              // The value load_reg() would see.
+        loaded = value;
+        known = true;
+        if(!has_constant_operand(flags)){
+            if(target_mode(flags) == TA_BASE_RELATIVE){
+                loaded = loaded + state.base;
+                known = known && (state.known & REG_KNOWN_BASE);
+            }
+            if(flags & FLAG_X){
+                loaded = loaded + state.index;
+                known = known && (state.known & REG_KNOWN_INDEX);
+            }
+        }
+    }
+    else if(mnemonic == MN_RMO && (value >> 4 == REG_X || value >> 4 == REG_B)){
+        loaded = value >> 4 == REG_X ? state.index : state.base;
+        known = state.known & (value >> 4 == REG_X ? REG_KNOWN_INDEX : REG_KNOWN_BASE);
+    }
+
+    uint8_t bit = reg == REG_X ? REG_KNOWN_INDEX : REG_KNOWN_BASE;
+    (reg == REG_X ? state.index : state.base) = loaded;
+    state.known = known ? state.known | bit : state.known & ~bit;
+}
+
+
+/**
+* Merges the registers along one more path into what is known where paths meet: a value stays
+* known only if both paths leave it the same.
+* @param into: The registers where the paths meet; a path nothing reaches is simply taken.
+* @param state: The registers along the new path.
+* @return True if that changed what is known.
+*/
+bool merge_registers(RegisterState& into, const RegisterState& state){
+    if(!(state.known & REG_REACHED)){
+        return false;
+    }
+    if(!(into.known & REG_REACHED)){
+        into = state;
+        return true;
+    }
+    uint8_t known = into.known & state.known;
+    if(into.base != state.base){
+        known &= ~REG_KNOWN_BASE;
+    }
+    if(into.index != state.index){
+        known &= ~REG_KNOWN_INDEX;
+    }
+    if(known == into.known){
+        return false;
+    }
+    into.known = known;
+    return true;
+}
+
+
+/**
+* Empties the analysis, keeping its buffers.
+*/
+void RegisterFlow::clear(){
+    m_events.clear();
+    m_runs.clear();
+    m_blocks.clear();
+    m_jumps.clear();
+    m_targets.clear();
+    m_targetBlocks.clear();
+    m_calls.clear();
+    m_states.clear();
+}
+
+
+/**
+* Adds the next instruction of the listing.
+* @param line: An instruction line, before its registers are resolved.
+*/
+void RegisterFlow::add(const ListingLine& line){
+    if(line.address != m_nextAddr || m_runs.empty()){
+        end_run();
+        uint32_t event = m_events.size();
+        m_runs.push_back(FlowBlock{line.address, line.address, event, event, NO_BLOCK, NO_BLOCK, false});
+    }
+    m_nextAddr = line.address + line.length;
+    if(is_jump(line.mnemonic) || written_register(line.mnemonic, line.value) >= 0){
+        m_events.push_back(FlowEvent{line.address, line.value, NO_TARGET, line.mnemonic, line.flags, line.length});
+    }
+}
+
+
+/**
+* Closes the run of instructions being added, if any.
+*/
+void RegisterFlow::end_run(){
+    if(!m_runs.empty()){
+        m_runs.back().end = m_nextAddr;
+        m_runs.back().endEvent = m_events.size();
+    }
+}
+
+
+/**
+* Cuts the instructions added into basic blocks and works out the registers going into each.
+* Linear in the instructions kept, plus sorting the jump targets: each block's state can only
+* change three times (reached, then B or X found to differ between paths).
+* @param entry: The address of the first instruction executed, from the end record.
+*/
+void RegisterFlow::solve(uint32_t entry){
+    end_run();
+    m_jumps.clear();                                                    // Each target with its jumps, sorted once
+    for(uint32_t e = 0; e < m_events.size(); e++){                      // instead of searched for each jump.
+        const FlowEvent& event = m_events[e];
+        uint32_t target = jump_target(event.mnemonic, event.flags, event.value);
+        if(is_jump(event.mnemonic) && target != UNKNOWN_TARGET){
+            m_jumps.push_back(uint64_t(target) << 32 | e);
+        }
+    }
+    m_jumps.push_back(uint64_t(entry) << 32 | NO_EVENT);
+    std::sort(m_jumps.begin(), m_jumps.end());
+    m_targets.clear();
+    uint32_t entryTarget = 0;
+    for(uint64_t jump : m_jumps){
+        if(m_targets.empty() || m_targets.back() != uint32_t(jump >> 32)){
+            m_targets.push_back(uint32_t(jump >> 32));
+        }
+        uint32_t event = uint32_t(jump);
+        (event == NO_EVENT ? entryTarget : m_events[event].target) = m_targets.size() - 1;
+    }
+
+    cut_blocks();
+    link_blocks();
+    uint32_t entryBlock = m_targetBlocks[entryTarget];
+    m_states.assign(m_blocks.size() + 1, RegisterState{0, 0, 0});
+    if(entryBlock != NO_BLOCK){
+        propagate(entryBlock);
+    }
+}
+
+
+/**
+* Cuts each run of consecutive instructions before every jump target in it and after every
+* jump, then sorts the blocks by address.
+*/
+void RegisterFlow::cut_blocks(){
+    m_blocks.clear();
+    for(const FlowBlock& run : m_runs){
+        uint32_t start = run.start;
+        uint32_t first = run.firstEvent;
+        auto cut = [&](uint32_t end, uint32_t endEvent){
+            m_blocks.push_back(FlowBlock{start, end, first, endEvent, NO_BLOCK, NO_BLOCK, false});
+            start = end;
+            first = endEvent;
+        };
+        size_t t = std::upper_bound(m_targets.begin(), m_targets.end(), run.start) - m_targets.begin();
+        for(uint32_t e = run.firstEvent; e < run.endEvent; e++){
+            const FlowEvent& event = m_events[e];
+            for(; t < m_targets.size() && m_targets[t] <= event.address; t++){
+                if(m_targets[t] > start){
+                    cut(m_targets[t], e);
+                }
+            }
+            if(is_jump(event.mnemonic) && event.address + event.length < run.end){
+                cut(event.address + event.length, e + 1);
+            }
+        }
+        for(; t < m_targets.size() && m_targets[t] < run.end; t++){
+            if(m_targets[t] > start){
+                cut(m_targets[t], run.endEvent);
+            }
+        }
+        cut(run.end, run.endEvent);
+    }
+    auto byStart = [](const FlowBlock& a, const FlowBlock& b){
+        return a.start < b.start;
+    };
+    if(!std::is_sorted(m_blocks.begin(), m_blocks.end(), byStart)){  // Text records out of address order.
+        std::stable_sort(m_blocks.begin(), m_blocks.end(), byStart);
+    }
+
+    m_targetBlocks.assign(m_targets.size(), NO_BLOCK);                // Both ascend, so one merge finds the
+    uint32_t b = 0;                                                     // block each target starts.
+    for(size_t t = 0; t < m_targets.size(); t++){
+        while(b < m_blocks.size() && m_blocks[b].start < m_targets[t]){
+            b++;
+        }
+        if(b < m_blocks.size() && m_blocks[b].start == m_targets[t]){
+            m_targetBlocks[t] = b;
+        }
+    }
+}
+
+
+
+/**
+* Works out where control goes after each block. The return node, numbered after the last
+* block, stands for whatever a subroutine returns to.
+*/
+void RegisterFlow::link_blocks(){
+    uint32_t returnNode = m_blocks.size();
+    m_calls.clear();
+    for(uint32_t b = 0; b < m_blocks.size(); b++){
+        FlowBlock& block = m_blocks[b];
+        bool fallsThrough = b + 1 < m_blocks.size() && m_blocks[b + 1].start == block.end;
+        block.jump = NO_BLOCK;
+        block.returns = false;
+        if(block.endEvent > block.firstEvent){
+            const FlowEvent& last = m_events[block.endEvent - 1];
+            if(is_jump(last.mnemonic) && last.address + last.length == block.end){
+                block.jump = last.target == NO_TARGET ? returnNode : m_targetBlocks[last.target];
+                if(last.mnemonic == MN_JSUB && fallsThrough){
+                    block.returns = true;
+                    m_calls.push_back(b);
+                }
+                if(last.mnemonic == MN_J || last.mnemonic == MN_JSUB || last.mnemonic == MN_RSUB){
+                    fallsThrough = false;
+                }
+            }
+        }
+        block.next = fallsThrough ? b + 1 : NO_BLOCK;
+    }
+}
+
+
+/**
+* Runs the worklist from the entry block until no block's state changes.
+* @param entryBlock: The block of the first instruction, which starts with B and X cleared.
+*/
+void RegisterFlow::propagate(uint32_t entryBlock){
+    uint32_t returnNode = m_blocks.size();
+    m_queued.assign(returnNode + 1, 0);
+    m_worklist.clear();
+    flow_into(entryBlock, RegisterState{0, 0, REG_REACHED | REG_KNOWN_BASE | REG_KNOWN_INDEX});
+    while(!m_worklist.empty()){
+        uint32_t node = m_worklist.back();
+        m_worklist.pop_back();
+        m_queued[node] = 0;
+        RegisterState state = m_states[node];
+        if(node == returnNode){                                         // Back after every call made so far.
+            for(uint32_t call : m_calls){
+                if(m_states[call].known & REG_REACHED){
+                    flow_into(call + 1, state);
+                }
+            }
+            continue;
+        }
+        const FlowBlock& block = m_blocks[node];
+        if(block.returns && (m_states[returnNode].known & REG_REACHED)){
+            flow_into(node + 1, m_states[returnNode]);                  // And after this call, now it is made.
+        }
+        for(uint32_t e = block.firstEvent; e < block.endEvent; e++){
+            const FlowEvent& event = m_events[e];
+            step_registers(state, event.mnemonic, event.flags, event.value);
+        }
+        if(block.next != NO_BLOCK){
+            flow_into(block.next, state);
+        }
+        if(block.jump != NO_BLOCK){
+            flow_into(block.jump, state);
+        }
+    }
+}
+
+
+/**
+* Merges the registers along one path into a block's, queueing the block if that changes them.
+* @param node: The block, or the return node.
+* @param state: The registers at the end of the path.
+*/
+void RegisterFlow::flow_into(uint32_t node, const RegisterState& state){
+    if(!merge_registers(m_states[node], state)){
+        return;
+    }
+    if(!m_queued[node]){
+        m_queued[node] = 1;
+        m_worklist.push_back(node);
+    }
+}
+
+
+/**
+* @param addr: An address.
+* @param hint: The block found for an address shortly before, NO_BLOCK if none; listing order
+*              mostly walks the blocks in turn, so the block is often that one or one just after.
+* @return The block holding the address, NO_BLOCK if no instruction added covers it.
+*/
+uint32_t RegisterFlow::find(uint32_t addr, uint32_t hint) const {
+    for(uint32_t b = hint; b < m_blocks.size() && b - hint < FIND_NEAR_BLOCKS; b++){
+        if(m_blocks[b].start > addr){
+            break;
+        }
+        if(addr < m_blocks[b].end){
+            return b;
+        }
+    }
+    auto after = std::upper_bound(m_blocks.begin(), m_blocks.end(), addr, [](uint32_t a, const FlowBlock& block){
+        return a < block.start;
+    });
+    if(after == m_blocks.begin() || addr >= (after - 1)->end){
+        return NO_BLOCK;
+    }
+    return after - m_blocks.begin() - 1;
+}
+
+
+/**
+* @param addr: The address of an instruction.
+* @param block: The block holding it, from find().
+* @return The registers going into the instruction; nothing known if the block is NO_BLOCK.
+*/
+RegisterState RegisterFlow::state_at(uint32_t addr, uint32_t block) const {
+    if(block == NO_BLOCK){
+        return RegisterState{0, 0, 0};
+    }
+    RegisterState state = m_states[block];
+    const FlowBlock& from = m_blocks[block];
+    for(uint32_t e = from.firstEvent; e < from.endEvent && m_events[e].address < addr; e++){
+        step_registers(state, m_events[e].mnemonic, m_events[e].flags, m_events[e].value);
+    }
+    return state;
+}
+
+
+/**
+* Starts a listing, at the first instruction with B and X cleared.
+* @param entry: The address of the first instruction.
+*/
+void ForwardFlow::clear(uint32_t entry){
+    m_pending.clear();
+    m_pending.push_back(PendingJump{entry, RegisterState{0, 0, REG_REACHED | REG_KNOWN_BASE | REG_KNOWN_INDEX}});
+    m_state = RegisterState{0, 0, 0};
+    m_nextAddr = entry;
+    m_lastAtRisk = NO_BLOCK;
+    m_revisits = 0;
+    m_firstRevisit = NO_BLOCK;
+}
+
+
+/**
+* Moves on to the next instruction of the listing, taking in the jumps forward that go to it.
+* Control only falls into it from an instruction that ends where it starts and goes on.
+* @param addr: The instruction's address.
+* @return The registers going into it; nothing is reached if neither path is known to get there.
+*/
+RegisterState ForwardFlow::reach(uint32_t addr){
+    auto nearest = [](const PendingJump& a, const PendingJump& b){
+        return a.target > b.target;
+    };
+    if(addr != m_nextAddr){
+        m_state = RegisterState{0, 0, 0};
+    }
+    while(!m_pending.empty() && m_pending.front().target <= addr){
+        if(m_pending.front().target == addr){                           // Others land inside an instruction.
+            merge_registers(m_state, m_pending.front().state);
+        }
+        std::pop_heap(m_pending.begin(), m_pending.end(), nearest);
+        m_pending.pop_back();
+    }
+    return m_state;
+}
+
+
+/**
+* Follows the registers through the instruction reach() was last called for.
+* @param line: Its listing line, before its registers are resolved.
+*/
+void ForwardFlow::step(const ListingLine& line){
+    step_registers(m_state, line.mnemonic, line.flags, line.value);
+    m_nextAddr = line.address + line.length;
+    if(!is_jump(line.mnemonic) || !(m_state.known & REG_REACHED)){
+        return;
+    }
+    uint32_t target = jump_target(line.mnemonic, line.flags, line.value);
+    if(target != UNKNOWN_TARGET && target > line.address){
+        m_pending.push_back(PendingJump{target, m_state});
+        std::push_heap(m_pending.begin(), m_pending.end(), [](const PendingJump& a, const PendingJump& b){
+            return a.target > b.target;
+        });
+    }
+    else if(target != UNKNOWN_TARGET && m_lastAtRisk != NO_BLOCK && target <= m_lastAtRisk){
+        m_firstRevisit = m_revisits++ == 0 ? target : m_firstRevisit;
+    }
+    if(line.mnemonic == MN_JSUB){                                       // Back with whatever the subroutine left.
+        m_state.known = REG_REACHED;
+    }
+    else if(line.mnemonic == MN_J || line.mnemonic == MN_RSUB){
+        m_state.known = 0;
+    }
+}
@@ -0,0 +1,144 @@
+#ifndef FLOW_H
+#define FLOW_H
+
+#include <cstdint>
+#include <vector>
+#include "listing.h"
+#include "memstats.h"
+
+const uint32_t NO_BLOCK = 0xFFFFFFFF;
+
+enum RegisterKnown : uint8_t {  // Bits of RegisterState::known.
+    REG_REACHED = 0x01,         // Some path from the first instruction gets here.
+    REG_KNOWN_BASE = 0x02,      // Every such path leaves the same value in B.
+    REG_KNOWN_INDEX = 0x04      // Every such path leaves the same value in X.
+};
+
+/**
+* What the flow analysis knows about the B and X registers at one point of the program.
+*/
+struct RegisterState {
+    int base;
+    int index;
+    uint8_t known;              // RegisterKnown bits; a value is only meaningful with its bit set.
+};
+
+void step_registers(RegisterState& state, uint8_t mnemonic, uint8_t flags, uint32_t value);
+bool merge_registers(RegisterState& into, const RegisterState& state);
+
+/**
+* Register-state analysis over the basic blocks of a decoded program. Instructions are added in
+* listing order; solve() then cuts them into basic blocks at jump targets and after jumps, and
+* propagates the B and X values the loads and CLEAR put there along the jumps with a worklist,
+* so a value is only known where every path reaching it agrees. Subroutines are linked through
+* one return node: every RSUB (or jump whose target is not known statically, such as J @RETADR)
+* flows into it, and it flows into the instruction after every JSUB that is reached. Only the
+* instructions that write B or X or change the flow are kept, so the analysis stays small next
+* to the listing.
+*/
+class RegisterFlow {
+public:
+    void clear();
+    void add(const ListingLine& line);
+    void solve(uint32_t entry);
+
+    bool empty() const {
+        return m_blocks.empty();
+    }
+    uint32_t size() const {                     // Basic blocks, once solved.
+        return m_blocks.size();
+    }
+    uint32_t block_start(uint32_t block) const {
+        return m_blocks[block].start;
+    }
+    uint32_t find(uint32_t addr, uint32_t hint = NO_BLOCK) const;
+    RegisterState state_at(uint32_t addr, uint32_t block) const;
+
+private:
+    /**
+    * An instruction that writes B or X, or jumps.
+    */
+    struct FlowEvent {
+        uint32_t address;
+        uint32_t value;                         // As in ListingLine, before the registers are added.
+        uint32_t target;                        // Index of the jump's target in m_targets, once solving.
+        uint8_t mnemonic;
+        uint8_t flags;
+        uint8_t length;
+    };
+
+    /**
+    * Instructions at consecutive addresses, cut at jump targets and after jumps; sorted by
+    * address once solved.
+    */
+    struct FlowBlock {
+        uint32_t start;
+        uint32_t end;                           // Address just past the last instruction.
+        uint32_t firstEvent;
+        uint32_t endEvent;
+        uint32_t next;                          // The block control falls through to, NO_BLOCK if none.
+        uint32_t jump;                          // The block jumped to, the return node, or NO_BLOCK.
+        bool returns;                           // Whether it ends in a JSUB that comes back to the next block.
+    };
+
+    void end_run();
+    void cut_blocks();
+    void link_blocks();
+    void propagate(uint32_t entryBlock);
+    void flow_into(uint32_t node, const RegisterState& state);
+
+    MemVector<FlowEvent, MEM_FLOW> m_events;
+    MemVector<FlowBlock, MEM_FLOW> m_runs;      // Runs of consecutive instructions, as added.
+    MemVector<FlowBlock, MEM_FLOW> m_blocks;
+    MemVector<uint64_t, MEM_FLOW> m_jumps;      // Target address and event of each jump, sorted.
+    MemVector<uint32_t, MEM_FLOW> m_targets;    // Addresses jumped to, and the entry, sorted.
+    MemVector<uint32_t, MEM_FLOW> m_targetBlocks;   // The block starting at each, NO_BLOCK if none.
+    MemVector<uint32_t, MEM_FLOW> m_calls;      // The blocks that return.
+    MemVector<RegisterState, MEM_FLOW> m_states;    // Going into each block, and the return node last.
+    MemVector<uint32_t, MEM_FLOW> m_worklist;
+    MemVector<uint8_t, MEM_FLOW> m_queued;
+    uint32_t m_nextAddr = 0;                    // Address just past the last instruction added.
+};
+
+/**
+* The register flow analysis for a listing that is only seen once and in order, as --stream
+* decodes it. Each jump forward carries B and X to its target, and a target merges them with the
+* instruction before it as RegisterFlow would, so a register is known where every path seen so far
+* agrees. What a jump back brings, or what a subroutine leaves for the instruction after its JSUB,
+* only shows once those lines are written: after a JSUB nothing is known, and a jump back to lines
+* whose operands a full run may resolve differently is counted by revisits().
+*/
+class ForwardFlow {
+public:
+    void clear(uint32_t entry);
+    RegisterState reach(uint32_t addr);
+    void step(const ListingLine& line);
+
+    void note_operand(uint32_t addr){           // An operand that the jumps back may change.
+        m_lastAtRisk = addr;
+    }
+    uint32_t revisits() const {                 // Jumps back to such an operand.
+        return m_revisits;
+    }
+    uint32_t first_revisit() const {            // The address jumped back to first.
+        return m_firstRevisit;
+    }
+
+private:
+    /**
+    * A jump forward not reached yet, with the registers it carries.
+    */
+    struct PendingJump {
+        uint32_t target;
+        RegisterState state;
+    };
+
+    MemVector<PendingJump, MEM_FLOW> m_pending; // A heap, nearest target on top.
+    RegisterState m_state{0, 0, 0};             // Going into the next instruction by falling through.
+    uint32_t m_nextAddr = 0;
+    uint32_t m_lastAtRisk = NO_BLOCK;
+    uint32_t m_revisits = 0;
+    uint32_t m_firstRevisit = NO_BLOCK;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "gaps.h"
+
+/**
+* Splits one gap at every symbol inside it.
+* @param lo: First address of the gap.
+* @param hi: Address just past the gap.
+* @param after: The text record the gap follows.
+* @param symbols: All symbols sorted by address.
+* @param next: Index of the first symbol that may lie in the gap; left at the first symbol past it.
+* @param regions: The regions are appended here.
+*/
+static void split_gap(uint32_t lo, uint32_t hi, int after, const SymbolIndex& symbols, size_t& next,
+                      GapList& regions){
+    const SymbolTable& table = symbols.all();
+    uint32_t currAddr = lo;
+    uint32_t label = NO_SYMBOL;
+    if(next < table.size() && table.addresses[next] == lo){
+        label = table.ids[next++];
+    }
+    while(currAddr < hi){
+        uint32_t boundary = hi;
+        uint32_t nextLabel = NO_SYMBOL;
+        if(next < table.size() && table.addresses[next] < hi){
+            boundary = table.addresses[next];
+            nextLabel = table.ids[next++];
+        }
+        regions.push_back(GapRegion{currAddr, boundary - currAddr, label, after});
+        currAddr = boundary;
+        label = nextLabel;
+    }
+}
+
+
+/**
+* Plans every reserved region of the program in one sweep. The gaps are the stretches between
+* the end of one text record and the start of the next, before the first record, and between the
+* last record and the end of the program given by the header record. Symbol addresses are
+* merged in as the sweep goes, so the cost is linear in records plus symbols as long as the text
+* records are in address order; a record that goes backwards costs one binary search.
+* @param image: The loaded object file.
+* @param symbols: The symbol index.
+* @param regions: Receives the regions in the order they appear in the listing.
+*/
+void plan_gaps(const ObjectImage& image, const SymbolIndex& symbols, GapList& regions){
+    GapPlanner planner(symbols, image.header.start);
+    regions.clear();
+    for(int i = GAP_LEADING; i < int(image.texts.size()); i++){
+        uint32_t lo = i == GAP_LEADING ? image.header.start : image.texts[i].start + image.texts[i].length;
+        uint32_t hi = i + 1 < int(image.texts.size()) ? image.texts[i + 1].start : image.end_addr();
+        planner.plan(i, lo, hi, regions);
+    }
+}
+
+
+/**
+* Plans the regions of the gap between two addresses, if there is one.
+* @param after: The text record the gap follows, or GAP_LEADING.
+* @param lo: Address just past that text record, or the start of the program.
+* @param hi: Start of the next text record, or the end of the program.
+* @param regions: The regions are appended here.
+*/
+void GapPlanner::plan(int after, uint32_t lo, uint32_t hi, GapList& regions){
+    const SymbolTable& table = m_symbols.all();
+    if(lo >= hi){                                               // Records touch or overlap.
+        return;
+    }
+    if(lo < m_sweepAddr){                                       // Records out of address order.
+        m_next = table.lower_bound(lo);
+    }
+    while(m_next < table.size() && table.addresses[m_next] < lo){
+        m_next++;
+    }
+    split_gap(lo, hi, after, m_symbols, m_next, regions);
+    m_sweepAddr = hi;
+}
@@ -0,0 +1,42 @@
+#ifndef GAPS_H
+#define GAPS_H
+
+#include <cstdint>
+#include <vector>
+#include "loader.h"
+#include "symbols.h"
+#include "memstats.h"
+
+const int GAP_LEADING = -1;         // GapRegion::after of a gap before the first text record.
+
+/**
+* A region of the program not covered by any text record, reserved with RESW (or RESB when its
+* length isn't a whole number of words). Gaps are split wherever a symbol starts.
+*/
+struct GapRegion {
+    uint32_t address;
+    uint32_t length;                // In bytes.
+    uint32_t label;                 // Symbol id at the address, NO_SYMBOL if none.
+    int after;                      // Index of the text record the region follows, or GAP_LEADING.
+};
+
+typedef MemVector<GapRegion, MEM_GAPS> GapList;
+
+/**
+* Plans the regions of one gap at a time, sweeping through the symbols as the gaps go up.
+*/
+class GapPlanner {
+public:
+    GapPlanner(const SymbolIndex& symbols, uint32_t start) : m_symbols(symbols), m_sweepAddr(start) {}
+
+    void plan(int after, uint32_t lo, uint32_t hi, GapList& regions);
+
+private:
+    const SymbolIndex& m_symbols;
+    size_t m_next = 0;                  // The first symbol not below the last gap.
+    uint32_t m_sweepAddr;               // Symbols below this have been passed.
+};
+
+void plan_gaps(const ObjectImage& image, const SymbolIndex& symbols, GapList& regions);
+
+#endif
@@ -0,0 +1,204 @@
+#include "hex.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HEX_X86 1
+#include <immintrin.h>
+#endif
+
+HexTable::HexTable(){
+    for(int c = 0; c < 256; c++){
+        values[c] = INVALID_HEX;
+    }
+    for(int c = '0'; c <= '9'; c++){
+        values[c] = uint8_t(c - '0');
+    }
+    for(int c = 'A'; c <= 'F'; c++){
+        values[c] = uint8_t(c - 'A' + 10);
+        values[c + ('a' - 'A')] = uint8_t(c - 'A' + 10);
+    }
+}
+
+const HexTable g_hexTable;
+
+
+/**
+* Converts pairs of hexadecimal characters into the bytes they represent, with the fastest
+* kernel the CPU supports. The kernel is picked on the first call.
+* @param hex: The hexadecimal characters, two per byte. Upper and lower case are both accepted.
+* @param numBytes: The number of bytes to produce.
+* @param out: Receives the bytes. Undefined if the characters are not all hexadecimals.
+* @return False if any of the characters is not a hexadecimal.
+*/
+bool decode_hex_bytes(const char* hex, size_t numBytes, uint8_t* out){
+    static const HexDecoder decoder = hex_decoder(best_hex_kernel());
+    return decoder(hex, numBytes, out);
+}
+
+
+/**
+* The portable kernel, and the tail of the vector kernels. Validation is folded into the
+* conversion so there is no branch per character.
+*/
+bool decode_hex_scalar(const char* hex, size_t numBytes, uint8_t* out){
+    uint8_t invalid = 0;
+    for(size_t i = 0; i < numBytes; i++){
+        uint8_t high = g_hexTable.values[uint8_t(hex[i * 2])];
+        uint8_t low = g_hexTable.values[uint8_t(hex[i * 2 + 1])];
+        invalid |= (high | low) & 0xF0;             // Only INVALID_HEX has any high bits set.
+        out[i] = uint8_t((high << 4) | low);
+    }
+    return invalid == 0;
+}
+
+
+#ifdef HEX_X86
+
+/**
+* Converts 16 characters to their values, one per byte. Each character is classified as a
+* digit or a letter (case folded by setting bit 5) with signed range compares, which also
+* reject bytes of 0x80 and above since they compare as negative.
+* @param chars: The characters.
+* @param valid: Cleared in every byte whose character is not a hexadecimal.
+* @return The value of each character.
+*/
+static inline __m128i hex_nibbles_sse2(__m128i chars, __m128i& valid){
+    __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                                    _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+    __m128i folded = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+    __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+                                     _mm_cmplt_epi8(folded, _mm_set1_epi8('f' + 1)));
+    valid = _mm_and_si128(valid, _mm_or_si128(isDigit, isLetter));
+    __m128i digits = _mm_and_si128(isDigit, _mm_sub_epi8(chars, _mm_set1_epi8('0')));
+    __m128i letters = _mm_and_si128(isLetter, _mm_sub_epi8(folded, _mm_set1_epi8('a' - 10)));
+    return _mm_or_si128(digits, letters);
+}
+
+
+/**
+* Joins the nibbles of each 16-bit lane (high nibble first in memory) into one byte per lane.
+*/
+static inline __m128i hex_join_sse2(__m128i nibbles){
+    __m128i high = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00FF)), 4);
+    return _mm_or_si128(high, _mm_srli_epi16(nibbles, 8));
+}
+
+
+/**
+* SSE2 kernel: 32 characters to 16 bytes per step.
+*/
+static bool decode_hex_sse2(const char* hex, size_t numBytes, uint8_t* out){
+    __m128i valid = _mm_set1_epi8(-1);
+    size_t i = 0;
+    for(; i + 16 <= numBytes; i += 16){
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex + i * 2));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex + i * 2 + 16));
+        __m128i bytes = _mm_packus_epi16(hex_join_sse2(hex_nibbles_sse2(first, valid)),
+                                         hex_join_sse2(hex_nibbles_sse2(second, valid)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+    }
+    bool ok = _mm_movemask_epi8(valid) == 0xFFFF;
+    return decode_hex_scalar(hex + i * 2, numBytes - i, out + i) && ok;
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i hex_nibbles_avx2(__m256i chars, __m256i& valid){
+    __m256i isDigit = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('0' - 1)),
+                                       _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chars));
+    __m256i folded = _mm256_or_si256(chars, _mm256_set1_epi8(0x20));
+    __m256i isLetter = _mm256_and_si256(_mm256_cmpgt_epi8(folded, _mm256_set1_epi8('a' - 1)),
+                                        _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), folded));
+    valid = _mm256_and_si256(valid, _mm256_or_si256(isDigit, isLetter));
+    __m256i digits = _mm256_and_si256(isDigit, _mm256_sub_epi8(chars, _mm256_set1_epi8('0')));
+    __m256i letters = _mm256_and_si256(isLetter, _mm256_sub_epi8(folded, _mm256_set1_epi8('a' - 10)));
+    return _mm256_or_si256(digits, letters);
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i hex_join_avx2(__m256i nibbles){
+    __m256i high = _mm256_slli_epi16(_mm256_and_si256(nibbles, _mm256_set1_epi16(0x00FF)), 4);
+    return _mm256_or_si256(high, _mm256_srli_epi16(nibbles, 8));
+}
+
+
+/**
+* AVX2 kernel: 64 characters to 32 bytes per step. The pack works within 128-bit lanes, so the
+* quarters are put back in order with a permute.
+*/
+__attribute__((target("avx2")))
+static bool decode_hex_avx2(const char* hex, size_t numBytes, uint8_t* out){
+    __m256i valid = _mm256_set1_epi8(-1);
+    size_t i = 0;
+    for(; i + 32 <= numBytes; i += 32){
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hex + i * 2));
+        __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hex + i * 2 + 32));
+        __m256i packed = _mm256_packus_epi16(hex_join_avx2(hex_nibbles_avx2(first, valid)),
+                                             hex_join_avx2(hex_nibbles_avx2(second, valid)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    bool ok = _mm256_movemask_epi8(valid) == -1;
+    return decode_hex_sse2(hex + i * 2, numBytes - i, out + i) && ok;
+}
+
+#endif
+
+
+/**
+* @param kernel: A HexKernel.
+* @return True if the kernel was compiled in and the CPU can run it.
+*/
+bool hex_kernel_available(uint8_t kernel){
+    switch(kernel){
+    case HEX_SCALAR:
+        return true;
+#ifdef HEX_X86
+    case HEX_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case HEX_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+
+/**
+* @return The fastest kernel the CPU can run.
+*/
+HexKernel best_hex_kernel(){
+    for(int kernel = HEX_KERNEL_COUNT - 1; kernel > HEX_SCALAR; kernel--){
+        if(hex_kernel_available(kernel)){
+            return HexKernel(kernel);
+        }
+    }
+    return HEX_SCALAR;
+}
+
+
+/**
+* @param kernel: A HexKernel the CPU can run (see hex_kernel_available()).
+* @return The kernel's entry point.
+*/
+HexDecoder hex_decoder(uint8_t kernel){
+    switch(kernel){
+#ifdef HEX_X86
+    case HEX_SSE2:
+        return decode_hex_sse2;
+    case HEX_AVX2:
+        return decode_hex_avx2;
+#endif
+    default:
+        return decode_hex_scalar;
+    }
+}
+
+
+/**
+* @return The kernel's name, as used by hexbench.
+*/
+const char* hex_kernel_name(uint8_t kernel){
+    static const char* const names[HEX_KERNEL_COUNT] = {"scalar", "sse2", "avx2"};
+    return kernel < HEX_KERNEL_COUNT ? names[kernel] : "unknown";
+}
@@ -0,0 +1,35 @@
+#ifndef HEX_H
+#define HEX_H
+
+#include <cstddef>
+#include <cstdint>
+
+const uint8_t INVALID_HEX = 0xFF;
+
+/**
+* Lookup table from an ASCII character to its hexadecimal value, INVALID_HEX for non-hex characters.
+*/
+struct HexTable {
+    uint8_t values[256];
+    HexTable();
+};
+
+extern const HexTable g_hexTable;
+
+enum HexKernel : uint8_t {
+    HEX_SCALAR,         // One table lookup per character.
+    HEX_SSE2,           // 32 characters per step; every x86-64 CPU has SSE2.
+    HEX_AVX2,           // 64 characters per step, if the CPU reports AVX2 at run time.
+    HEX_KERNEL_COUNT
+};
+
+typedef bool (*HexDecoder)(const char* hex, size_t numBytes, uint8_t* out);
+
+bool decode_hex_bytes(const char* hex, size_t numBytes, uint8_t* out);
+bool decode_hex_scalar(const char* hex, size_t numBytes, uint8_t* out);
+bool hex_kernel_available(uint8_t kernel);
+HexKernel best_hex_kernel();
+HexDecoder hex_decoder(uint8_t kernel);
+const char* hex_kernel_name(uint8_t kernel);
+
+#endif
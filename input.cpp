@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "input.h"
+
+InputFile::~InputFile(){
+    close();
+}
+
+
+/**
+* Opens an input file. Regular files are memory-mapped; anything else, including stdin when the
+* path is "-", is read into a buffer instead.
+* @param path: The file to open, or "-" for stdin.
+* @param error: Receives a description of the failure, if any.
+* @param map: Whether a regular file may be mapped. A file that another process may truncate
+*             while it is read is read into the buffer instead, as touching a mapped page past
+*             its new end raises SIGBUS.
+* @return True if the file's contents are available through text().
+*/
+bool InputFile::open(const std::string& path, std::string& error, bool map){
+    close();
+    if(path == "-"){
+        return read_all(STDIN_FILENO, error);
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    struct stat info;
+    bool ok;
+    if(map && fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0){
+        void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping != MAP_FAILED){
+            madvise(mapping, info.st_size, MADV_SEQUENTIAL);        // Both parsers make a single forward pass.
+            m_map = mapping;
+            m_data = static_cast<const char*>(mapping);
+            m_size = info.st_size;
+            ok = true;
+        }
+        else{
+            ok = read_all(fd, error);
+        }
+    }
+    else{
+        ok = read_all(fd, error);
+    }
+    ::close(fd);
+    if(!ok){
+        error = path + ": " + error;
+    }
+    return ok;
+}
+
+
+/**
+* Releases the mapping or buffer. Views previously returned by text() become invalid.
+*/
+void InputFile::close(){
+    if(m_map != nullptr){
+        munmap(m_map, m_size);
+        m_map = nullptr;
+    }
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+    m_data = nullptr;
+    m_size = 0;
+}
+
+
+/**
+* Reads everything from a file descriptor that cannot be mapped, growing the buffer geometrically.
+* @param fd: The file descriptor to read until end of file.
+* @param error: Receives a description of the failure, if any.
+* @return True if end of file was reached.
+*/
+bool InputFile::read_all(int fd, std::string& error){
+    size_t used = 0;
+    m_buffer.resize(1 << 16);
+    while(true){
+        if(used == m_buffer.size()){
+            m_buffer.resize(m_buffer.size() * 2);
+        }
+        ssize_t got = ::read(fd, m_buffer.data() + used, m_buffer.size() - used);
+        if(got < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            error = std::string("read failed: ") + std::strerror(errno);
+            return false;
+        }
+        if(got == 0){
+            break;
+        }
+        used += got;
+    }
+    m_buffer.resize(used);
+    m_data = m_buffer.data();
+    m_size = used;
+    return true;
+}
+
+
+/**
+* Returns the next line of the text.
+* @param line: Receives a view of the line, without its line ending.
+* @return False once the text is exhausted.
+*/
+bool LineReader::next(std::string_view& line){
+    if(m_rest.empty()){
+        return false;
+    }
+    const char* newline = static_cast<const char*>(std::memchr(m_rest.data(), '\n', m_rest.size()));
+    size_t length = newline != nullptr ? size_t(newline - m_rest.data()) : m_rest.size();
+    line = m_rest.substr(0, length);
+    m_rest.remove_prefix(newline != nullptr ? length + 1 : length);
+    if(!line.empty() && line.back() == '\r'){
+        line.remove_suffix(1);
+    }
+    m_lineNum++;
+    return true;
+}
+
+
+const size_t LINE_STREAM_BUFFER = 1 << 20;
+
+
+LineStream::~LineStream(){
+    if(m_fd > STDERR_FILENO){
+        ::close(m_fd);
+    }
+}
+
+
+/**
+* Opens a file to be read a line at a time.
+* @param path: The file to open, or "-" for stdin.
+* @param error: Receives a description of the failure, if any.
+* @return True if the file is open.
+*/
+bool LineStream::open(const std::string& path, std::string& error){
+    m_fd = path == "-" ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY);
+    if(m_fd < 0){
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    m_buffer.resize(LINE_STREAM_BUFFER);
+    return true;
+}
+
+
+/**
+* Returns the next line of the file.
+* @param line: Receives a view of the line, without its line ending, valid until the next call.
+* @return False at the end of the file, or if it cannot be read (see error()).
+*/
+bool LineStream::next(std::string_view& line){
+    const char* newline;
+    while((newline = static_cast<const char*>(std::memchr(m_buffer.data() + m_begin, '\n', m_end - m_begin))) == nullptr){
+        if(m_eof){
+            if(m_begin == m_end){
+                return false;
+            }
+            newline = m_buffer.data() + m_end;                      // The last line has no line ending.
+            break;
+        }
+        if(!fill()){
+            return false;
+        }
+    }
+    size_t length = newline - (m_buffer.data() + m_begin);
+    line = std::string_view(m_buffer.data() + m_begin, length);
+    m_begin = std::min(m_end, m_begin + length + 1);
+    if(!line.empty() && line.back() == '\r'){
+        line.remove_suffix(1);
+    }
+    m_lineNum++;
+    return true;
+}
+
+
+/**
+* Moves the unread text to the front of the buffer and reads more after it, growing the buffer
+* only if a single line fills it.
+* @return False if the file cannot be read.
+*/
+bool LineStream::fill(){
+    m_end -= m_begin;
+    std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end);
+    m_begin = 0;
+    if(m_end == m_buffer.size()){
+        m_buffer.resize(m_buffer.size() * 2);
+    }
+    while(true){
+        ssize_t got = ::read(m_fd, m_buffer.data() + m_end, m_buffer.size() - m_end);
+        if(got < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            m_error = std::string("read failed: ") + std::strerror(errno);
+            return false;
+        }
+        m_eof = got == 0;
+        m_end += got;
+        return true;
+    }
+}
+
+
+/**
+* Splits a line into whitespace-separated tokens without copying them.
+* @param line: The line to split.
+* @param tokens: Receives views of up to maxTokens tokens.
+* @param maxTokens: The number of tokens wanted.
+* @return The number of tokens found, at most maxTokens.
+*/
+int split_tokens(std::string_view line, std::string_view* tokens, int maxTokens){
+    int count = 0;
+    size_t pos = 0;
+    while(count < maxTokens){
+        while(pos < line.size() && (line[pos] == ' ' || line[pos] == '\t')){
+            pos++;
+        }
+        if(pos == line.size()){
+            break;
+        }
+        size_t start = pos;
+        while(pos < line.size() && line[pos] != ' ' && line[pos] != '\t'){
+            pos++;
+        }
+        tokens[count++] = line.substr(start, pos - start);
+    }
+    return count;
+}
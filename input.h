@@ -0,0 +1,96 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "memstats.h"
+
+/**
+* Read-only view of a whole input file. Regular files are memory-mapped so the parsers read the
+* page cache directly; pipes, terminals, stdin ("-") and files that may be rewritten while they
+* are read fall back to one buffered read.
+*/
+class InputFile {
+public:
+    InputFile() = default;
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+    ~InputFile();
+
+    bool open(const std::string& path, std::string& error, bool map = true);
+    void close();
+
+    std::string_view text() const {
+        return std::string_view(m_data, m_size);
+    }
+
+private:
+    bool read_all(int fd, std::string& error);
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    void* m_map = nullptr;          // Non-null while the file is memory-mapped.
+    MemVector<char, MEM_INPUT> m_buffer;    // Holds the contents of inputs that cannot be mapped.
+};
+
+/**
+* Splits text into lines without copying them. Line endings, including the CR of a CRLF
+* ending, are not part of the returned lines.
+*/
+class LineReader {
+public:
+    explicit LineReader(std::string_view text) : m_rest(text) {}
+
+    bool next(std::string_view& line);
+
+    int line_number() const {
+        return m_lineNum;
+    }
+
+private:
+    std::string_view m_rest;
+    int m_lineNum = 0;
+};
+
+/**
+* Reads a file one line at a time through a fixed-size buffer, so memory does not grow with the
+* file. Lines are split as by LineReader.
+*/
+class LineStream {
+public:
+    LineStream() = default;
+    LineStream(const LineStream&) = delete;
+    LineStream& operator=(const LineStream&) = delete;
+    ~LineStream();
+
+    bool open(const std::string& path, std::string& error);
+    bool next(std::string_view& line);
+
+    int line_number() const {
+        return m_lineNum;
+    }
+
+    /**
+    * @return Why next() stopped early, or an empty string if it reached the end of the file.
+    */
+    const std::string& error() const {
+        return m_error;
+    }
+
+private:
+    bool fill();
+
+    int m_fd = -1;
+    MemVector<char, MEM_INPUT> m_buffer;    // Only grows for a line longer than the buffer.
+    size_t m_begin = 0;                     // Unread text is m_buffer[m_begin, m_end).
+    size_t m_end = 0;
+    bool m_eof = false;
+    int m_lineNum = 0;
+    std::string m_error;
+};
+
+int split_tokens(std::string_view line, std::string_view* tokens, int maxTokens);
+
+#endif
@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include "link.h"
+#include "input.h"
+
+/**
+* Packs a name of up to six characters into a key, padded with spaces as the records pad it.
+*/
+static uint64_t name_key(std::string_view name){
+    uint64_t key = 0;
+    for(size_t i = 0; i < 6; i++){
+        key = key << 8 | uint8_t(i < name.size() ? name[i] : ' ');
+    }
+    return key;
+}
+
+
+/**
+* @return The name without the spaces that pad it to six characters.
+*/
+static std::string_view trim_name(std::string_view name){
+    while(!name.empty() && name.back() == ' '){
+        name.remove_suffix(1);
+    }
+    return name;
+}
+
+
+void ExternalSymbolIndex::clear(){
+    m_entries.clear();
+    m_sorted.clear();
+}
+
+
+/**
+* Adds a control section or an exported symbol; only found once built.
+*/
+void ExternalSymbolIndex::add(std::string_view name, uint32_t address, bool section){
+    m_entries.push_back(Entry{trim_name(name), address, section});
+}
+
+
+/**
+* Sorts the names for find(). After this the index is only read.
+* @param error: Receives the name defined twice, if any.
+* @return False if two sections or exported symbols share a name.
+*/
+bool ExternalSymbolIndex::build(std::string& error){
+    m_sorted.clear();
+    m_sorted.reserve(m_entries.size());
+    for(const Entry& entry : m_entries){
+        m_sorted.push_back(KeyedAddress{name_key(entry.name), entry.address});
+    }
+    std::sort(m_sorted.begin(), m_sorted.end(), [](const KeyedAddress& a, const KeyedAddress& b){
+        return a.key < b.key;
+    });
+    for(size_t i = 1; i < m_sorted.size(); i++){
+        if(m_sorted[i].key == m_sorted[i - 1].key){
+            char name[6];
+            for(int c = 0; c < 6; c++){
+                name[c] = char(m_sorted[i].key >> (40 - 8 * c));
+            }
+            error = "external symbol " + std::string(trim_name(std::string_view(name, 6))) + " is defined twice";
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+* @param name: A section or symbol name, padded with spaces or not.
+* @param address: Receives its address in the linked program.
+* @return False if no section or define record has that name.
+*/
+bool ExternalSymbolIndex::find(std::string_view name, uint32_t& address) const {
+    uint64_t key = name_key(name);
+    auto found = std::lower_bound(m_sorted.begin(), m_sorted.end(), key, [](const KeyedAddress& entry, uint64_t k){
+        return entry.key < k;
+    });
+    if(found == m_sorted.end() || found->key != key){
+        return false;
+    }
+    address = found->address;
+    return true;
+}
+
+
+/**
+* The first pass: finds the control sections of every object file, places each right after the
+* one before it and builds the external symbol table. Only the header, define and end records are
+* read; the rest are left for load().
+* @param objTexts: The contents of the object files, in link order.
+* @param error: Receives a description of the first problem found, if any.
+* @return True if every file is made of whole control sections and no name is defined twice.
+*/
+bool Linker::scan(const std::vector<std::string_view>& objTexts, std::string& error){
+    m_sections.clear();
+    m_externals.clear();
+    m_offsets.clear();
+    m_firstSections.clear();
+    m_end = 0;
+    for(uint32_t i = 0; i < objTexts.size(); i++){
+        m_firstSections.push_back(m_sections.size());
+        if(!scan_object(objTexts[i], i, error)){
+            if(objTexts.size() > 1){
+                error = "object file " + std::to_string(i + 1) + ": " + error;
+            }
+            return false;
+        }
+    }
+    m_firstSections.push_back(m_sections.size());
+    for(const ControlSection& section : m_sections){
+        m_offsets.push_back(section.address - section.start);
+    }
+    return m_externals.build(error);
+}
+
+
+/**
+* Scans the control sections of one object file.
+* @param text: The contents of the object file.
+* @param object: Its place in link order.
+* @param error: Receives a description of the first problem found, if any.
+* @return True if the file is made of whole control sections.
+*/
+bool Linker::scan_object(std::string_view text, uint32_t object, std::string& error){
+    LineReader lines(text);
+    std::string_view line;
+    size_t first = m_sections.size();
+    bool open = false;                                                  // Between a header and its end record.
+    auto fail = [&](const std::string& what){
+        error = "line " + std::to_string(lines.line_number()) + ": " + what;
+        return false;
+    };
+    while(lines.next(line)){
+        if(line.empty()){
+            continue;
+        }
+        if(line[0] == 'H'){
+            HeaderRecord header;
+            if(open){
+                return fail("header record before the end record");
+            }
+            if(!parse_header(line, header, error)){
+                return fail(error);
+            }
+            ControlSection& section = m_sections.emplace_back();
+            section.name = line.substr(1, 6);
+            section.records = line;
+            section.object = object;
+            section.firstLine = lines.line_number() - 1;
+            section.start = header.start;
+            section.length = header.length;
+            section.address = m_sections.size() == 1 ? header.start : m_end;    // The first stays where it is.
+            section.namesEntry = false;
+            m_end = section.address + section.length;
+            m_externals.add(section.name, section.address, true);
+            open = true;
+            continue;
+        }
+        if(!open){
+            return fail(m_sections.size() == first ? "record before the header record" : "record after the end record");
+        }
+        ControlSection& section = m_sections.back();
+        if(line[0] == 'D'){                                             // DNAME  000000NAME  000000...
+            if((line.length() - 1) % 12 != 0){
+                return fail("malformed define record");
+            }
+            for(size_t pos = 1; pos < line.length(); pos += 12){
+                uint32_t addr;
+                if(!parse_hex_field(line, pos + 6, 6, addr)){
+                    return fail("malformed define record");
+                }
+                m_externals.add(line.substr(pos, 6), section.address + (addr - section.start), false);
+            }
+        }
+        else if(line[0] == 'E'){
+            section.namesEntry = line.length() > 1;
+            section.records = std::string_view(section.records.data(), line.data() + line.size() - section.records.data());
+            open = false;
+        }
+    }
+    if(m_sections.size() == first){
+        error = "missing header record";
+        return false;
+    }
+    if(open){
+        error = "missing end record";
+        return false;
+    }
+    return true;
+}
+
+
+/**
+* The second pass: loads every control section found by scan() into one image of the linked
+* program, several sections at a time. Each writes only its own stretch of the image and only
+* reads the external symbol table, so the threads share nothing else.
+* @param image: Receives the linked program: the first section's name, every text and modification
+*               record moved to where its section went, and the entry point of the first end record
+*               that names one (the start of the program if none does).
+* @param threads: Threads loading sections.
+* @param error: Receives a description of the first problem found, if any.
+* @return True if every section was loaded and every modification record applied.
+*/
+bool Linker::load(ObjectImage& image, int threads, std::string& error){
+    image.clear();
+    image.header.name = std::string(m_sections[0].name);
+    image.header.start = m_sections[0].address;
+    image.header.length = length();
+    image.reset_bytes(image.header.length);
+    size_t count = m_sections.size();
+    if(m_parts.size() < count){
+        m_parts.resize(count);
+    }
+
+    std::atomic<size_t> nextSection(0);
+    auto worker = [&](){
+        size_t s;
+        while((s = nextSection++) < count){
+            load_section(m_sections[s], m_parts[s], image);
+        }
+    };
+    std::vector<std::thread> pool;
+    for(int i = 1; i < threads && size_t(i) < count; i++){
+        pool.emplace_back(worker);
+    }
+    worker();
+    for(std::thread& thread : pool){
+        thread.join();
+    }
+
+    bool namedEntry = false;
+    image.end.firstInstr = image.header.start;
+    for(size_t s = 0; s < count; s++){
+        const ControlSection& section = m_sections[s];
+        const ObjectImage& part = m_parts[s];
+        if(!section.error.empty()){
+            error = section.error;
+            if(m_firstSections.size() > 2){
+                error = "object file " + std::to_string(section.object + 1) + ": " + error;
+            }
+            return false;
+        }
+        uint32_t offset = m_offsets[s];
+        for(const TextRecord& text : part.texts){
+            image.add_text(TextRecord{text.start + offset, text.length});
+        }
+        for(ModRecord mod : part.mods){
+            mod.addr += offset;
+            image.add_mod(mod);
+        }
+        if(section.namesEntry && !namedEntry){
+            image.end.firstInstr = part.end.firstInstr + offset;
+            namedEntry = true;
+        }
+    }
+    image.hasHeader = true;
+    image.hasEnd = true;
+    return true;
+}
+
+
+/**
+* Loads one control section: parses its records into an image of its own, relocates it and copies
+* its bytes to where it goes in the linked image.
+* @param section: The section; receives the error if it cannot be loaded.
+* @param part: The section's own image, reused from one link to the next.
+* @param image: The linked image, sized for every section.
+* @return True if the section was loaded.
+*/
+bool Linker::load_section(ControlSection& section, ObjectImage& part, ObjectImage& image){
+    section.error.clear();
+    part.clear();
+    if(!parse_obj(section.records, part, section.error, section.firstLine) || !relocate(section, part)){
+        return false;
+    }
+    if(!part.bytes.empty()){
+        std::memcpy(image.fill_at(section.address), part.bytes.data(), part.bytes.size());
+    }
+    return true;
+}
+
+
+/**
+* Applies every modification record of a section to its image in one sweep, once its text records
+* are in: a record with a symbol adds (or subtracts) that symbol's address in the linked program,
+* and one without adds how far the section moved. The field is the given number of hexadecimals
+* ending at a byte boundary, so a Format 4 address (five) leaves the flags in the byte's high half.
+* @param section: The section; receives the error if a record cannot be applied.
+* @param part: The section's own image.
+* @return False if a record names an unknown symbol or lies outside the section.
+*/
+bool Linker::relocate(ControlSection& section, ObjectImage& part){
+    for(const ModRecord& mod : part.mods){
+        uint32_t value = section.address - section.start;
+        if(mod.sign != '\0'){
+            std::string_view symbol(mod.symbol, sizeof(mod.symbol));
+            if(!m_externals.find(symbol, value)){
+                section.error = "control section " + std::string(trim_name(section.name)) +
+                                ": undefined external symbol " + std::string(trim_name(symbol));
+                return false;
+            }
+            if(mod.sign == '-'){
+                value = 0 - value;
+            }
+        }
+        uint32_t bytes = (mod.halfBytes + 1) / 2;
+        if(mod.halfBytes == 0 || mod.halfBytes > 8 || mod.addr < part.header.start ||
+           uint64_t(mod.addr) + bytes > part.end_addr()){
+            section.error = "control section " + std::string(trim_name(section.name)) +
+                            ": modification record outside the section";
+            return false;
+        }
+        uint8_t* field = part.fill_at(mod.addr);
+        uint64_t word = 0;
+        for(uint32_t i = 0; i < bytes; i++){
+            word = word << 8 | field[i];
+        }
+        uint64_t mask = (uint64_t(1) << (4 * mod.halfBytes)) - 1;
+        word = (word & ~mask) | ((word + value) & mask);
+        for(uint32_t i = bytes; i-- > 0;){
+            field[i] = uint8_t(word);
+            word >>= 8;
+        }
+    }
+    return true;
+}
+
+
+/**
+* @param object: An object file, by its place in link order.
+* @return What the addresses of each of its control sections move by, in order, for the symbols
+*         its symbol file lists section by section.
+*/
+ArrayView<uint32_t> Linker::offsets(uint32_t object) const {
+    uint32_t first = m_firstSections[object];
+    return ArrayView<uint32_t>{m_offsets.data() + first, m_firstSections[object + 1] - first};
+}
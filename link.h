@@ -0,0 +1,104 @@
+#ifndef LINK_H
+#define LINK_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "loader.h"
+#include "memstats.h"
+
+/**
+* One control section of a linked program, as the first pass found it.
+*/
+struct ControlSection {
+    std::string_view name;          // From the header record, as the six characters appear there.
+    std::string_view records;       // From the header record to the end record, in the object file.
+    uint32_t object;                // The object file it is in, in link order.
+    int firstLine;                  // Line of its header record in that file, less one.
+    uint32_t start;                 // Starting address from the header record, which its records count from.
+    uint32_t length;
+    uint32_t address;               // Where it is loaded in the linked program (CSADDR).
+    bool namesEntry;                // Whether its end record names the first instruction.
+    std::string error;              // Why the second pass could not load it, if it could not.
+};
+
+/**
+* The external symbol table (ESTAB) of a linked program: every control section and every symbol
+* a define record exports, at its address in the linked program. It is built once by the first
+* pass and only read afterwards, so the sections are loaded against it on several threads without
+* locking. Names are at most six characters, so each is packed into one 64-bit key and a lookup is
+* a binary search over a sorted array of keys.
+*/
+class ExternalSymbolIndex {
+public:
+    /**
+    * A control section or an exported symbol.
+    */
+    struct Entry {
+        std::string_view name;      // Without the spaces that pad it in its record.
+        uint32_t address;
+        bool section;               // Whether it names a control section.
+    };
+
+    void clear();
+    void add(std::string_view name, uint32_t address, bool section);
+    bool build(std::string& error);
+    bool find(std::string_view name, uint32_t& address) const;
+
+    const MemVector<Entry, MEM_SYMBOLS>& entries() const {     // In the order they were added.
+        return m_entries;
+    }
+
+private:
+    /**
+    * A packed name and its address, in m_sorted.
+    */
+    struct KeyedAddress {
+        uint64_t key;
+        uint32_t address;
+    };
+
+    MemVector<Entry, MEM_SYMBOLS> m_entries;
+    MemVector<KeyedAddress, MEM_SYMBOLS> m_sorted;  // By key, once built.
+};
+
+/**
+* A two-pass linking loader for object files of one or more control sections, which use define
+* (D), refer (R) and modification (M) records. The first pass places the sections one after
+* another from the starting address of the first and builds the external symbol table from the
+* header and define records. The second pass loads every section on its own, several at a time:
+* its records are parsed into an image of its own, all of its modification records are then
+* applied to that image in one go, and the bytes are copied into place in the linked image, which
+* then reads as one program to the rest of the disassembler.
+*/
+class Linker {
+public:
+    bool scan(const std::vector<std::string_view>& objTexts, std::string& error);
+    bool load(ObjectImage& image, int threads, std::string& error);
+
+    const std::vector<ControlSection>& sections() const {      // In link order, after scan().
+        return m_sections;
+    }
+    const ExternalSymbolIndex& externals() const {
+        return m_externals;
+    }
+    uint32_t length() const {                   // Bytes of the linked program.
+        return m_sections.empty() ? 0 : m_end - m_sections[0].address;
+    }
+    ArrayView<uint32_t> offsets(uint32_t object) const;
+
+private:
+    bool scan_object(std::string_view text, uint32_t object, std::string& error);
+    bool load_section(ControlSection& section, ObjectImage& part, ObjectImage& image);
+    bool relocate(ControlSection& section, ObjectImage& part);
+
+    std::vector<ControlSection> m_sections;
+    std::vector<ObjectImage> m_parts;           // One per section, reused from one link to the next.
+    ExternalSymbolIndex m_externals;
+    MemVector<uint32_t, MEM_SYMBOLS> m_offsets; // What each section's addresses move by, in link order.
+    MemVector<uint32_t, MEM_SYMBOLS> m_firstSections;  // Of each object file, and the number of sections.
+    uint32_t m_end = 0;                         // Address just past the last section.
+};
+
+#endif
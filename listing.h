@@ -0,0 +1,42 @@
+#ifndef LISTING_H
+#define LISTING_H
+
+#include <cstdint>
+#include <vector>
+#include "symbols.h"
+#include "memstats.h"
+
+enum LineKind : uint8_t {
+    LINE_START,         // START directive naming the program.
+    LINE_INSTRUCTION,   // A decoded instruction.
+    LINE_BASE,          // BASE directive following a LDB instruction.
+    LINE_LTORG,         // LTORG directive preceding a literal pool.
+    LINE_LITERAL,       // A literal defined in a literal pool.
+    LINE_RESW,          // Words reserved between text records.
+    LINE_END,           // END directive naming the first instruction.
+    LINE_RESB,          // Bytes reserved between text records, when not a whole number of words.
+    LINE_CSECT          // CSECT directive where a control section after the first starts, when linked.
+};
+
+/**
+* One line of the listing. No text is stored: labels and operands are symbol ids, object code is
+* an offset into the byte image, and everything else is rendered from the ids and flags at output
+* time.
+*/
+struct ListingLine {
+    uint32_t address;
+    uint32_t label;         // Symbol id of the line's label, NO_SYMBOL if it has none.
+    uint32_t operand;       // Symbol id of the operand (or of the literal itself), NO_SYMBOL if none.
+    uint32_t value;         // Target address or constant, Format 2 registers (r1 << 4 | r2), or word/byte count.
+    uint32_t objOffset;     // Offset of the object code in the byte image.
+    uint8_t kind;           // LineKind.
+    uint8_t mnemonic;       // Mnemonic id of an instruction.
+    uint8_t length;         // Bytes of object code; equal to the format for instructions.
+    uint8_t flags;          // nixbpe bits of a Format 3/4 instruction.
+};
+
+static_assert(sizeof(ListingLine) == 24, "listing lines are meant to stay compact");
+
+typedef MemVector<ListingLine, MEM_LISTING> Listing;
+
+#endif
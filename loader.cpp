@@ -0,0 +1,284 @@
+#include "loader.h"
+#include "input.h"
+#include "hex.h"
+#include <cstring>
+
+/**
+* Loads the object code into an ObjectImage. Each record is parsed and validated exactly once;
+* the disassembler never looks at the record text again.
+* @param text: The contents of the object file, or the records of one of its control sections.
+* @param image: Receives the typed records and the program's byte image.
+* @param error: Receives a description of the first problem found, if any.
+* @param lineOffset: Lines of the object file before text, for the line numbers in errors.
+* @return True if the whole file was loaded.
+*/
+bool parse_obj(std::string_view text, ObjectImage& image, std::string& error, int lineOffset){
+    LineReader lines(text);
+    std::string_view line;
+    while(lines.next(line)){
+        if(line.empty()){
+            continue;
+        }
+        if(!parse_record(line, image, error)){
+            error = "line " + std::to_string(lines.line_number() + lineOffset) + ": " + error;
+            return false;
+        }
+    }
+
+    if(!image.hasHeader){
+        error = "missing header record";
+        return false;
+    }
+    if(!image.hasEnd){
+        error = "missing end record";
+        return false;
+    }
+    return true;
+}
+
+
+/**
+* Parses a single record and adds it to the image. Text record object code is hex-decoded
+* straight into the byte image at the record's address.
+* @param record: The record, without its line ending.
+* @param image: The image being loaded.
+* @param error: Receives a description of what is wrong with the record, if anything.
+* @return True if the record is valid.
+*/
+bool parse_record(std::string_view record, ObjectImage& image, std::string& error){
+    char type = record[0];
+    if(type != 'H' && !image.hasHeader){
+        error = "record before the header record";
+        return false;
+    }
+    if(image.hasEnd){
+        error = type == 'H' ? "more than one control section" : "record after the end record";
+        return false;
+    }
+
+    switch(type){
+    case 'H':{
+        if(image.hasHeader){
+            error = "more than one header record";
+            return false;
+        }
+        if(!parse_header(record, image.header, error)){
+            return false;
+        }
+        image.reset_bytes(image.header.length);
+        image.hasHeader = true;
+        return true;
+    }
+    case 'T':{
+        TextRecord text;
+        if(record.length() < 9 || !parse_hex_field(record, 1, 6, text.start) ||
+           !parse_hex_field(record, 7, 2, text.length)){
+            error = "malformed text record";
+            return false;
+        }
+        if(record.length() != 9 + text.length * 2){
+            error = "text record length " + std::to_string(text.length) + " does not match its object code";
+            return false;
+        }
+        if(text.start < image.header.start || text.start + text.length > image.end_addr()){
+            error = "text record lies outside the program";
+            return false;
+        }
+        if(!decode_hex_bytes(record.data() + 9, text.length, image.fill_at(text.start))){
+            error = "text record contains a non-hexadecimal character";
+            return false;
+        }
+        image.add_text(text);
+        return true;
+    }
+    case 'M':{
+        ModRecord mod;
+        uint32_t halfBytes;
+        if(record.length() < 9 || !parse_hex_field(record, 1, 6, mod.addr) ||
+           !parse_hex_field(record, 7, 2, halfBytes)){
+            error = "malformed modification record";
+            return false;
+        }
+        mod.halfBytes = uint8_t(halfBytes);
+        mod.sign = '\0';
+        std::memset(mod.symbol, ' ', sizeof(mod.symbol));
+        if(record.length() > 9){                                        // M00000705+RDREC
+            if(record[9] != '+' && record[9] != '-'){
+                error = "malformed modification record";
+                return false;
+            }
+            mod.sign = record[9];
+            std::string_view symbol = record.substr(10, sizeof(mod.symbol));
+            std::memcpy(mod.symbol, symbol.data(), symbol.size());
+        }
+        image.add_mod(mod);
+        return true;
+    }
+    case 'D':                                                           // Only read when linking (see
+    case 'R':                                                           // Linker::scan()).
+        return true;
+    case 'E':{
+        image.end.firstInstr = image.header.start;                     // A bare E record names no first instruction.
+        if(record.length() > 1 && (record.length() < 7 || !parse_hex_field(record, 1, 6, image.end.firstInstr))){
+            error = "malformed end record";
+            return false;
+        }
+        image.hasEnd = true;
+        return true;
+    }
+    default:
+        error = std::string("unknown record type '") + type + "'";
+        return false;
+    }
+}
+
+
+/**
+* Parses a header record on its own.
+* @param record: The record, without its line ending.
+* @param header: Receives the program name, start and length.
+* @param error: Receives a description of what is wrong with the record, if anything.
+* @return True if the record is valid.
+*/
+bool parse_header(std::string_view record, HeaderRecord& header, std::string& error){
+    if(record.length() < 19 || !parse_hex_field(record, 7, 6, header.start) ||
+       !parse_hex_field(record, 13, 6, header.length)){
+        error = "malformed header record";
+        return false;
+    }
+    header.name = std::string(record.substr(1, 6));
+    return true;
+}
+
+
+/**
+* Parses a fixed-width hexadecimal field of a record.
+* @param record: The record containing the field.
+* @param pos: The position of the field's first hexadecimal.
+* @param digits: The width of the field.
+* @param value: Receives the value of the field.
+* @return True if every character of the field is a hexadecimal.
+*/
+bool parse_hex_field(std::string_view record, size_t pos, size_t digits, uint32_t& value){
+    if(pos + digits > record.length()){
+        return false;
+    }
+    value = 0;
+    for(size_t i = pos; i < pos + digits; i++){
+        uint8_t digit = g_hexTable.values[uint8_t(record[i])];
+        if(digit == INVALID_HEX){
+            return false;
+        }
+        value = (value << 4) | digit;
+    }
+    return true;
+}
+
+
+
+/**
+* Loads a cached image (see ObjectImageHeader) in place: the arrays point into the data, which
+* must stay as it is for as long as the image is used.
+* @param data: The contents of the cached image file.
+* @param sourceHash: hash_text() of the object file it should have been built from.
+* @param sourceSize: The size of that object file.
+* @param error: Receives a description of what is wrong with the file, if anything.
+* @return True if the file holds the image of that object file.
+*/
+bool ObjectImage::load(std::string_view data, uint64_t sourceHash, uint64_t sourceSize, std::string& error){
+    clear();
+    const ObjectImageHeader* h = reinterpret_cast<const ObjectImageHeader*>(data.data());
+    if(data.size() < sizeof(ObjectImageHeader) || std::memcmp(h->magic, "DSOB", 4) != 0 || h->version != 2){
+        error = "not an object image";
+        return false;
+    }
+    if(h->sourceHash != sourceHash || h->sourceSize != sourceSize){
+        error = "object image of another object file";
+        return false;
+    }
+    uint64_t size = sizeof(ObjectImageHeader) + uint64_t(h->textCount) * sizeof(TextRecord) +
+                    uint64_t(h->modCount) * sizeof(ModRecord) + h->length;
+    if(size > data.size() || reinterpret_cast<uintptr_t>(data.data()) % alignof(ObjectImageHeader) != 0){
+        error = "truncated object image";
+        return false;
+    }
+
+    const TextRecord* textRecords = reinterpret_cast<const TextRecord*>(h + 1);
+    const ModRecord* modRecords = reinterpret_cast<const ModRecord*>(textRecords + h->textCount);
+    for(uint32_t i = 0; i < h->textCount; i++){                     // Decoding trusts these to lie in the bytes.
+        if(textRecords[i].start < h->start || uint64_t(textRecords[i].start) + textRecords[i].length >
+                                              uint64_t(h->start) + h->length){
+            error = "corrupt object image";
+            return false;
+        }
+    }
+    header.name = std::string(h->name, 6);
+    header.start = h->start;
+    header.length = h->length;
+    end.firstInstr = h->firstInstr;
+    texts = ArrayView<TextRecord>{textRecords, h->textCount};
+    mods = ArrayView<ModRecord>{modRecords, h->modCount};
+    bytes = ArrayView<uint8_t>{reinterpret_cast<const uint8_t*>(modRecords + h->modCount), h->length};
+    hasHeader = true;
+    hasEnd = true;
+    m_mapped = true;
+    return true;
+}
+
+
+/**
+* Tells whether an object file holds more than one control section, and so has to be linked. Object
+* code is hexadecimal, so an 'H' can only be a header record or part of a name; the search runs at
+* memchr() speed and only checks the few it finds for starting a line.
+* @param text: The contents of the object file.
+* @return True if more than one line starts with 'H'.
+*/
+bool has_control_sections(std::string_view text){
+    const char* p = text.data();
+    const char* end = p + text.size();
+    int headers = 0;
+    while((p = static_cast<const char*>(std::memchr(p, 'H', end - p))) != nullptr){
+        if((p == text.data() || p[-1] == '\n') && ++headers > 1){
+            return true;
+        }
+        p++;
+    }
+    return false;
+}
+
+
+/**
+* Hashes a whole file, to tell whether a cached image was built from it. Four independent lanes
+* take 32 bytes per step, in the manner of xxHash64, so hashing runs well ahead of parsing.
+* @param text: The contents of the file.
+* @return The 64-bit hash.
+*/
+uint64_t hash_text(std::string_view text){
+    const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+    const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+    const uint64_t PRIME3 = 0x165667B19E3779F9ull;
+    auto rotl = [](uint64_t x, int bits){
+        return (x << bits) | (x >> (64 - bits));
+    };
+    uint64_t lanes[4] = {PRIME1 + PRIME2, PRIME2, 0, 0 - PRIME1};
+    const char* p = text.data();
+    size_t size = text.size();
+    size_t i = 0;
+    for(; i + 32 <= size; i += 32){
+        for(int lane = 0; lane < 4; lane++){
+            uint64_t word;
+            std::memcpy(&word, p + i + lane * 8, 8);
+            lanes[lane] = rotl(lanes[lane] + word * PRIME2, 31) * PRIME1;
+        }
+    }
+    uint64_t hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18) + size;
+    for(; i < size; i++){
+        hash = rotl(hash ^ (uint8_t(p[i]) * PRIME3), 11) * PRIME1;
+    }
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
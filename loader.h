@@ -0,0 +1,134 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "memstats.h"
+#include "view.h"
+
+struct HeaderRecord {
+    std::string name;       // Program name, exactly as the six characters appear in the record.
+    uint32_t start;         // Starting address of the program.
+    uint32_t length;        // Length of the program in bytes.
+};
+
+struct TextRecord {
+    uint32_t start;         // Address of the first object code byte.
+    uint32_t length;        // Number of object code bytes.
+};
+
+struct ModRecord {
+    uint32_t addr;          // Address of the field to be modified.
+    uint8_t halfBytes;      // Length of the field in hexadecimals.
+    char sign;              // '+' or '-' before the symbol; '\0' to relocate by the section's own address.
+    char symbol[6];         // External symbol added to or subtracted from the field, padded with spaces.
+};
+
+struct EndRecord {
+    uint32_t firstInstr;    // Address of the first executable instruction.
+};
+
+/**
+* Layout of a cached object image, in host byte order. The header is followed by textCount
+* TextRecord, modCount ModRecord and then length bytes of object code, so a mapped file is used
+* in place. The source fields identify the object file it was built from.
+*/
+struct ObjectImageHeader {
+    char magic[4];                  // "DSOB"
+    uint32_t version;
+    uint64_t sourceHash;            // hash_text() of the object file.
+    uint64_t sourceSize;
+    char name[8];                   // Program name from the header record, padded with NULs.
+    uint32_t start;
+    uint32_t length;
+    uint32_t textCount;
+    uint32_t modCount;
+    uint32_t firstInstr;            // From the end record.
+    uint32_t reserved;
+};
+
+/**
+* The object file after loading: every record as a typed struct and every text record's object
+* code hex-decoded into one contiguous byte image covering the whole program. The arrays are
+* views, of the image's own buffers or of a cached image file loaded in place.
+*/
+struct ObjectImage {
+    HeaderRecord header;
+    ArrayView<TextRecord> texts;
+    ArrayView<ModRecord> mods;
+    EndRecord end;
+    ArrayView<uint8_t> bytes;               // bytes[addr - header.start] is the byte at addr.
+    bool hasHeader = false;
+    bool hasEnd = false;
+
+    ObjectImage() = default;
+    ObjectImage(const ObjectImage&) = delete;               // The views point into the image itself.
+    ObjectImage& operator=(const ObjectImage&) = delete;
+    ObjectImage(ObjectImage&&) = default;                   // Moving keeps the buffers, so the views hold.
+    ObjectImage& operator=(ObjectImage&&) = default;
+
+    void clear(){                   // Empties the image but keeps its buffers for the next file.
+        header = HeaderRecord();
+        m_texts.clear();
+        m_mods.clear();
+        end = EndRecord();
+        m_bytes.clear();
+        hasHeader = false;
+        hasEnd = false;
+        m_mapped = false;
+        publish();
+    }
+
+    uint8_t* reset_bytes(uint32_t length){  // Zeroes length bytes of object code to fill in.
+        m_bytes.assign(length, 0);
+        bytes = ArrayView<uint8_t>{m_bytes.data(), m_bytes.size()};
+        return m_bytes.data();
+    }
+    uint8_t* fill_at(uint32_t addr){         // Where to decode the object code at addr; not for a loaded file.
+        return m_bytes.data() + (addr - header.start);
+    }
+    void add_text(const TextRecord& text){
+        m_texts.push_back(text);
+        texts = ArrayView<TextRecord>{m_texts.data(), m_texts.size()};
+    }
+    void add_mod(const ModRecord& mod){
+        m_mods.push_back(mod);
+        mods = ArrayView<ModRecord>{m_mods.data(), m_mods.size()};
+    }
+    bool load(std::string_view data, uint64_t sourceHash, uint64_t sourceSize, std::string& error);
+
+    const uint8_t* at(uint32_t addr) const {
+        return bytes.data() + (addr - header.start);
+    }
+
+    uint32_t end_addr() const {
+        return header.start + header.length;
+    }
+
+    bool is_mapped() const {                // Whether the arrays are those of a loaded file.
+        return m_mapped;
+    }
+
+private:
+    void publish(){
+        texts = ArrayView<TextRecord>{m_texts.data(), m_texts.size()};
+        mods = ArrayView<ModRecord>{m_mods.data(), m_mods.size()};
+        bytes = ArrayView<uint8_t>{m_bytes.data(), m_bytes.size()};
+    }
+
+    MemVector<TextRecord, MEM_IMAGE> m_texts;
+    MemVector<ModRecord, MEM_IMAGE> m_mods;
+    MemVector<uint8_t, MEM_IMAGE> m_bytes;
+    bool m_mapped = false;
+};
+
+bool parse_obj(std::string_view text, ObjectImage& image, std::string& error, int lineOffset = 0);
+bool parse_record(std::string_view record, ObjectImage& image, std::string& error);
+bool parse_header(std::string_view record, HeaderRecord& header, std::string& error);
+bool parse_hex_field(std::string_view record, size_t pos, size_t digits, uint32_t& value);
+uint64_t hash_text(std::string_view text);
+bool has_control_sections(std::string_view text);
+
+#endif
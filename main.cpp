@@ -1,30 +1,468 @@
-#include <cstring>
-#include "disassembler.h"
-#include "output.h"
-
-void check_files(int argc);
-
-int main(int argc, char** argv){
-    check_files(argc); 
-    disassemble(argv[1], argv[2]);
-   return 0;
-}
-
-
-/**
-* Checks if the user input the correct amount of command arguments. The program prematurely
-* terminates if the user fails to input the two required command line arguments.
-* @param argc: The amount of command arguments, including the name of the .exe file.
-*/ 
-void check_files(int argc){
-    if(argc == 3){
-        return;
-    } 
-    else{
-        std::cout << "ERROR: Too many or too few input files.";
-        std::cout << "Restart the program and enter the TWO (2) required input files." << std::endl;
-        std::cout << "The execution should be as follows: ./dissem test.obj test.sym" << std::endl;
-        std::cout << "Program Terminated.\n" << std::endl;
-        exit(0);
-    }
-}
+#include <cstring>
+#include "dissem.h"
+#include "batch.h"
+#include "watch.h"
+
+enum StatsMode {
+    STATS_OFF,
+    STATS_TABLE,        // --stats, --mem-stats
+    STATS_JSON          // --stats=json, --mem-stats=json
+};
+
+/**
+* The --range option: the addresses to disassemble, both included.
+*/
+struct AddressRange {
+    bool set = false;
+    uint32_t start = 0;
+    uint32_t end = 0;
+};
+
+void check_files(int argc);
+void usage();
+bool disassemble_files(const std::string& objFile, const std::string& symFile, const OutputOptions& output,
+                       int threads, const std::string& xrefPath, const std::string& cacheDir,
+                       const AddressRange& range, RunStats& stats);
+bool stream_files(const std::string& objFile, const std::string& symFile, const OutputOptions& output,
+                  RunStats& stats);
+bool link_files(const std::vector<std::string>& files, const OutputOptions& output, int threads,
+                const std::string& xrefPath, RunStats& stats);
+bool parse_args(int argc, char** argv, OutputOptions& output, std::vector<std::string>& files,
+                std::string& manifest, int& threads, bool& stream, bool& link, std::string& xrefPath,
+                std::string& cacheDir, AddressRange& range, std::string& watchDir, int& statsMode, int& memStatsMode);
+bool make_jobs(const std::vector<std::string>& files, const std::string& manifest, const OutputOptions& output,
+               std::vector<BatchJob>& jobs);
+bool index_symbols(const std::vector<std::string>& args);
+
+int main(int argc, char** argv){
+    if(argc > 1 && std::strcmp(argv[1], "query") == 0){
+        std::string error;
+        if(!run_query(std::vector<std::string>(argv + 2, argv + argc), std::cout, error)){
+            std::cerr << "ERROR: " << error << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "index-sym") == 0){
+        return index_symbols(std::vector<std::string>(argv + 2, argv + argc)) ? 0 : 1;
+    }
+
+    OutputOptions output;
+    std::vector<std::string> files;
+    std::string manifest;
+    int threads = 0;
+    bool stream = false;
+    bool link = false;
+    std::string xrefPath;
+    std::string cacheDir;
+    AddressRange range;
+    std::string watchDir;
+    int statsMode = STATS_OFF;
+    int memStatsMode = STATS_OFF;
+    if(!parse_args(argc, argv, output, files, manifest, threads, stream, link, xrefPath, cacheDir, range,
+                   watchDir, statsMode, memStatsMode)){
+        return 1;
+    }
+    RunStats stats;
+    bool ok;
+    if(!watchDir.empty()){
+        if(!files.empty() || !manifest.empty() || !output.path.empty() || stream || link || !xrefPath.empty() ||
+           !cacheDir.empty() || range.set){
+            std::cerr << "ERROR: --watch takes a directory and only -f, -j and --stats; each a.obj there is listed"
+                      << " in a.FORMAT." << std::endl;
+            return 1;
+        }
+        ok = run_watch(watchDir, output, threads, statsMode != STATS_OFF, statsMode == STATS_JSON);
+        statsMode = STATS_OFF;                                      // Printed for every update instead.
+    }
+    else if(link){
+        if(!manifest.empty() || stream || !cacheDir.empty() || range.set){
+            std::cerr << "ERROR: " << (!manifest.empty() ? "--batch" : stream ? "--stream" : range.set ? "--range"
+                      : "--cache") << " cannot be used with --link." << std::endl;
+            return 1;
+        }
+        if(files.empty() || files.size() % 2 != 0){
+            std::cerr << "ERROR: --link takes object and symbol file pairs: a.obj a.sym b.obj b.sym ..." << std::endl;
+            return 1;
+        }
+        ok = link_files(files, output, threads, xrefPath, stats);
+    }
+    else if(manifest.empty() && files.size() <= 2){
+        check_files(files.size() + 1);
+        if(stream && (!xrefPath.empty() || !cacheDir.empty() || range.set)){
+            std::cerr << "ERROR: " << (!xrefPath.empty() ? "--xref" : range.set ? "--range" : "--cache")
+                      << " cannot be used with --stream." << std::endl;
+            return 1;
+        }
+        ok = stream ? stream_files(files[0], files[1], output, stats)
+                    : disassemble_files(files[0], files[1], output, threads, xrefPath, cacheDir, range, stats);
+    }
+    else if(stream || !xrefPath.empty() || range.set){
+        std::cerr << "ERROR: " << (stream ? "--stream" : range.set ? "--range" : "--xref")
+                  << " takes one object file and its symbol file." << std::endl;
+        return 1;
+    }
+    else{
+        std::vector<BatchJob> jobs;
+        if(!make_jobs(files, manifest, output, jobs)){
+            return 1;
+        }
+        ok = run_batch(jobs, output, threads, &stats, cacheDir);
+    }
+    if(statsMode != STATS_OFF){                                     // On stderr, as the listing may be on stdout.
+        print_stats(std::cerr, stats, statsMode == STATS_JSON);
+    }
+    if(memStatsMode != STATS_OFF){
+        print_mem_stats(std::cerr, mem_snapshot(), stats.instructions(), memStatsMode == STATS_JSON);
+    }
+    return ok ? 0 : 1;
+}
+
+
+/**
+* Disassembles one object file through the library and writes its listing. The input files are
+* memory-mapped where possible, so the library reads them in place.
+* @param objFile: The object file, or "-" for stdin.
+* @param symFile: The symbol file, or "-" for stdin.
+* @param output: Where and in which format to write the listing.
+* @param threads: Threads decoding large programs; 0 uses one per hardware thread.
+* @param xrefPath: Where to write the cross-reference index, or empty for none.
+* @param cacheDir: Directory of cached object images, or empty for none.
+* @param range: The addresses to disassemble, if not the whole program.
+* @param stats: Receives the run's statistics.
+* @return True if the listing (and the index) was written.
+*/
+bool disassemble_files(const std::string& objFile, const std::string& symFile, const OutputOptions& output,
+                       int threads, const std::string& xrefPath, const std::string& cacheDir,
+                       const AddressRange& range, RunStats& stats){
+    InputFile obj;
+    InputFile sym;
+    std::string error;
+    if(!obj.open(objFile, error) || !sym.open(symFile, error) ||
+       (is_symbol_index(sym.text()) && !check_index_source(sym.text(), symFile, error))){
+        std::cerr << "ERROR: " << error << std::endl;
+        return false;
+    }
+    DisassemblyOptions options;
+    options.threads = threads;
+    options.lines = false;                                          // Written straight from the listing.
+    options.xref = !xrefPath.empty();
+    options.borrowInputs = true;                                    // obj and sym outlive the result.
+    options.cacheDir = cacheDir;
+    Disassembly result = range.set ? disassemble_range(obj.text(), sym.text(), range.start, range.end, options)
+                                   : disassemble(obj.text(), sym.text(), options);
+    bool ok = result.ok();
+    if(!ok){
+        std::cerr << "ERROR: " << objFile << ": " << result.error() << std::endl;
+    }
+    else if(!result.write(output, error) || (options.xref && !result.write_xref(xrefPath, error))){
+        std::cerr << "ERROR: " << error << std::endl;
+        ok = false;
+    }
+    else if(!result.warning().empty()){
+        std::cerr << "WARNING: " << objFile << ": " << result.warning() << "." << std::endl;
+    }
+    stats = result.stats();
+    return ok;
+}
+
+
+/**
+* Disassembles one object file as a pipeline, writing the start of the listing while the rest of
+* the object file is still being read.
+* @param objFile: The object file, or "-" for stdin.
+* @param symFile: The symbol file.
+* @param output: Where and in which format to write the listing.
+* @param stats: Receives the run's statistics.
+* @return True if the listing was written.
+*/
+bool stream_files(const std::string& objFile, const std::string& symFile, const OutputOptions& output,
+                  RunStats& stats){
+    Disassembler disassembler;
+    std::string error;
+    bool ok = disassembler.stream(objFile, symFile, output, error);
+    if(!ok){
+        std::cerr << "ERROR: " << error << std::endl;
+    }
+    else if(!disassembler.warning().empty()){
+        std::cerr << "WARNING: " << objFile << ": " << disassembler.warning() << "." << std::endl;
+    }
+    stats = disassembler.stats();
+    return ok;
+}
+
+
+/**
+* Links object files into one program through the library and writes its listing, with a CSECT
+* line where each control section after the first starts.
+* @param files: Object and symbol file pairs, in link order.
+* @param output: Where and in which format to write the listing.
+* @param threads: Threads loading control sections and decoding; 0 uses one per hardware thread.
+* @param xrefPath: Where to write the cross-reference index, or empty for none.
+* @param stats: Receives the run's statistics.
+* @return True if the listing (and the index) was written.
+*/
+bool link_files(const std::vector<std::string>& files, const OutputOptions& output, int threads,
+                const std::string& xrefPath, RunStats& stats){
+    std::vector<InputFile> inputs(files.size());
+    std::vector<std::string_view> objs;
+    std::vector<std::string_view> syms;
+    std::string error;
+    for(size_t i = 0; i < files.size(); i++){
+        if(!inputs[i].open(files[i], error)){
+            std::cerr << "ERROR: " << error << std::endl;
+            return false;
+        }
+        (i % 2 == 0 ? objs : syms).push_back(inputs[i].text());
+    }
+    DisassemblyOptions options;
+    options.threads = threads;
+    options.lines = false;                                          // Written straight from the listing.
+    options.xref = !xrefPath.empty();
+    Disassembly result = disassemble_linked(objs, syms, options);
+    bool ok = result.ok();
+    if(!ok){
+        std::cerr << "ERROR: " << result.error() << std::endl;
+    }
+    else if(!result.write(output, error) || (options.xref && !result.write_xref(xrefPath, error))){
+        std::cerr << "ERROR: " << error << std::endl;
+        ok = false;
+    }
+    else if(!result.warning().empty()){
+        std::cerr << "WARNING: " << result.warning() << "." << std::endl;
+    }
+    stats = result.stats();
+    return ok;
+}
+
+
+/**
+* Reads the options and collects the remaining arguments as input files.
+* @param argc: The amount of command arguments, including the name of the .exe file.
+* @param argv: The command arguments.
+* @param output: Receives the -o and -f options.
+* @param files: Receives the input files in the order given.
+* @param manifest: Receives the --batch manifest, if any.
+* @param threads: Receives the -j option: threads decoding a large program, or working through a batch.
+* @param stream: Receives the --stream option.
+* @param link: Receives the --link option.
+* @param xrefPath: Receives the --xref file, if any.
+* @param cacheDir: Receives the --cache directory, if any.
+* @param range: Receives the --range addresses, if any.
+* @param watchDir: Receives the --watch directory, if any.
+* @param statsMode: Receives the StatsMode chosen by --stats.
+* @param memStatsMode: Receives the StatsMode chosen by --mem-stats.
+* @return False if an option is malformed.
+*/
+bool parse_args(int argc, char** argv, OutputOptions& output, std::vector<std::string>& files,
+                std::string& manifest, int& threads, bool& stream, bool& link, std::string& xrefPath,
+                std::string& cacheDir, AddressRange& range, std::string& watchDir, int& statsMode, int& memStatsMode){
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        std::string option = arg.substr(0, arg.find('='));
+        if(option == "--stats" || option == "--mem-stats"){
+            std::string mode = arg.size() > option.size() ? arg.substr(option.size() + 1) : "table";
+            if(mode != "table" && mode != "json"){
+                std::cerr << "ERROR: " << option << " is either table or json." << std::endl;
+                return false;
+            }
+            if(!DISSEM_STATS){
+                std::cerr << "ERROR: This dissem was built without statistics; rebuild it with make STATS=1." << std::endl;
+                return false;
+            }
+            (option == "--stats" ? statsMode : memStatsMode) = mode == "json" ? STATS_JSON : STATS_TABLE;
+        }
+        else if(arg == "--stream"){
+            stream = true;
+        }
+        else if(arg == "--link"){
+            link = true;
+        }
+        else if(arg == "-o" || arg == "-f" || arg == "-j" || arg == "--batch" || arg == "--xref" ||
+                arg == "--cache" || arg == "--range" || arg == "--watch"){
+            if(i + 1 == argc){
+                std::cerr << "ERROR: " << arg << " needs a value." << std::endl;
+                usage();
+                return false;
+            }
+            std::string value = argv[++i];
+            if(arg == "-o"){
+                output.path = value;
+            }
+            else if(arg == "--batch"){
+                manifest = value;
+            }
+            else if(arg == "--xref"){
+                xrefPath = value;
+            }
+            else if(arg == "--cache"){
+                cacheDir = value;
+            }
+            else if(arg == "--watch"){
+                watchDir = value;
+            }
+            else if(arg == "--range"){
+                char* end;
+                range.start = std::strtoul(value.c_str(), &end, 16);
+                bool valid = end != value.c_str() && *end == '-';
+                const char* last = end + valid;
+                range.end = std::strtoul(last, &end, 16);
+                if(!valid || end == last || *end != '\0' || range.start > range.end){
+                    std::cerr << "ERROR: --range needs two hexadecimal addresses, START-END." << std::endl;
+                    return false;
+                }
+                range.set = true;
+            }
+            else if(arg == "-j"){
+                char* end;
+                threads = std::strtol(value.c_str(), &end, 10);
+                if(*end != '\0' || threads < 1){
+                    std::cerr << "ERROR: -j needs a positive number of threads." << std::endl;
+                    return false;
+                }
+            }
+            else if(!parse_output_format(value, output.format)){
+                std::cerr << "ERROR: Unknown output format " << value << "." << std::endl;
+                usage();
+                return false;
+            }
+        }
+        else{
+            files.push_back(arg);
+        }
+    }
+    return true;
+}
+
+
+/**
+* Builds the batch from the manifest and from object and symbol file pairs on the command line.
+* @param files: The input files from the command line, in pairs.
+* @param manifest: The --batch manifest, or empty if there is none.
+* @param output: The output options; a batch writes one file per pair, so -o is refused.
+* @param jobs: Receives the jobs.
+* @return False if the batch cannot be built.
+*/
+bool make_jobs(const std::vector<std::string>& files, const std::string& manifest, const OutputOptions& output,
+               std::vector<BatchJob>& jobs){
+    if(!output.path.empty()){
+        std::cerr << "ERROR: -o cannot be used in batch mode; name output files in the manifest instead." << std::endl;
+        return false;
+    }
+    if(files.size() % 2 != 0){
+        std::cerr << "ERROR: Every object file needs a symbol file." << std::endl;
+        usage();
+        return false;
+    }
+    std::string error;
+    if(!manifest.empty() && !read_manifest(manifest, jobs, error)){
+        std::cerr << "ERROR: " << error << std::endl;
+        return false;
+    }
+    for(size_t i = 0; i < files.size(); i += 2){
+        jobs.push_back(BatchJob{files[i], files[i + 1], std::string()});
+    }
+    return true;
+}
+
+
+/**
+* Parses a symbol file once and writes it as a precompiled symbol index, which later runs take
+* in place of the symbol file: ./dissem index-sym [-o OUTPUT] test.sym
+* @param args: The arguments after "index-sym".
+* @return True if the index was written.
+*/
+bool index_symbols(const std::vector<std::string>& args){
+    std::string symFile;
+    std::string path;
+    for(size_t i = 0; i < args.size(); i++){
+        if(args[i] == "-o" && i + 1 < args.size()){
+            path = args[++i];
+        }
+        else if(symFile.empty()){
+            symFile = args[i];
+        }
+        else{
+            symFile.clear();
+            break;
+        }
+    }
+    if(symFile.empty()){
+        std::cerr << "ERROR: index-sym takes one symbol file: ./dissem index-sym [-o OUTPUT] test.sym" << std::endl;
+        return false;
+    }
+    if(path.empty()){                                               // test.sym becomes test.symidx.
+        bool sym = symFile.size() > 4 && symFile.compare(symFile.size() - 4, 4, ".sym") == 0;
+        path = symFile + (sym ? "idx" : ".symidx");
+    }
+
+    InputFile input;
+    std::string error;
+    if(!input.open(symFile, error)){
+        std::cerr << "ERROR: " << error << std::endl;
+        return false;
+    }
+    if(is_symbol_index(input.text())){
+        std::cerr << "ERROR: " << symFile << " is already a symbol index." << std::endl;
+        return false;
+    }
+    SymbolIndex symbols;
+    parse_symbols(input.text(), symbols);
+    if(!write_symbol_index(symbols, hash_text(input.text()), input.text().size(), path, error)){
+        std::cerr << "ERROR: " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+/**
+* Checks if the user input the correct amount of command arguments. The program prematurely
+* terminates if the user fails to input the two required command line arguments.
+* @param argc: The amount of input files, plus one for the name of the .exe file.
+*/
+void check_files(int argc){
+    if(argc == 3){
+        return;
+    }
+    else{
+        std::cout << "ERROR: Too many or too few input files.";
+        std::cout << "Restart the program and enter the TWO (2) required input files." << std::endl;
+        usage();
+        std::cout << "Program Terminated.\n" << std::endl;
+        exit(0);
+    }
+}
+
+
+/**
+* Prints how the program is run.
+*/
+void usage(){
+    std::cout << "The execution should be as follows: ./dissem [-o OUTPUT] [-f FORMAT] test.obj test.sym" << std::endl;
+    std::cout << "Either file may be - to read it from standard input." << std::endl;
+    std::cout << "FORMAT is lst (default), jsonl, csv or bin; the listing goes to out.FORMAT" << std::endl;
+    std::cout << "unless OUTPUT names another file, or - for standard output. -j THREADS limits the threads" << std::endl;
+    std::cout << "used to decode large programs (default: one per core). --stream reads, decodes and writes" << std::endl;
+    std::cout << "concurrently, so the listing starts before the object file has been read (not for bin)." << std::endl;
+    std::cout << "Batch mode: ./dissem [-j THREADS] [-f FORMAT] [--batch MANIFEST] a.obj a.sym b.obj b.sym ..." << std::endl;
+    std::cout << "Each MANIFEST line is: OBJECT SYMBOLS [OUTPUT]. Each listing is written next to its" << std::endl;
+    std::cout << "object file (a.obj to a.FORMAT) unless the manifest names the output file." << std::endl;
+    std::cout << "./dissem index-sym [-o OUTPUT] test.sym parses the symbol file once into test.symidx, which any" << std::endl;
+    std::cout << "later run takes in place of test.sym and maps instead of parsing." << std::endl;
+    std::cout << "--xref FILE also writes a cross-reference index, which ./dissem query FILE xref TARGET," << std::endl;
+    std::cout << "./dissem query FILE callers TARGET and ./dissem query FILE line ADDRESS answer; TARGET is" << std::endl;
+    std::cout << "a symbol or a hexadecimal address." << std::endl;
+    std::cout << "--range START-END lists only the lines from address START to END (hexadecimal, both" << std::endl;
+    std::cout << "included), decoding just the text records around them." << std::endl;
+    std::cout << "--cache DIR keeps the loaded image of each object file in DIR, keyed by a hash of its" << std::endl;
+    std::cout << "contents, so disassembling the same object file again skips parsing it (not with --stream)." << std::endl;
+    std::cout << "./dissem --watch DIR [-f FORMAT] lists each a.obj in DIR that has an a.sym in a.FORMAT, and then" << std::endl;
+    std::cout << "keeps the listings up to date as the files change, decoding and rewriting only what changed." << std::endl;
+    std::cout << "./dissem --link [-o OUTPUT] [-f FORMAT] a.obj a.sym b.obj b.sym ... links the object files, in" << std::endl;
+    std::cout << "that order, into one program listed with a CSECT line where each control section starts; an" << std::endl;
+    std::cout << "object file of several control sections is linked so even alone (not with --stream)." << std::endl;
+    std::cout << "--stats prints the time spent in each phase and what was decoded on standard error;" << std::endl;
+    std::cout << "--stats=json prints them as one JSON object. --mem-stats[=json] likewise prints the" << std::endl;
+    std::cout << "peak heap use of each part of the disassembler and the allocations per instruction." << std::endl;
+}
@@ -0,0 +1,140 @@
+#include <atomic>
+#include <iomanip>
+#include <sys/resource.h>
+#include "memstats.h"
+
+static const char* const g_memNames[MEM_COUNT] = {
+    "input", "image", "symbols", "gaps", "listing", "output", "xref", "range", "flow"
+};
+
+/**
+* Live counts behind a MemUsage. Allocators on any thread update them, so they are atomic.
+*/
+struct MemCounter {
+    std::atomic<int64_t> bytes{0};
+    std::atomic<int64_t> peak{0};
+    std::atomic<uint64_t> allocations{0};
+};
+
+static MemCounter g_memCounters[MEM_COUNT];
+static MemCounter g_memTotal;
+
+
+/**
+* @param peak: A high-water mark.
+* @param bytes: The bytes allocated now, raising the mark if above it.
+*/
+static void raise_peak(std::atomic<int64_t>& peak, int64_t bytes){
+    int64_t seen = peak.load(std::memory_order_relaxed);
+    while(bytes > seen && !peak.compare_exchange_weak(seen, bytes, std::memory_order_relaxed)){
+    }
+}
+
+
+/**
+* Counts an allocation.
+* @param subsystem: The MemSubsystem allocating.
+* @param bytes: The size of the allocation.
+*/
+void mem_count_alloc(int subsystem, size_t bytes){
+    MemCounter& counter = g_memCounters[subsystem];
+    counter.allocations.fetch_add(1, std::memory_order_relaxed);
+    g_memTotal.allocations.fetch_add(1, std::memory_order_relaxed);
+    raise_peak(counter.peak, counter.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    raise_peak(g_memTotal.peak, g_memTotal.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+
+/**
+* Counts a deallocation.
+* @param subsystem: The MemSubsystem that made the allocation.
+* @param bytes: The size of the allocation.
+*/
+void mem_count_free(int subsystem, size_t bytes){
+    g_memCounters[subsystem].bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    g_memTotal.bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+
+static void reset_counter(MemCounter& counter){
+    counter.peak.store(counter.bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    counter.allocations.store(0, std::memory_order_relaxed);
+}
+
+
+static MemUsage load_usage(const MemCounter& counter){
+    MemUsage usage;
+    usage.bytes = counter.bytes.load(std::memory_order_relaxed);
+    usage.peak = counter.peak.load(std::memory_order_relaxed);
+    usage.allocations = counter.allocations.load(std::memory_order_relaxed);
+    return usage;
+}
+
+
+/**
+* @return The heap use of every subsystem so far, and the peak resident set size of the process.
+*/
+MemStats mem_snapshot(){
+    MemStats stats;
+    for(int i = 0; i < MEM_COUNT; i++){
+        stats.subsystems[i] = load_usage(g_memCounters[i]);
+    }
+    stats.total = load_usage(g_memTotal);
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0){
+        stats.peakRss = int64_t(usage.ru_maxrss) * 1024;                // Reported in KiB on Linux.
+    }
+    return stats;
+}
+
+
+/**
+* Starts a new measurement: the high-water marks drop to what is allocated now and the
+* allocation counts go back to zero. The peak RSS cannot be reset.
+*/
+void mem_reset_peaks(){
+    for(MemCounter& counter : g_memCounters){
+        reset_counter(counter);
+    }
+    reset_counter(g_memTotal);
+}
+
+
+/**
+* Prints the high-water mark and allocations of each subsystem, the peak of them all, the peak
+* RSS and the allocations per instruction, as a table or as one JSON object.
+* @param out: Where to print them.
+* @param stats: The heap use to print.
+* @param instructions: The instructions decoded meanwhile.
+* @param json: True for {"subsystems": {...}, "peak_heap": ...}.
+*/
+void print_mem_stats(std::ostream& out, const MemStats& stats, uint64_t instructions, bool json){
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    double perInstr = instructions ? double(stats.total.allocations) / instructions : 0;
+    out << std::fixed << std::setprecision(4);
+    if(json){
+        out << "{\"subsystems\": {";
+        for(int i = 0; i < MEM_COUNT; i++){
+            out << (i ? ", \"" : "\"") << g_memNames[i] << "\": {\"peak_bytes\": " << stats.subsystems[i].peak
+                << ", \"allocations\": " << stats.subsystems[i].allocations << "}";
+        }
+        out << "}, \"peak_heap\": " << stats.total.peak << ", \"allocations\": " << stats.total.allocations
+            << ", \"peak_rss\": " << stats.peakRss << ", \"allocations_per_instruction\": " << perInstr
+            << "}" << std::endl;
+    }
+    else{
+        out << std::left << std::setw(18) << "subsystem" << std::right << std::setw(14) << "peak bytes"
+            << std::setw(14) << "allocations" << '\n';
+        for(int i = 0; i < MEM_COUNT; i++){
+            out << std::left << std::setw(18) << g_memNames[i] << std::right << std::setw(14)
+                << stats.subsystems[i].peak << std::setw(14) << stats.subsystems[i].allocations << '\n';
+        }
+        out << std::left << std::setw(18) << "peak heap" << std::right << std::setw(14) << stats.total.peak
+            << std::setw(14) << stats.total.allocations << '\n';
+        out << std::left << std::setw(18) << "peak rss" << std::right << std::setw(14) << stats.peakRss << '\n';
+        out << std::left << std::setw(18) << "allocs/instr" << std::right << std::setw(14) << perInstr << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,102 @@
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "stats.h"
+
+/**
+* The structures whose heap use --mem-stats reports. Every container of a subsystem allocates
+* through its counting allocator, so each one's bytes, high-water mark and allocations are known.
+*/
+enum MemSubsystem : uint8_t {
+    MEM_INPUT,              // Inputs read into memory because they could not be mapped.
+    MEM_IMAGE,              // The loaded object image: records and object code bytes.
+    MEM_SYMBOLS,            // The symbol index, including the tables build() sorts.
+    MEM_GAPS,               // The planned reserved regions.
+    MEM_LISTING,            // The listing, and the chunks of it decoded on other threads.
+    MEM_OUTPUT,             // The output buffer, and the listings --watch keeps rendered.
+    MEM_XREF,               // The cross-reference index.
+    MEM_RANGE,              // The record checkpoints of range decoding.
+    MEM_FLOW,               // The basic blocks and states of the register flow analysis.
+    MEM_COUNT
+};
+
+/**
+* Heap use of one subsystem, or of all of them.
+*/
+struct MemUsage {
+    int64_t bytes = 0;                  // Allocated now.
+    int64_t peak = 0;                   // High-water mark.
+    uint64_t allocations = 0;
+};
+
+struct MemStats {
+    MemUsage subsystems[MEM_COUNT];
+    MemUsage total;                     // The peak of the sum, not the sum of the peaks.
+    int64_t peakRss = 0;                // Of the whole process, mapped inputs included.
+};
+
+void mem_count_alloc(int subsystem, size_t bytes);
+void mem_count_free(int subsystem, size_t bytes);
+MemStats mem_snapshot();
+void mem_reset_peaks();
+void print_mem_stats(std::ostream& out, const MemStats& stats, uint64_t instructions, bool json);
+
+/**
+* std::allocator that counts what it hands out against a subsystem.
+*/
+template<class T, int S>
+class CountingAllocator {
+public:
+    typedef T value_type;
+
+    template<class U>
+    struct rebind {
+        typedef CountingAllocator<U, S> other;
+    };
+
+    CountingAllocator() = default;
+    template<class U>
+    CountingAllocator(const CountingAllocator<U, S>&){}
+
+    T* allocate(size_t n){
+        T* p = std::allocator<T>().allocate(n);
+        mem_count_alloc(S, n * sizeof(T));
+        return p;
+    }
+
+    void deallocate(T* p, size_t n){
+        mem_count_free(S, n * sizeof(T));
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<class U>
+    bool operator==(const CountingAllocator<U, S>&) const {
+        return true;
+    }
+    template<class U>
+    bool operator!=(const CountingAllocator<U, S>&) const {
+        return false;
+    }
+};
+
+#if DISSEM_STATS
+template<class T, int S>
+using MemAllocator = CountingAllocator<T, S>;
+#else
+template<class T, int S>
+using MemAllocator = std::allocator<T>;
+#endif
+
+template<class T, int S>
+using MemVector = std::vector<T, MemAllocator<T, S>>;
+
+template<int S>
+using MemString = std::basic_string<char, std::char_traits<char>, MemAllocator<char, S>>;
+
+#endif
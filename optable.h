@@ -0,0 +1,204 @@
+#ifndef OPTABLE_H
+#define OPTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+enum FormatClass : uint8_t {
+    FORMAT_INVALID,
+    FORMAT_1,
+    FORMAT_2,
+    FORMAT_34
+};
+
+enum OperandKind : uint8_t {
+    OPERAND_NONE,       // No operand (Format 1, RSUB).
+    OPERAND_R1,         // A single register (CLEAR, TIXR).
+    OPERAND_R1R2,       // Two registers (ADDR, COMPR, RMO...).
+    OPERAND_R1N,        // A register and a shift count (SHIFTL, SHIFTR).
+    OPERAND_N,          // A number (SVC).
+    OPERAND_MEMORY,     // A target address or constant (Format 3/4).
+    OPERAND_BYTE        // A byte that does not start any known instruction.
+};
+
+enum Mnemonic : uint8_t {
+#define INSTRUCTION(mnemonic, opcode, format, operand) MN_##mnemonic,
+#include "instructions.def"
+#undef INSTRUCTION
+    MN_COUNT,
+    MN_INVALID = MN_COUNT
+};
+
+enum FlagBits : uint8_t {   // The nixbpe bits of a Format 3/4 instruction.
+    FLAG_E = 0x01,
+    FLAG_P = 0x02,
+    FLAG_B = 0x04,
+    FLAG_X = 0x08,
+    FLAG_I = 0x10,
+    FLAG_N = 0x20,
+    FLAG_UNRESOLVED = 0x40  // Not an instruction bit: a listing line whose B or X could not be known.
+};
+
+enum TargetMode : uint8_t { // Indexed by the b and p bits.
+    TA_DIRECT,
+    TA_PC_RELATIVE,
+    TA_BASE_RELATIVE,
+    TA_UNDEFINED
+};
+
+enum OperandMode : uint8_t {
+    OP_SIMPLE,
+    OP_IMMEDIATE,
+    OP_INDIRECT
+};
+
+struct OpEntry {
+    uint8_t mnemonic;
+    uint8_t format;
+    uint8_t operand;
+};
+
+struct OpTable {
+    OpEntry entries[256];
+};
+
+/**
+* Builds the 256-entry opcode table from instructions.def. Format 3/4 opcodes occupy four
+* consecutive entries since the n and i bits share the opcode byte; every other entry decodes
+* as a single undefined byte.
+* @return The opcode table, indexed by the first byte of an instruction.
+*/
+constexpr OpTable build_op_table(){
+    OpTable table{};
+    for(OpEntry& entry : table.entries){
+        entry = {MN_INVALID, FORMAT_1, OPERAND_BYTE};
+    }
+    const struct {
+        uint8_t opcode;
+        OpEntry entry;
+    } spec[] = {
+#define INSTRUCTION(mnemonic, opcode, format, operand) {opcode, {MN_##mnemonic, format, operand}},
+#include "instructions.def"
+#undef INSTRUCTION
+    };
+    for(const auto& instr : spec){
+        int variants = instr.entry.format == FORMAT_34 ? 4 : 1;
+        for(int ni = 0; ni < variants; ni++){
+            table.entries[instr.opcode | ni] = instr.entry;
+        }
+    }
+    return table;
+}
+
+inline constexpr OpTable g_opTable = build_op_table();
+
+inline constexpr const char* g_mnemonicNames[MN_COUNT + 1] = {
+#define INSTRUCTION(mnemonic, opcode, format, operand) #mnemonic,
+#include "instructions.def"
+#undef INSTRUCTION
+    "BYTE"
+};
+
+inline constexpr uint8_t g_operandKinds[MN_COUNT + 1] = {
+#define INSTRUCTION(mnemonic, opcode, format, operand) operand,
+#include "instructions.def"
+#undef INSTRUCTION
+    OPERAND_BYTE
+};
+
+inline constexpr uint8_t g_operandModes[4] = {OP_SIMPLE, OP_IMMEDIATE, OP_INDIRECT, OP_SIMPLE}; // Indexed by n and i.
+
+struct Instruction {
+    uint8_t mnemonic;   // Mnemonic id, MN_INVALID for undefined bytes.
+    uint8_t format;     // 1, 2, 3 or 4, which is also the length in bytes.
+    uint8_t operand;    // OperandKind.
+    uint8_t flags;      // nixbpe bits (Format 3/4 only).
+    uint8_t r1;         // Registers of a Format 2 instruction.
+    uint8_t r2;
+    uint32_t field;     // Unsigned disp (Format 3) or address (Format 4), or the undefined byte.
+};
+
+
+/**
+* Decodes the instruction starting at the given object code bytes with a single table load on
+* the opcode byte. The remaining fields come straight from the nixbpe bits.
+* @param bytes: The object code. Only the first `avail` bytes are read.
+* @param avail: The number of object code bytes left in the text record.
+* @param instr: Receives the decoded instruction.
+* @return The length of the instruction in bytes, or 0 if it runs past the end of the record.
+*/
+inline int decode_instruction(const uint8_t* bytes, size_t avail, Instruction& instr){
+    const OpEntry& entry = g_opTable.entries[bytes[0]];
+    instr.mnemonic = entry.mnemonic;
+    instr.operand = entry.operand;
+    instr.flags = 0;
+    instr.r1 = 0;
+    instr.r2 = 0;
+    instr.field = 0;
+
+    if(entry.format == FORMAT_1){
+        instr.format = 1;
+        instr.field = bytes[0];
+    }
+    else if(entry.format == FORMAT_2){
+        if(avail < 2){
+            return 0;
+        }
+        instr.format = 2;
+        instr.r1 = bytes[1] >> 4;
+        instr.r2 = bytes[1] & 0x0F;
+    }
+    else{
+        if(avail < 3){
+            return 0;
+        }
+        instr.flags = uint8_t(((bytes[0] & 0x03) << 4) | (bytes[1] >> 4));
+        if(instr.flags & FLAG_E){
+            if(avail < 4){
+                return 0;
+            }
+            instr.format = 4;
+            instr.field = (uint32_t(bytes[1] & 0x0F) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3];
+        }
+        else{
+            instr.format = 3;
+            instr.field = (uint32_t(bytes[1] & 0x0F) << 8) | bytes[2];
+        }
+    }
+    return instr.format;
+}
+
+
+/**
+* @return The addressing mode used to calculate the Target Address.
+*/
+inline TargetMode target_mode(uint8_t flags){
+    return TargetMode((flags >> 1) & 0x03);
+}
+
+
+/**
+* @return The addressing mode for the Operand Value.
+*/
+inline OperandMode operand_mode(uint8_t flags){
+    return OperandMode(g_operandModes[(flags >> 4) & 0x03]);
+}
+
+
+/**
+* Flag bits b, p and e all being zero means the disp field holds a constant rather than an address.
+* @return True if the operand of the Format 3 instruction is a constant.
+*/
+inline bool has_constant_operand(uint8_t flags){
+    return (flags & (FLAG_B | FLAG_P | FLAG_E)) == 0;
+}
+
+
+/**
+* @return True if the Target Address depends on the B or X register (base-relative or indexed).
+*/
+inline bool uses_registers(uint8_t flags){
+    return target_mode(flags) == TA_BASE_RELATIVE || (flags & FLAG_X);
+}
+
+#endif
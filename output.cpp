@@ -1,29 +1,940 @@
-#include "output.h"
-#include "disassembler.h"
-
-void create_output(std::vector<int> programCounter, std::vector<std::string> labels, std::vector<std::string> opCodes, std::vector<std::string> operands, std::vector<std::string> objectCodes){
-    std::ofstream outfile("out.lst");
-    int addrLength = 4;
-    for(int i = 0; i < programCounter.size(); i++){
-        if(programCounter[i] > 65535){
-           addrLength = 5; 
-        }
-
-        if(programCounter[i] == 32){ // Character representation of 32 is a blank space. This is used
-                                     // for instructions that don't represent a program counter address (LTORG, BASE).
-            outfile << std::setw(addrLength) << char(programCounter[i]);
-            outfile << std::right << std::setw(10) << labels[i];
-            outfile << std::right << std::setw(15) << opCodes[i];
-            outfile << std::right << std::setw(15) << operands[i];
-            outfile << std::right << std::setw(12) << objectCodes[i] << std::endl;
-        }
-        else{
-            outfile << std::setw(addrLength) << std::setfill('0') << std::hex << std::uppercase << programCounter[i];
-            outfile << std::right << std::setw(10) << std::setfill(' ') << labels[i];
-            outfile << std::right << std::setw(15) << std::setfill(' ') << opCodes[i];
-            outfile << std::right << std::setw(15) << std::setfill(' ') << operands[i];
-            outfile << std::right << std::setw(12) << std::setfill(' ') << objectCodes[i] << std::endl;
-        }
-    }
-    outfile.close();
-}
\ No newline at end of file
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "output.h"
+#include "disassembler.h"
+
+const static std::string_view g_registers[10] = {"A", "X", "L", "B", "S", "T", "F", "", "PC", "SW"};
+const static std::string_view g_lineKinds[] = {"start", "instruction", "base", "ltorg", "literal", "resw", "end", "resb",
+                                               "csect"};
+const static char g_hexDigits[] = "0123456789ABCDEF";
+
+/**
+* Two hexadecimals for every byte value, so object code is converted one table load per byte.
+*/
+static const struct HexPairs {
+    char pairs[256][2];
+    HexPairs(){
+        for(int b = 0; b < 256; b++){
+            pairs[b][0] = g_hexDigits[b >> 4];
+            pairs[b][1] = g_hexDigits[b & 0x0F];
+        }
+    }
+} g_hexPairs;
+
+static const char g_spaces[64] = {
+    ' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',
+    ' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' '
+};
+
+
+/**
+* Appends an address in hexadecimals.
+* @param addr: The address.
+* @param minDigits: Leading zeros pad it to this many digits.
+* @param text: The digits are appended to this string.
+*/
+static void append_address(uint32_t addr, int minDigits, std::string& text){
+    char digits[8];
+    auto result = std::to_chars(digits, digits + sizeof(digits), addr, 16);
+    text.append(std::max(0, minDigits - int(result.ptr - digits)), '0');
+    for(char* c = digits; c != result.ptr; c++){
+        text.push_back(*c >= 'a' ? *c - 'a' + 'A' : *c);
+    }
+}
+
+
+/**
+* @param kind: A LineKind.
+* @return False for the directives (LTORG, BASE, END), which don't represent an address.
+*/
+static bool has_address(uint8_t kind){
+    return kind != LINE_BASE && kind != LINE_LTORG && kind != LINE_END;
+}
+
+
+/**
+* The fixed-width assembly listing: address, label, mnemonic, operand and object code columns.
+*/
+class LstFormatter : public ListingFormatter {
+public:
+    using ListingFormatter::ListingFormatter;
+
+    void resume(const RenderPlan& plan, size_t line) override {
+        m_addrLength = plan.wideLine < line ? 5 : 4;
+    }
+
+    void line(const ListingLine& line, OutputBuffer& out) override {
+        const LineFields& f = fields(line);
+        if(f.hasAddress && f.address > 65535){
+            m_addrLength = 5;
+        }
+        if(f.hasAddress){
+            out.append_hex(f.address, m_addrLength);
+        }
+        else{
+            out.pad(' ', m_addrLength);
+        }
+        out.append_right(f.label, 10);
+        size_t opLength = f.opCode.size() + f.extended;
+        if(opLength < 15){
+            out.pad(' ', 15 - opLength);
+        }
+        if(f.extended){
+            out.put('+');
+        }
+        out.append(f.opCode);
+        out.append_right(f.operand, 15);
+        if(f.objLength * 2 < 12){
+            out.pad(' ', 12 - f.objLength * 2);
+        }
+        out.append_hex_bytes(f.objCode, f.objLength);
+        out.put('\n');
+    }
+
+private:
+    int m_addrLength = 4;           // Widens to 5 once an address no longer fits in four hexadecimals.
+};
+
+
+/**
+* JSON Lines: one object per listing line with the same fields as the listing columns.
+*/
+class JsonlFormatter : public ListingFormatter {
+public:
+    using ListingFormatter::ListingFormatter;
+
+    void line(const ListingLine& line, OutputBuffer& out) override {
+        const LineFields& f = fields(line);
+        out.append("{\"kind\":\"");
+        out.append(g_lineKinds[line.kind]);
+        out.append("\",\"address\":");
+        if(f.hasAddress){
+            out.put('"');
+            out.append_hex(f.address, 4);
+            out.put('"');
+        }
+        else{
+            out.append("null");
+        }
+        out.append(",\"label\":");
+        append_string(f.label, false, out);
+        out.append(",\"mnemonic\":");
+        append_string(f.opCode, f.extended, out);
+        out.append(",\"operand\":");
+        append_string(f.operand, false, out);
+        out.append(",\"objcode\":\"");
+        out.append_hex_bytes(f.objCode, f.objLength);
+        out.append("\"}\n");
+    }
+
+private:
+    static void append_string(std::string_view text, bool extended, OutputBuffer& out){
+        out.put('"');
+        if(extended){
+            out.put('+');
+        }
+        for(char c : text){
+            if(c == '"' || c == '\\'){
+                out.put('\\');
+                out.put(c);
+            }
+            else if(uint8_t(c) < 0x20){
+                out.append("\\u00");
+                out.put(g_hexDigits[uint8_t(c) >> 4]);
+                out.put(g_hexDigits[c & 0x0F]);
+            }
+            else{
+                out.put(c);
+            }
+        }
+        out.put('"');
+    }
+};
+
+
+/**
+* Comma-separated values with a header row. Fields containing commas or quotes are quoted.
+*/
+class CsvFormatter : public ListingFormatter {
+public:
+    using ListingFormatter::ListingFormatter;
+
+    void begin(const Listing&, OutputBuffer& out) override {
+        out.append("address,kind,label,mnemonic,operand,objcode\n");
+    }
+
+    void line(const ListingLine& line, OutputBuffer& out) override {
+        const LineFields& f = fields(line);
+        if(f.hasAddress){
+            out.append_hex(f.address, 4);
+        }
+        out.put(',');
+        out.append(g_lineKinds[line.kind]);
+        out.put(',');
+        append_field(f.label, false, out);
+        out.put(',');
+        append_field(f.opCode, f.extended, out);
+        out.put(',');
+        append_field(f.operand, false, out);
+        out.put(',');
+        out.append_hex_bytes(f.objCode, f.objLength);
+        out.put('\n');
+    }
+
+private:
+    static void append_field(std::string_view text, bool extended, OutputBuffer& out){
+        if(text.find_first_of(",\"\n") == std::string_view::npos){
+            if(extended){
+                out.put('+');
+            }
+            out.append(text);
+            return;
+        }
+        out.put('"');
+        for(char c : text){
+            if(c == '"'){
+                out.put('"');
+            }
+            out.put(c);
+        }
+        out.put('"');
+    }
+};
+
+
+/**
+* Packed binary listing (see BinaryHeader). The listing lines are written as they are held in
+* memory, so readers can map the file and use the records directly.
+*/
+class BinaryFormatter : public ListingFormatter {
+public:
+    using ListingFormatter::ListingFormatter;
+
+    void begin(const Listing& listing, OutputBuffer& out) override {
+        const SymbolIndex& symbols = *m_ctx.symbols;
+        const ObjectImage& image = *m_ctx.image;
+        BinaryHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "DSLB", 4);
+        header.version = 1;
+        header.lineCount = listing.size();
+        header.symbolCount = symbols.size();
+        header.nameBytes = symbols.arena().size();
+        header.imageStart = image.header.start;
+        header.imageLength = image.bytes.size();
+        std::memcpy(header.program, image.header.name.data(), std::min<size_t>(image.header.name.size(), 8));
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    void line(const ListingLine& line, OutputBuffer& out) override {
+        out.append(reinterpret_cast<const char*>(&line), sizeof(line));
+    }
+
+    void end(const Listing&, OutputBuffer& out) override {
+        const SymbolIndex& symbols = *m_ctx.symbols;
+        ArrayView<uint32_t> offsets = symbols.name_offsets();
+        out.append(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint32_t));
+        out.append(symbols.arena());
+        ArrayView<uint8_t> bytes = m_ctx.image->bytes;
+        out.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+};
+
+
+/**
+* Finds what rendering the listing from any line on depends on, in one pass that stops as soon as
+* nothing further can change it: the listing widens its address column at the first address past
+* 0xFFFF and never narrows it again.
+*/
+RenderPlan plan_render(const Listing& listing){
+    RenderPlan plan{NO_LINE};
+    for(size_t i = 0; i < listing.size(); i++){
+        if(has_address(listing[i].kind) && listing[i].address > 65535){
+            plan.wideLine = i;
+            break;
+        }
+    }
+    return plan;
+}
+
+
+/**
+* Writes buffers out in order, as few of them per writev() as the kernel allows.
+* @return False if a write failed.
+*/
+static bool write_buffers(int fd, struct iovec* iov, size_t count){
+    while(count > 0){
+        ssize_t written = ::writev(fd, iov, int(std::min(count, size_t(IOV_MAX))));
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        size_t left = written;
+        while(count > 0 && left >= iov->iov_len){                      // Skips what went out, and the empty buffers.
+            left -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if(count > 0){
+            iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+
+/**
+* Renders a large listing on several threads. The lines are cut into chunks that the workers take
+* in turn and render into buffers of their own, resuming their formatter at the chunk's first line
+* from a plan made beforehand; meanwhile this thread writes every run of consecutive finished
+* chunks with one writev(). Workers stay at most a window of chunks ahead of the writer, so the
+* buffers don't grow with the listing and are reused from one chunk to the next.
+* @param buffers: Receives what the formatter writes before the lines, after them, and then one
+* buffer per chunk of the window; kept by the caller so warm runs don't allocate them again.
+* @return False if a write failed.
+*/
+static bool render_parallel(const Listing& listing, const RenderContext& ctx, uint8_t format, int fd, int threads,
+                            std::vector<MemVector<char, MEM_OUTPUT>>& buffers){
+    size_t numChunks = (listing.size() + RENDER_CHUNK_LINES - 1) / RENDER_CHUNK_LINES;
+    size_t window = std::min(numChunks, size_t(threads) * CHUNKS_PER_THREAD);
+    if(buffers.size() < window + 2){
+        buffers.resize(window + 2);
+    }
+    for(MemVector<char, MEM_OUTPUT>& text : buffers){
+        text.clear();
+    }
+    RenderPlan plan = plan_render(listing);
+    std::unique_ptr<ListingFormatter> formatter(make_formatter(format, ctx));
+    {
+        OutputBuffer out(&buffers[0]);
+        formatter->begin(listing, out);
+        out.flush();
+    }
+
+    std::mutex lock;
+    std::condition_variable changed;
+    std::vector<uint8_t> ready(window);                                 // Whether each buffer holds its chunk.
+    size_t written = 0;                                                 // Chunks written out so far.
+    bool stop = false;
+    std::atomic<size_t> nextChunk(0);
+    auto worker = [&](){
+        std::unique_ptr<ListingFormatter> chunkFormatter(make_formatter(format, ctx));
+        size_t c;
+        while((c = nextChunk++) < numChunks){
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                changed.wait(guard, [&](){ return stop || c < written + window; });
+                if(stop){
+                    return;
+                }
+            }
+            size_t first = c * RENDER_CHUNK_LINES;
+            size_t last = std::min(listing.size(), first + RENDER_CHUNK_LINES);
+            MemVector<char, MEM_OUTPUT>& text = buffers[2 + c % window];
+            text.clear();
+            {
+                OutputBuffer out(&text);
+                chunkFormatter->resume(plan, first);
+                for(size_t i = first; i < last; i++){
+                    chunkFormatter->line(listing[i], out);
+                }
+                out.flush();
+            }
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                ready[c % window] = 1;
+            }
+            changed.notify_all();
+        }
+    };
+    std::vector<std::thread> pool;
+    for(int i = 0; i < threads && size_t(i) < numChunks; i++){
+        pool.emplace_back(worker);
+    }
+    {
+        OutputBuffer out(&buffers[1]);                                  // While the first chunks render.
+        formatter->end(listing, out);
+        out.flush();
+    }
+
+    bool ok = true;
+    std::vector<struct iovec> iov;
+    iov.reserve(window + 2);
+    auto add_buffer = [&](const MemVector<char, MEM_OUTPUT>& text){
+        iov.push_back(iovec{const_cast<char*>(text.data()), text.size()});
+    };
+    for(size_t c = 0; ok && c < numChunks;){
+        size_t last = c;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            changed.wait(guard, [&](){ return ready[c % window] != 0; });
+            while(last < numChunks && last < c + window && ready[last % window]){
+                last++;
+            }
+        }
+        iov.clear();
+        if(c == 0){
+            add_buffer(buffers[0]);
+        }
+        for(size_t i = c; i < last; i++){
+            add_buffer(buffers[2 + i % window]);
+        }
+        if(last == numChunks){
+            add_buffer(buffers[1]);
+        }
+        ok = write_buffers(fd, iov.data(), iov.size());
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            for(size_t i = c; i < last; i++){
+                ready[i % window] = 0;
+            }
+            written = last;
+            stop = !ok;
+        }
+        changed.notify_all();
+        c = last;
+    }
+    for(std::thread& thread : pool){
+        thread.join();
+    }
+    return ok;
+}
+
+
+/**
+* Writes the listing in the requested format to a file or stdout. Listings of at least
+* MIN_PARALLEL_LINES lines are rendered on several threads when given more than one.
+* @param listing: The lines of the listing.
+* @param image: The loaded object file, which holds the program name and the object code bytes.
+* @param symbols: The symbol index the ids stored in the listing lines refer to.
+* @param options: The output file and format.
+* @param error: Receives a description of the failure, if any.
+* @param threads: Threads rendering large listings; 0 for one per core.
+* @param buffers: Where large listings are rendered, reused from one call to the next if given.
+* @return True if the whole listing was written.
+*/
+bool create_output(const Listing& listing, const ObjectImage& image, const SymbolIndex& symbols,
+                   const OutputOptions& options, std::string& error, int threads,
+                   std::vector<MemVector<char, MEM_OUTPUT>>* buffers){
+    std::string path;
+    int fd = open_output(options, path, error);
+    if(fd < 0){
+        return false;
+    }
+
+    RenderContext ctx{&image, &symbols};
+    if(threads <= 0){
+        threads = int(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    bool ok;
+    if(threads > 1 && listing.size() >= MIN_PARALLEL_LINES){
+        std::vector<MemVector<char, MEM_OUTPUT>> ownBuffers;
+        ok = render_parallel(listing, ctx, options.format, fd, threads, buffers ? *buffers : ownBuffers);
+    }
+    else{
+        std::unique_ptr<ListingFormatter> formatter(make_formatter(options.format, ctx));
+        OutputBuffer out(fd);
+        formatter->begin(listing, out);
+        for(const ListingLine& line : listing){
+            formatter->line(line, out);
+        }
+        formatter->end(listing, out);
+        ok = out.flush();
+    }
+    return close_output(fd, path, ok, error);
+}
+
+
+/**
+* Writes a built symbol index as a .symidx file (see SymbolIndexHeader), which later runs load
+* in place of the symbol file without parsing or sorting anything.
+* @param symbols: The symbol index.
+* @param sourceHash: hash_text() of the symbol file it was built from.
+* @param sourceSize: The size of that symbol file.
+* @param path: The file to write, or "-" for stdout.
+* @param error: Receives a description of the failure, if any.
+* @return True if the whole file was written.
+*/
+bool write_symbol_index(const SymbolIndex& symbols, uint64_t sourceHash, uint64_t sourceSize, const std::string& path,
+                        std::string& error){
+    SymbolIndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "DSSY", 4);
+    header.version = 2;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.symbolCount = symbols.size();
+    header.nameBytes = symbols.arena().size();
+    header.allCount = symbols.all().size();
+    header.labelCount = symbols.labels().size();
+    header.literalCount = symbols.literals().size();
+    header.directCount = symbols.direct_table().size();
+    header.directStart = symbols.direct_start();
+
+    OutputOptions options;
+    options.path = path;
+    std::string opened;
+    int fd = open_output(options, opened, error);
+    if(fd < 0){
+        return false;
+    }
+    auto append_words = [](OutputBuffer& out, ArrayView<uint32_t> words){
+        out.append(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint32_t));
+    };
+    bool ok;
+    {
+        OutputBuffer out(fd);
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        append_words(out, symbols.name_offsets());
+        for(const SymbolTable* table : {&symbols.all(), &symbols.labels(), &symbols.literals()}){
+            append_words(out, table->addresses);
+            append_words(out, table->ids);
+        }
+        append_words(out, symbols.direct_table());
+        for(uint32_t id = 0; id < symbols.size(); id++){
+            out.put(char(symbols.kind(id)));
+        }
+        out.append(symbols.arena());
+        ok = out.flush();
+    }
+    return close_output(fd, opened, ok, error);
+}
+
+
+/**
+* Writes a loaded object image for later runs to load in place (see ObjectImageHeader).
+* @param image: The image, as parse_obj() left it.
+* @param sourceHash: hash_text() of the object file it was built from.
+* @param sourceSize: The size of that object file.
+* @param path: The file to write.
+* @param error: Receives a description of the failure, if any.
+* @return True if the file was written.
+*/
+bool write_object_image(const ObjectImage& image, uint64_t sourceHash, uint64_t sourceSize, const std::string& path,
+                        std::string& error){
+    ObjectImageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "DSOB", 4);
+    header.version = 2;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    std::memcpy(header.name, image.header.name.data(), std::min<size_t>(image.header.name.size(), 8));
+    header.start = image.header.start;
+    header.length = image.header.length;
+    header.textCount = image.texts.size();
+    header.modCount = image.mods.size();
+    header.firstInstr = image.end.firstInstr;
+
+    OutputOptions options;
+    options.path = path;
+    std::string opened;
+    int fd = open_output(options, opened, error);
+    if(fd < 0){
+        return false;
+    }
+    bool ok;
+    {
+        OutputBuffer out(fd);
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.append(reinterpret_cast<const char*>(image.texts.data()), image.texts.size() * sizeof(TextRecord));
+        for(const ModRecord& mod : image.mods){
+            ModRecord padded;                                       // Without stray padding bytes.
+            std::memset(&padded, 0, sizeof(padded));
+            padded.addr = mod.addr;
+            padded.halfBytes = mod.halfBytes;
+            padded.sign = mod.sign;
+            std::memcpy(padded.symbol, mod.symbol, sizeof(padded.symbol));
+            out.append(reinterpret_cast<const char*>(&padded), sizeof(padded));
+        }
+        out.append(reinterpret_cast<const char*>(image.bytes.data()), image.bytes.size());
+        ok = out.flush();
+    }
+    return close_output(fd, opened, ok, error);
+}
+
+
+/**
+* Opens the file a listing goes to.
+* @param options: The output file and format.
+* @param path: Receives the path opened: options.path, or out.<format> if that is empty.
+* @param error: Receives a description of the failure, if any.
+* @return The file descriptor, STDOUT_FILENO for "-", or -1 if the file cannot be created.
+*/
+int open_output(const OutputOptions& options, std::string& path, std::string& error){
+    path = options.path;
+    if(path.empty()){
+        path = std::string("out.") + output_extension(options.format);
+    }
+    if(path == "-"){
+        return STDOUT_FILENO;
+    }
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        error = "cannot create " + path + ": " + std::strerror(errno);
+    }
+    return fd;
+}
+
+
+/**
+* Closes the file a listing went to.
+* @param fd: From open_output().
+* @param path: The path it opened.
+* @param written: Whether everything was written.
+* @param error: Receives a description of the failure, if any.
+* @return True if everything was written and the file closed cleanly.
+*/
+bool close_output(int fd, const std::string& path, bool written, std::string& error){
+    if(fd != STDOUT_FILENO && ::close(fd) != 0){
+        written = false;
+    }
+    if(!written){
+        error = "cannot write " + path + ": " + std::strerror(errno);
+    }
+    return written;
+}
+
+
+/**
+* @param format: An OutputFormat.
+* @param ctx: What the formatter renders from. Must outlive the formatter.
+* @return A new formatter for the format, owned by the caller.
+*/
+ListingFormatter* make_formatter(uint8_t format, const RenderContext& ctx){
+    switch(format){
+    case OUTPUT_JSONL:
+        return new JsonlFormatter(ctx);
+    case OUTPUT_CSV:
+        return new CsvFormatter(ctx);
+    case OUTPUT_BIN:
+        return new BinaryFormatter(ctx);
+    default:
+        return new LstFormatter(ctx);
+    }
+}
+
+
+/**
+* @param name: A format name given on the command line (lst, jsonl, csv or bin).
+* @param format: Receives the matching OutputFormat.
+* @return False if the name is not a known format.
+*/
+bool parse_output_format(const std::string& name, uint8_t& format){
+    for(uint8_t f = OUTPUT_LST; f <= OUTPUT_BIN; f++){
+        if(name == output_extension(f)){
+            format = f;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+* @param format: An OutputFormat.
+* @return The format's name, which is also the extension of its default output file.
+*/
+const char* output_extension(uint8_t format){
+    static const char* const extensions[] = {"lst", "jsonl", "csv", "bin"};
+    return extensions[format <= OUTPUT_BIN ? format : uint8_t(OUTPUT_LST)];
+}
+
+
+/**
+* Renders the fields of a listing line. Text comes from the mnemonic and symbol tables and the
+* byte image; only the operand is built, in a buffer reused for every line.
+* @param line: The listing line.
+* @return The line's fields, valid until the next call.
+*/
+const LineFields& ListingFormatter::fields(const ListingLine& line){
+    const SymbolIndex& symbols = *m_ctx.symbols;
+    LineFields& f = m_fields;
+    f.hasAddress = true;
+    f.address = line.address;
+    f.label = line.label != NO_SYMBOL ? symbols.name(line.label) : std::string_view();
+    f.extended = false;
+    f.opCode = std::string_view();
+    f.objCode = nullptr;
+    f.objLength = 0;
+    m_operand.clear();
+
+    switch(line.kind){
+    case LINE_START:
+        f.label = m_ctx.image->header.name;
+        f.opCode = "START";
+        append_address(line.value, 0, m_operand);
+        break;
+    case LINE_INSTRUCTION:
+        f.opCode = g_mnemonicNames[line.mnemonic];
+        f.extended = line.length == 4;
+        render_operand(line, symbols, m_operand);
+        f.objCode = m_ctx.image->bytes.data() + line.objOffset;
+        f.objLength = line.length;
+        break;
+    case LINE_BASE:
+        f.hasAddress = false;
+        f.opCode = "BASE";
+        render_operand(line, symbols, m_operand);
+        break;
+    case LINE_LTORG:
+        f.hasAddress = false;
+        f.opCode = "LTORG";
+        break;
+    case LINE_LITERAL:
+        f.label = "*";
+        f.opCode = symbols.name(line.operand);
+        f.objCode = m_ctx.image->bytes.data() + line.objOffset;
+        f.objLength = line.length;
+        break;
+    case LINE_RESW:
+    case LINE_RESB:{
+        char digits[12];
+        f.opCode = line.kind == LINE_RESW ? "RESW" : "RESB";
+        auto result = std::to_chars(digits, digits + sizeof(digits), line.value);
+        m_operand.append(digits, result.ptr);
+        break;
+    }
+    case LINE_END:
+        f.hasAddress = false;
+        f.opCode = "END";
+        render_operand(line, symbols, m_operand);
+        break;
+    case LINE_CSECT:
+        f.opCode = "CSECT";
+        break;
+    }
+    f.operand = m_operand;
+    return f;
+}
+
+
+/**
+* Renders the operand of an instruction or directive from its operand kind, flags and symbol. An
+* address no symbol names is written in hexadecimals, as wide as the address column, so it does not
+* read as a decimal constant.
+* @param line: The listing line.
+* @param symbols: The symbol index.
+* @param operand: The operand text is appended to this string.
+*/
+void render_operand(const ListingLine& line, const SymbolIndex& symbols, std::string& operand){
+    char digits[12];
+    if(line.kind != LINE_INSTRUCTION){                                  // Directives name a symbol.
+        if(line.operand != NO_SYMBOL){
+            operand.append(symbols.name(line.operand));
+        }
+        else if(line.flags & FLAG_UNRESOLVED){                          // A BASE whose LDB is left unresolved.
+            auto result = std::to_chars(digits, digits + sizeof(digits), line.value);
+            operand.append(digits, result.ptr);
+        }
+        else{
+            append_address(line.value, 4, operand);
+        }
+        return;
+    }
+
+    int r1 = line.value >> 4;
+    int r2 = line.value & 0x0F;
+    switch(g_operandKinds[line.mnemonic]){
+    case OPERAND_NONE:
+        return;
+    case OPERAND_R1:
+        operand.append(register_name(r1));
+        return;
+    case OPERAND_R1R2:
+        operand.append(register_name(r1));
+        operand.push_back(',');
+        operand.append(register_name(r2));
+        return;
+    case OPERAND_R1N:{                                                  // Shift counts are stored minus one.
+        operand.append(register_name(r1));
+        operand.push_back(',');
+        auto result = std::to_chars(digits, digits + sizeof(digits), r2 + 1);
+        operand.append(digits, result.ptr);
+        return;
+    }
+    case OPERAND_N:{
+        auto result = std::to_chars(digits, digits + sizeof(digits), r1);
+        operand.append(digits, result.ptr);
+        return;
+    }
+    case OPERAND_BYTE:
+        operand.append("X'");
+        operand.append(g_hexPairs.pairs[line.value & 0xFF], 2);
+        operand.push_back('\'');
+        return;
+    default:
+        break;
+    }
+
+    if(operand_mode(line.flags) == OP_IMMEDIATE){
+        operand.push_back('#');
+    }
+    else if(operand_mode(line.flags) == OP_INDIRECT){
+        operand.push_back('@');
+    }
+
+    if(has_constant_operand(line.flags) || (line.flags & FLAG_UNRESOLVED)){ // A constant, or a displacement
+                                                                            // left as is.
+        auto result = std::to_chars(digits, digits + sizeof(digits), line.value);
+        operand.append(digits, result.ptr);
+    }
+    else if(line.operand != NO_SYMBOL){                                 // Operand is a symbol.
+        operand.append(symbols.name(line.operand));
+    }
+    else{
+        append_address(line.value, 4, operand);
+    }
+
+    if(line.flags & FLAG_X){
+        operand.append(",X");
+    }
+}
+
+
+/**
+* @param reg: A register number from a Format 2 instruction.
+* @return The name of the register, or an empty view if it has none.
+*/
+std::string_view register_name(int reg){
+    if(reg < 10 && !g_registers[reg].empty()){
+        return g_registers[reg];
+    }
+    static const std::string_view numbers[16] = {"0", "1", "2", "3", "4", "5", "6", "7",
+                                                 "8", "9", "10", "11", "12", "13", "14", "15"};
+    return numbers[reg & 0x0F];
+}
+
+
+OutputBuffer::OutputBuffer(int fd, size_t capacity)
+    : m_fd(fd), m_data(MemAllocator<char, MEM_OUTPUT>().allocate(capacity)), m_capacity(capacity) {}
+
+OutputBuffer::OutputBuffer(MemVector<char, MEM_OUTPUT>* sink, size_t capacity)
+    : m_fd(-1), m_sink(sink), m_data(MemAllocator<char, MEM_OUTPUT>().allocate(capacity)), m_capacity(capacity) {}
+
+OutputBuffer::~OutputBuffer(){
+    MemAllocator<char, MEM_OUTPUT>().deallocate(m_data, m_capacity);
+}
+
+
+/**
+* Appends bytes to the buffer, flushing first if they don't fit. Data larger than the whole
+* buffer is written straight through.
+*/
+void OutputBuffer::append(const char* data, size_t length){
+    if(m_used + length > m_capacity){
+        flush();
+        if(length > m_capacity){
+            if(!write_all(data, length)){
+                m_failed = true;
+            }
+            return;
+        }
+    }
+    std::memcpy(m_data + m_used, data, length);
+    m_used += length;
+}
+
+
+/**
+* Appends a character repeated count times.
+*/
+void OutputBuffer::pad(char c, size_t count){
+    while(count > 0){
+        size_t chunk = std::min(count, sizeof(g_spaces));
+        if(m_used + chunk > m_capacity){
+            flush();
+        }
+        std::memset(m_data + m_used, c, chunk);
+        m_used += chunk;
+        count -= chunk;
+    }
+}
+
+
+/**
+* Appends text right-aligned in a field of the given width. Longer text is not truncated.
+*/
+void OutputBuffer::append_right(std::string_view text, size_t width){
+    if(text.size() < width){
+        append(g_spaces, width - text.size());
+    }
+    append(text);
+}
+
+
+/**
+* Appends a value in uppercase hexadecimal, zero-padded to at least minDigits.
+*/
+void OutputBuffer::append_hex(uint32_t value, int minDigits){
+    char digits[8];
+    int count = 0;
+    do{
+        digits[7 - count++] = g_hexDigits[value & 0x0F];
+        value >>= 4;
+    } while(value != 0);
+    while(count < minDigits){
+        digits[7 - count++] = '0';
+    }
+    append(digits + 8 - count, count);
+}
+
+
+/**
+* Appends two uppercase hexadecimals per byte.
+*/
+void OutputBuffer::append_hex_bytes(const uint8_t* bytes, int numBytes){
+    if(m_used + numBytes * 2 > m_capacity){
+        flush();
+    }
+    for(int i = 0; i < numBytes; i++){
+        std::memcpy(m_data + m_used, g_hexPairs.pairs[bytes[i]], 2);
+        m_used += 2;
+    }
+}
+
+
+/**
+* Writes out everything buffered so far.
+* @return False if this or any earlier write failed.
+*/
+bool OutputBuffer::flush(){
+    if(m_used > 0 && !write_all(m_data, m_used)){
+        m_failed = true;
+    }
+    m_used = 0;
+    return !m_failed;
+}
+
+
+bool OutputBuffer::write_all(const char* data, size_t length){
+    m_flushed += length;
+    if(m_sink){
+        m_sink->insert(m_sink->end(), data, data + length);
+        return true;
+    }
+    while(length > 0){
+        ssize_t written = ::write(m_fd, data, length);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
@@ -1,3 +1,152 @@
-#include "disassembler.h"
-
-void create_output(std::vector<int> programCounter, std::vector<std::string> labels, std::vector<std::string> opCodes, std::vector<std::string> operands, std::vector<std::string> objectCodes);
\ No newline at end of file
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "disassembler.h"
+
+enum OutputFormat : uint8_t {
+    OUTPUT_LST,         // The fixed-width assembly listing.
+    OUTPUT_JSONL,       // One JSON object per listing line.
+    OUTPUT_CSV,         // One comma-separated row per listing line, with a header row.
+    OUTPUT_BIN          // Packed listing lines, symbol names and object code (see BinaryHeader).
+};
+
+const size_t MIN_PARALLEL_LINES = 1 << 16;         // Shorter listings are rendered on one thread.
+const size_t RENDER_CHUNK_LINES = 1 << 13;         // Lines a thread renders into one buffer.
+
+struct OutputOptions {
+    std::string path;               // Output file, "-" for stdout, empty for out.<format>.
+    uint8_t format = OUTPUT_LST;
+};
+
+/**
+* Layout of the packed binary format, in host byte order. The header is followed by lineCount
+* ListingLine records, symbolCount + 1 uint32_t offsets into the name arena, nameBytes of
+* symbol names, and imageLength bytes of object code starting at address imageStart.
+*/
+struct BinaryHeader {
+    char magic[4];                  // "DSLB"
+    uint32_t version;
+    uint32_t lineCount;
+    uint32_t symbolCount;
+    uint32_t nameBytes;
+    uint32_t imageStart;
+    uint32_t imageLength;
+    char program[8];                // Program name from the header record, padded with NULs.
+};
+
+/**
+* Everything a formatter needs to turn listing lines into text.
+*/
+struct RenderContext {
+    const ObjectImage* image;
+    const SymbolIndex* symbols;
+};
+
+/**
+* The rendered fields of one listing line. The views stay valid until the next line is rendered.
+*/
+struct LineFields {
+    bool hasAddress;                // Directives (LTORG, BASE, END) don't represent an address.
+    uint32_t address;
+    std::string_view label;
+    bool extended;                  // Format 4 instructions are prefixed with '+'.
+    std::string_view opCode;
+    std::string_view operand;
+    const uint8_t* objCode;
+    int objLength;
+};
+
+/**
+* What rendering a listing from any line on needs to know about the lines before it.
+*/
+struct RenderPlan {
+    size_t wideLine;                // The first line whose address needs five hexadecimals; NO_LINE if none.
+};
+
+/**
+* Append-only output buffer that hands data to the kernel in large writes, or to a memory sink.
+*/
+class OutputBuffer {
+public:
+    explicit OutputBuffer(int fd, size_t capacity = 1 << 20);
+    explicit OutputBuffer(MemVector<char, MEM_OUTPUT>* sink, size_t capacity = 1 << 16);
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+    ~OutputBuffer();
+
+    void append(const char* data, size_t length);
+    void append(std::string_view text){
+        append(text.data(), text.size());
+    }
+    void put(char c){
+        if(m_used == m_capacity){
+            flush();
+        }
+        m_data[m_used++] = c;
+    }
+    void pad(char c, size_t count);
+    void append_right(std::string_view text, size_t width);
+    void append_hex(uint32_t value, int minDigits);
+    void append_hex_bytes(const uint8_t* bytes, int numBytes);
+    bool flush();
+
+    bool failed() const {
+        return m_failed;
+    }
+    size_t position() const {           // Bytes appended so far, flushed or not.
+        return m_flushed + m_used;
+    }
+
+private:
+    bool write_all(const char* data, size_t length);
+
+    int m_fd;
+    MemVector<char, MEM_OUTPUT>* m_sink = nullptr;   // Where flushed data goes instead of m_fd, if set.
+    size_t m_flushed = 0;
+    char* m_data;
+    size_t m_capacity;
+    size_t m_used = 0;
+    bool m_failed = false;
+};
+
+/**
+* A listing output format. Formatters only decide how fields are laid out; rendering the
+* fields and buffering the output is shared by all of them.
+*/
+class ListingFormatter {
+public:
+    explicit ListingFormatter(const RenderContext& ctx) : m_ctx(ctx) {}
+    virtual ~ListingFormatter() {}
+
+    virtual void begin(const Listing&, OutputBuffer&){}
+    virtual void resume(const RenderPlan&, size_t){}              // As if the lines before had been rendered.
+    virtual void line(const ListingLine& line, OutputBuffer& out) = 0;
+    virtual void end(const Listing&, OutputBuffer&){}
+
+protected:
+    const LineFields& fields(const ListingLine& line);
+
+    const RenderContext& m_ctx;
+
+private:
+    LineFields m_fields;
+    std::string m_operand;          // Reused so rendering does not allocate once warmed up.
+};
+
+ListingFormatter* make_formatter(uint8_t format, const RenderContext& ctx);
+bool parse_output_format(const std::string& name, uint8_t& format);
+const char* output_extension(uint8_t format);
+RenderPlan plan_render(const Listing& listing);
+bool create_output(const Listing& listing, const ObjectImage& image, const SymbolIndex& symbols,
+                   const OutputOptions& options, std::string& error, int threads = 1,
+                   std::vector<MemVector<char, MEM_OUTPUT>>* buffers = nullptr);
+bool write_symbol_index(const SymbolIndex& symbols, uint64_t sourceHash, uint64_t sourceSize, const std::string& path,
+                        std::string& error);
+bool write_object_image(const ObjectImage& image, uint64_t sourceHash, uint64_t sourceSize, const std::string& path,
+                        std::string& error);
+int open_output(const OutputOptions& options, std::string& path, std::string& error);
+bool close_output(int fd, const std::string& path, bool written, std::string& error);
+void render_operand(const ListingLine& line, const SymbolIndex& symbols, std::string& operand);
+std::string_view register_name(int reg);
+
+#endif
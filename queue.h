@@ -0,0 +1,100 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+* Bounded queue between one producer thread and one consumer thread. It is lock-free: the
+* producer only advances the tail and the consumer only the head, each published with release
+* and read with acquire ordering, so a slot is never touched by both at once. A thread that finds
+* the queue full (or empty) yields until it isn't. The producer close()s the queue when done; the
+* consumer abandon()s it when it stops early, which makes every later push fail.
+*/
+template<class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : m_slots(round_up(capacity)), m_mask(m_slots.size() - 1) {}
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+    * Adds an item, waiting while the queue is full.
+    * @param item: Moved into the queue.
+    * @return False if the consumer abandoned the queue; the item is dropped.
+    */
+    bool push(T&& item){
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        while(tail - m_head.load(std::memory_order_acquire) == m_slots.size()){
+            if(m_abandoned.load(std::memory_order_acquire)){
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        if(m_abandoned.load(std::memory_order_acquire)){
+            return false;
+        }
+        m_slots[tail & m_mask] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+    * Takes the oldest item if there is one.
+    * @param item: Receives the item.
+    * @return False if the queue is empty right now.
+    */
+    bool try_pop(T& item){
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if(head == m_tail.load(std::memory_order_acquire)){
+            return false;
+        }
+        item = std::move(m_slots[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+    * Takes the oldest item, waiting while the queue is empty.
+    * @param item: Receives the item.
+    * @return False once the queue is closed and every item has been taken.
+    */
+    bool pop(T& item){
+        while(!try_pop(item)){
+            if(m_closed.load(std::memory_order_acquire)){
+                return try_pop(item);                       // Items pushed just before closing.
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    void close(){
+        m_closed.store(true, std::memory_order_release);
+    }
+
+    void abandon(){
+        m_abandoned.store(true, std::memory_order_release);
+    }
+
+private:
+    static size_t round_up(size_t capacity){
+        size_t size = 1;
+        while(size < capacity){
+            size *= 2;
+        }
+        return size;
+    }
+
+    std::vector<T> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_head{0};              // Next slot to pop; written by the consumer.
+    alignas(64) std::atomic<size_t> m_tail{0};              // Next slot to push; written by the producer.
+    std::atomic<bool> m_closed{false};
+    std::atomic<bool> m_abandoned{false};
+};
+
+#endif
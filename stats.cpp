@@ -0,0 +1,106 @@
+#include <iomanip>
+#include "stats.h"
+
+static const char* const g_phaseNames[PHASE_COUNT] = {
+    "parse_obj", "parse_sym", "gaps", "decode", "registers", "xref", "output"
+};
+
+static const char* const g_counterNames[STAT_COUNT] = {
+    "records", "text_records", "mod_records", "control_sections", "cache_hits", "cache_misses", "redecoded_records",
+    "symbols", "format1", "format2", "format3", "format4", "truncated_bytes", "literals", "ltorgs", "bases", "blocks",
+    "followed_operands", "symbol_lookups", "symbol_misses", "gap_lines", "lines"
+};
+
+
+/**
+* @param other: Counts to add to these, as from a chunk decoded on another thread.
+*/
+void StatCounters::add(const StatCounters& other){
+    for(int i = 0; i < STAT_COUNT; i++){
+        values[i] += other.values[i];
+    }
+}
+
+
+/**
+* Adds the times and counts of another run, as for the files of a batch.
+* @param other: The run to add.
+*/
+void RunStats::add(const RunStats& other){
+    for(int i = 0; i < PHASE_COUNT; i++){
+        seconds[i] += other.seconds[i];
+    }
+    counters.add(other.counters);
+}
+
+
+/**
+* @return The instructions decoded, of every format.
+*/
+uint64_t RunStats::instructions() const {
+    return counters.values[STAT_FORMAT1] + counters.values[STAT_FORMAT2] +
+           counters.values[STAT_FORMAT3] + counters.values[STAT_FORMAT4];
+}
+
+
+/**
+* @return The time spent in every phase.
+*/
+double RunStats::total_seconds() const {
+    double total = 0;
+    for(double phase : seconds){
+        total += phase;
+    }
+    return total;
+}
+
+
+/**
+* @param phase: The StatPhase.
+* @return Its name, as --stats prints it.
+*/
+const char* phase_name(int phase){
+    return g_phaseNames[phase];
+}
+
+
+/**
+* Prints the statistics as a table of milliseconds per phase and counts, or as one JSON object.
+* @param out: Where to print them.
+* @param stats: The statistics.
+* @param json: True for {"phases_ms": {...}, "counters": {...}}.
+*/
+void print_stats(std::ostream& out, const RunStats& stats, bool json){
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    if(json){
+        out << "{\"phases_ms\": {";
+        for(int i = 0; i < PHASE_COUNT; i++){
+            out << '"' << g_phaseNames[i] << "\": " << stats.seconds[i] * 1e3 << ", ";
+        }
+        out << "\"total\": " << stats.total_seconds() * 1e3 << "}, \"counters\": {";
+        for(int i = 0; i < STAT_COUNT; i++){
+            out << '"' << g_counterNames[i] << "\": " << stats.counters.values[i] << ", ";
+        }
+        out << "\"instructions\": " << stats.instructions() << "}}" << std::endl;
+    }
+    else{
+        out << std::left << std::setw(18) << "phase" << std::right << std::setw(14) << "ms" << '\n';
+        for(int i = 0; i < PHASE_COUNT; i++){
+            out << std::left << std::setw(18) << g_phaseNames[i] << std::right << std::setw(14)
+                << stats.seconds[i] * 1e3 << '\n';
+        }
+        out << std::left << std::setw(18) << "total" << std::right << std::setw(14)
+            << stats.total_seconds() * 1e3 << "\n\n";
+        out << std::left << std::setw(18) << "counter" << std::right << std::setw(14) << "count" << '\n';
+        for(int i = 0; i < STAT_COUNT; i++){
+            out << std::left << std::setw(18) << g_counterNames[i] << std::right << std::setw(14)
+                << stats.counters.values[i] << '\n';
+        }
+        out << std::left << std::setw(18) << "instructions" << std::right << std::setw(14)
+            << stats.instructions() << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
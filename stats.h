@@ -0,0 +1,111 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Statistics are on unless built with -DDISSEM_STATS=0 (make STATS=0), which compiles every
+// timer and counter below to nothing.
+#ifndef DISSEM_STATS
+#define DISSEM_STATS 1
+#endif
+
+enum StatPhase : uint8_t {
+    PHASE_PARSE_OBJ,        // Loading the object file.
+    PHASE_PARSE_SYM,        // Loading the symbol file and building the symbol index.
+    PHASE_GAPS,             // Planning the reserved regions.
+    PHASE_DECODE,           // Decoding the text records, with the regions that follow them.
+    PHASE_REGISTERS,        // Completing the operands that depend on the B and X registers.
+    PHASE_XREF,             // Building the cross-reference index, when asked for.
+    PHASE_OUTPUT,           // Rendering and writing the listing.
+    PHASE_COUNT
+};
+
+enum StatCounter : uint8_t {
+    STAT_RECORDS,           // Records of every type in the object file.
+    STAT_TEXT_RECORDS,
+    STAT_MOD_RECORDS,
+    STAT_SECTIONS,          // Control sections, linked into one program if more than one.
+    STAT_CACHE_HITS,        // Object images loaded from the cache instead of parsed.
+    STAT_CACHE_MISSES,      // Object files parsed and added to the cache.
+    STAT_REDECODED,         // Text records update() decoded again.
+    STAT_SYMBOLS,           // Labels and literals in the symbol file.
+    STAT_FORMAT1,           // Instructions decoded, by format.
+    STAT_FORMAT2,
+    STAT_FORMAT3,
+    STAT_FORMAT4,
+    STAT_TRUNCATED,         // Bytes of instructions cut off by the end of a text record.
+    STAT_LITERALS,
+    STAT_LTORGS,
+    STAT_BASES,             // BASE directives.
+    STAT_BLOCKS,            // Basic blocks of the register flow analysis.
+    STAT_FOLLOWED_OPERANDS, // Base-relative or indexed operands whose registers it followed on every path.
+    STAT_LOOKUPS,           // Symbol lookups for labels and operands.
+    STAT_MISSES,            // Lookups that found no symbol.
+    STAT_GAP_LINES,         // RESW and RESB lines.
+    STAT_LINES,             // Lines in the listing.
+    STAT_COUNT
+};
+
+struct StatCounters {
+    uint64_t values[STAT_COUNT] = {};
+
+    void add(const StatCounters& other);
+};
+
+/**
+* What one or more runs spent in each phase and what they came across.
+*/
+struct RunStats {
+    double seconds[PHASE_COUNT] = {};
+    StatCounters counters;
+
+    void clear(){
+        *this = RunStats();
+    }
+    void add(const RunStats& other);
+    uint64_t instructions() const;
+    double total_seconds() const;
+};
+
+void print_stats(std::ostream& out, const RunStats& stats, bool json);
+const char* phase_name(int phase);
+
+#if DISSEM_STATS
+
+/**
+* Adds the time from its construction to its destruction to a phase.
+*/
+class ScopedTimer {
+public:
+    explicit ScopedTimer(double& seconds) : m_seconds(seconds), m_start(Clock::now()) {}
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer(){
+        m_seconds += std::chrono::duration<double>(Clock::now() - m_start).count();
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    double& m_seconds;
+    Clock::time_point m_start;
+};
+
+#define STAT_JOIN_(a, b) a##b
+#define STAT_JOIN(a, b) STAT_JOIN_(a, b)
+#define STAT_TIMER(stats, phase) ScopedTimer STAT_JOIN(statTimer, __LINE__)((stats).seconds[phase])
+#define STAT_ADD(counters, counter, n) ((counters).values[counter] += (n))
+#define STAT_MERGE(counters, other) ((counters).add(other))
+
+#else
+
+#define STAT_TIMER(stats, phase) ((void)0)
+#define STAT_ADD(counters, counter, n) ((void)0)
+#define STAT_MERGE(counters, other) ((void)0)
+
+#endif
+
+#endif
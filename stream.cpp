@@ -0,0 +1,354 @@
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include "output.h"
+#include "queue.h"
+
+const uint32_t STREAM_WINDOW = 1 << 16;             // Most object code bytes in one block.
+const size_t STREAM_WINDOW_RECORDS = 4096;          // Most text and modification records in one block.
+const size_t STREAM_QUEUE_BLOCKS = 4;               // Blocks in flight between two stages.
+const size_t STREAM_SPENT_BLOCKS = 16;              // More than can be in flight, so handing one back never waits.
+
+/**
+* A window of the program passed down the pipeline: the records read from it, as an image whose
+* header covers just the window, and then the listing lines decoded from them.
+*/
+struct StreamBlock {
+    ObjectImage image;
+    HeaderRecord program;                           // The whole program's header; set in the first block.
+    Listing lines;
+};
+
+
+/**
+* Starts a window of the program at an address.
+* @param block: The block to reuse.
+* @param program: The program's header record.
+* @param start: The first address of the window.
+*/
+static void start_window(StreamBlock& block, const HeaderRecord& program, uint32_t start){
+    block.image.clear();
+    block.image.header.name = program.name;
+    block.image.header.start = start;
+    block.image.header.length = std::min(STREAM_WINDOW, program.start + program.length - start);
+    block.image.reset_bytes(block.image.header.length);
+    block.image.hasHeader = true;
+    block.lines.clear();
+}
+
+
+/**
+* Reader stage: parses the object file record by record into windows of the program and passes
+* them on, each once the next record does not fit in it. Blocks the writer is done with are
+* reused, so their buffers are only allocated while the pipeline fills up.
+* @param input: The object file.
+* @param blocks: Where the windows go; closed when the file has been read.
+* @param spent: Blocks handed back by the writer.
+* @param stats: Receives the time spent parsing and the records read.
+* @param error: Receives a description of the failure, if any.
+* @return True if the whole file was read and is well formed.
+*/
+static bool read_records(LineStream& input, BoundedQueue<StreamBlock>& blocks, BoundedQueue<StreamBlock>& spent,
+                         RunStats& stats, std::string& error){
+    RunStats waits;
+    bool ok = true;
+    {
+        STAT_TIMER(stats, PHASE_PARSE_OBJ);
+        StreamBlock block;
+        HeaderRecord program;
+        bool hasHeader = false;
+        auto pass_on = [&](uint32_t start){                             // Hands over the window and starts the next.
+            StreamBlock next;
+            spent.try_pop(next);
+            std::swap(block, next);
+            STAT_TIMER(waits, PHASE_PARSE_OBJ);
+            if(!blocks.push(std::move(next))){                          // The listing can no longer be written.
+                return false;
+            }
+            start_window(block, program, start);
+            return true;
+        };
+
+        std::string_view line;
+        while(input.next(line)){
+            if(line.empty()){
+                continue;
+            }
+            STAT_ADD(stats.counters, STAT_RECORDS, 1);
+            if(!hasHeader && line[0] == 'H'){
+                if(!(ok = parse_header(line, program, error))){
+                    break;
+                }
+                hasHeader = true;
+                start_window(block, program, program.start);
+                block.program = program;
+                continue;
+            }
+
+            const ObjectImage& image = block.image;
+            if(hasHeader && !image.hasEnd && (line[0] == 'T' || line[0] == 'M')){
+                TextRecord text;
+                uint32_t next = image.header.start;
+                if(line[0] == 'T' && line.length() >= 9 && parse_hex_field(line, 1, 6, text.start) &&
+                   parse_hex_field(line, 7, 2, text.length)){
+                    if(text.start < program.start || text.start + text.length > program.start + program.length){
+                        error = "text record lies outside the program";
+                        ok = false;
+                        break;
+                    }
+                    if(text.start < image.header.start || text.start + text.length > image.end_addr()){
+                        next = text.start;
+                    }
+                }
+                if((next != image.header.start || image.texts.size() + image.mods.size() >= STREAM_WINDOW_RECORDS) &&
+                   !pass_on(next)){
+                    blocks.close();
+                    return true;                                        // The writer reports why.
+                }
+                STAT_ADD(stats.counters, line[0] == 'T' ? STAT_TEXT_RECORDS : STAT_MOD_RECORDS, 1);
+            }
+            if(!(ok = parse_record(line, block.image, error))){
+                break;
+            }
+        }
+        if(!ok){
+            error = "line " + std::to_string(input.line_number()) + ": " + error;
+        }
+        else if(!input.error().empty()){
+            error = input.error();
+            ok = false;
+        }
+        else if(!hasHeader){
+            error = "missing header record";
+            ok = false;
+        }
+        else if(!block.image.hasEnd){
+            error = "missing end record";
+            ok = false;
+        }
+        if(ok){
+            STAT_TIMER(waits, PHASE_PARSE_OBJ);
+            blocks.push(std::move(block));
+        }
+        blocks.close();
+    }
+    stats.seconds[PHASE_PARSE_OBJ] -= waits.seconds[PHASE_PARSE_OBJ];
+    return ok;
+}
+
+
+/**
+* Writer stage: renders each block as it arrives. Whatever is buffered is written out whenever
+* the next block is not ready yet, so the listing appears as soon as it is decoded.
+* @param blocks: The decoded blocks, in listing order.
+* @param spent: Where blocks go once written, for the reader to reuse.
+* @param symbols: The symbols of the program.
+* @param options: Where and in which format to write the listing.
+* @param stats: Receives the time spent writing.
+* @param error: Receives a description of the failure, if any.
+* @return True if the listing was written.
+*/
+static bool write_blocks(BoundedQueue<StreamBlock>& blocks, BoundedQueue<StreamBlock>& spent,
+                         const SymbolIndex& symbols, const OutputOptions& options, RunStats& stats, std::string& error){
+    RunStats waits;
+    bool ok;
+    {
+        STAT_TIMER(stats, PHASE_OUTPUT);
+        std::string path;
+        int fd = open_output(options, path, error);
+        if(fd < 0){
+            blocks.abandon();
+            return false;
+        }
+
+        ObjectImage none;
+        RenderContext ctx{&none, &symbols};                             // Points at each block's image in turn.
+        std::unique_ptr<ListingFormatter> formatter(make_formatter(options.format, ctx));
+        Listing empty;
+        {
+            OutputBuffer out(fd);
+            formatter->begin(empty, out);
+            StreamBlock block;
+            while(true){
+                if(!blocks.try_pop(block)){
+                    out.flush();
+                    STAT_TIMER(waits, PHASE_OUTPUT);
+                    if(!blocks.pop(block)){
+                        break;
+                    }
+                }
+                ctx.image = &block.image;
+                for(const ListingLine& line : block.lines){
+                    formatter->line(line, out);
+                }
+                if(out.failed()){
+                    blocks.abandon();
+                    break;
+                }
+                spent.push(std::move(block));
+            }
+            formatter->end(empty, out);
+            ok = out.flush();
+        }
+        ok = close_output(fd, path, ok, error);
+    }
+    stats.seconds[PHASE_OUTPUT] -= waits.seconds[PHASE_OUTPUT];
+    return ok;
+}
+
+
+/**
+* Disassembles an object file as a pipeline: one thread reads and parses records, another
+* decodes them, and the calling thread writes the listing while the rest of the file is still
+* being read. Only a few windows of the program are held at a time; the symbol file is read
+* whole, as every window needs it. Produces the same listing as run(), but for the operands that
+* depend on B and X: those are followed along the jumps seen so far (see ForwardFlow), so a jump
+* back may change operands already written, which warning() then says, along with how many
+* operands paths reach with different values, left as their displacement as run() leaves them.
+* @param objFile: Path to the object file, or "-" for stdin.
+* @param symTab: Path to the symbol file.
+* @param output: Where and in which format to write the listing; any but OUTPUT_BIN.
+* @param error: Receives a description of the failure, if any.
+* @return True if the listing was written.
+*/
+bool Disassembler::stream(const std::string& objFile, const std::string& symTab, const OutputOptions& output,
+                          std::string& error){
+    if(output.format == OUTPUT_BIN){
+        error = "the bin format cannot be streamed: its header counts the whole listing";
+        return false;
+    }
+    m_stats.clear();
+    m_image.clear();
+    m_imageInput.close();
+    m_symbols.clear();
+    m_listing.clear();
+    m_flow.clear();                                                     // Registers go along the jumps seen.
+    m_warning.clear();
+    m_unresolved = 0;
+    {
+        STAT_TIMER(m_stats, PHASE_PARSE_SYM);
+        if(!m_symInput.open(symTab, error) ||
+           (is_symbol_index(m_symInput.text()) && !check_index_source(m_symInput.text(), symTab, error))){
+            m_symInput.close();
+            return false;
+        }
+        if(!load_symbols(m_symInput.text(), true, error)){
+            m_symInput.close();
+            return false;
+        }
+    }
+    STAT_ADD(m_stats.counters, STAT_SYMBOLS, m_symbols.size());
+
+    LineStream input;
+    if(!input.open(objFile, error)){
+        m_symbols.clear();
+        m_symInput.close();
+        return false;
+    }
+
+    BoundedQueue<StreamBlock> records(STREAM_QUEUE_BLOCKS);
+    BoundedQueue<StreamBlock> decoded(STREAM_QUEUE_BLOCKS);
+    BoundedQueue<StreamBlock> spent(STREAM_SPENT_BLOCKS);
+    RunStats readStats;
+    RunStats writeStats;
+    std::string readError;
+    bool readOk = false;
+    std::thread reader([&](){
+        readOk = read_records(input, records, spent, readStats, readError);
+    });
+
+    std::thread decoder([&](){                                          // Decodes each window as decode() would the
+        RunStats waits;                                                 // whole program, carrying the gap planner,
+        {                                                               // literal pools and registers across them.
+            STAT_TIMER(m_stats, PHASE_DECODE);
+            GapPlanner planner(m_symbols, 0);
+            GapList regions;
+            DecodeChunk state;
+            state.literalEnd = 0;
+            HeaderRecord program;
+            bool first = true;
+            uint32_t prevEnd = 0;
+            int after = GAP_LEADING;
+            reset_registers();
+            m_streaming = true;
+            StreamBlock block;
+            while(true){
+                bool popped;
+                {
+                    STAT_TIMER(waits, PHASE_DECODE);
+                    popped = records.pop(block);
+                }
+                if(!popped){
+                    break;
+                }
+                std::swap(m_image, block.image);
+                if(first){
+                    first = false;
+                    program = block.program;
+                    prevEnd = program.start;
+                    m_forward.clear(program.start);
+                    add_line(block.lines, LINE_START, program.start).value = program.start;
+                }
+                for(const TextRecord& text : m_image.texts){
+                    regions.clear();
+                    planner.plan(after, prevEnd, text.start, regions);
+                    for(const GapRegion& gap : regions){
+                        add_gap(block.lines, gap, state.counters);
+                    }
+                    decode_record(text, state, block.lines);
+                    prevEnd = text.start + text.length;
+                    after++;
+                }
+                resolve_registers(block.lines);
+                if(m_image.hasEnd){
+                    regions.clear();
+                    planner.plan(after, prevEnd, program.start + program.length, regions);
+                    for(const GapRegion& gap : regions){
+                        add_gap(block.lines, gap, state.counters);
+                    }
+                    ListingLine& end = add_line(block.lines, LINE_END, m_image.end.firstInstr);
+                    end.value = m_image.end.firstInstr;
+                    end.operand = add_label(m_image.end.firstInstr, state.counters);
+                }
+                STAT_ADD(state.counters, STAT_LINES, block.lines.size());
+                std::swap(m_image, block.image);
+
+                bool pushed;
+                {
+                    STAT_TIMER(waits, PHASE_DECODE);
+                    pushed = decoded.push(std::move(block));
+                }
+                if(!pushed){
+                    records.abandon();
+                    break;
+                }
+            }
+            m_streaming = false;
+            decoded.close();
+            STAT_MERGE(m_stats.counters, state.counters);
+        }
+        m_stats.seconds[PHASE_DECODE] -= waits.seconds[PHASE_DECODE];
+    });
+
+    bool written = write_blocks(decoded, spent, m_symbols, output, writeStats, error);
+    decoder.join();
+    reader.join();
+    m_stats.add(readStats);
+    m_stats.add(writeStats);
+    if(m_symbols.is_mapped()){                                          // It points into the file.
+        m_symbols.clear();
+    }
+    m_symInput.close();
+    if(!readOk){
+        error = objFile + ": " + readError;
+        return false;
+    }
+    report_unresolved();
+    if(m_forward.revisits() > 0){
+        char addr[16];
+        std::snprintf(addr, sizeof(addr), "%04X", m_forward.first_revisit());
+        m_warning += std::string(m_warning.empty() ? "" : "; ") + "a jump back to " + addr +
+                     " may change operands already written; run without --stream to follow every path";
+    }
+    return written;
+}
@@ -0,0 +1,415 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include "symbols.h"
+#include "input.h"
+#include "loader.h"
+
+const uint32_t MAX_DIRECT_SPAN = 1 << 20;      // Largest direct table built: 4 MiB of ids.
+const uint32_t MAX_DIRECT_SPARSENESS = 16;      // Addresses per symbol allowed in the direct table.
+
+/**
+* Branch-free binary search: the loop runs log2(n) times and the comparison becomes a
+* conditional move, so lookups don't stall on mispredicted branches.
+* @param addr: The address to search for.
+* @return The index of the first address not below addr, or size() if there is none.
+*/
+size_t SymbolTable::lower_bound(uint32_t addr) const {
+    size_t length = addresses.size();
+    if(length == 0){
+        return 0;
+    }
+    const uint32_t* base = addresses.data();
+    while(length > 1){
+        size_t half = length / 2;
+        base = base[half] < addr ? base + half : base;
+        length -= half;
+    }
+    return (base - addresses.data()) + (*base < addr);
+}
+
+
+/**
+* @param addr: The address to look up.
+* @return The id of the symbol at the address, NO_SYMBOL if there is none.
+*/
+uint32_t SymbolTable::find(uint32_t addr) const {
+    size_t i = lower_bound(addr);
+    return i < addresses.size() && addresses[i] == addr ? ids[i] : NO_SYMBOL;
+}
+
+
+/**
+* Finds the next token of a line.
+* @param p: Where to start looking; moved past the token.
+* @param end: The end of the line.
+* @return The token, empty if the line has no more.
+*/
+static inline std::string_view next_token(const char*& p, const char* end){
+    while(p < end && (*p == ' ' || *p == '\t')){
+        p++;
+    }
+    const char* start = p;
+    while(p < end && *p != ' ' && *p != '\t'){
+        p++;
+    }
+    return std::string_view(start, p - start);
+}
+
+
+/**
+* Parses a symbol file into the index in one pass over the text, without copying any line.
+* Names starting with '=' are literals; every other symbol is a label. Headings, rulers and lines
+* with fewer than three fields (such as blank ones) are skipped.
+* @param text: The contents of the symbol file.
+* @param symbols: Receives the symbols, built and ready for lookups.
+*/
+void parse_symbols(std::string_view text, SymbolIndex& symbols){
+    symbols.clear();
+    add_symbols(text, symbols, ArrayView<uint32_t>());
+    symbols.build();
+}
+
+
+/**
+* Adds the symbols of a symbol file to an index that is yet to be built, as parse_symbols() reads
+* them. The symbol file of an object file with several control sections holds the tables of each
+* section in turn, each starting with its own Symbol heading and counting from the section's own
+* starting address; the values of each are moved by where the linker put the section.
+* @param text: The contents of the symbol file.
+* @param symbols: The symbols are added here.
+* @param offsets: What to add to the values of each section's symbols, in order; the last one also
+*                 goes for any further tables. Empty to take the values as they are.
+*/
+void add_symbols(std::string_view text, SymbolIndex& symbols, ArrayView<uint32_t> offsets){
+    size_t section = 0;
+    bool headed = false;                                                // Whether a Symbol heading was seen.
+    uint32_t offset = offsets.empty() ? 0 : offsets[0];
+    const char* p = text.data();
+    const char* textEnd = p + text.size();
+    while(p < textEnd){
+        const char* end = static_cast<const char*>(std::memchr(p, '\n', textEnd - p));
+        const char* next = end ? end + 1 : textEnd;
+        end = end ? end : textEnd;
+        if(end > p && end[-1] == '\r'){
+            end--;
+        }
+        char first = p < end ? *p : '\0';
+        if(first == 'S' && end - p >= 6 && std::memcmp(p, "Symbol", 6) == 0){
+            if(headed && section + 1 < offsets.size()){                 // The next control section's table.
+                offset = offsets[++section];
+            }
+            headed = true;
+            p = next;
+            continue;
+        }
+        if(first == '-' || (first == 'N' && end - p >= 4 && std::memcmp(p, "Name", 4) == 0)){
+            p = next;                                                   // Other headings and rulers.
+            continue;
+        }
+
+        std::string_view name = next_token(p, end);
+        std::string_view second = next_token(p, end);
+        std::string_view third = next_token(p, end);
+        p = next;
+        if(third.empty()){
+            continue;
+        }
+        std::string_view addrToken = third[0] == 'R' || third[0] == 'A' ? second : third;  // Label: NAME ADDR FLAGS;
+        uint32_t addr;                                                  // literal: NAME LENGTH ADDR.
+        auto result = std::from_chars(addrToken.data(), addrToken.data() + addrToken.size(), addr, 16);
+        if(result.ec == std::errc() && result.ptr == addrToken.data() + addrToken.size()){
+            symbols.add(name, addr + offset, name[0] == '=' ? SYMBOL_LITERAL : SYMBOL_LABEL);
+        }
+    }
+}
+
+
+/**
+* @param data: The contents of a file.
+* @return True if it is a precompiled symbol index rather than a symbol file.
+*/
+bool is_symbol_index(std::string_view data){
+    return data.size() >= 4 && std::memcmp(data.data(), "DSSY", 4) == 0;
+}
+
+
+/**
+* Checks that a symbol index was built from the symbol file next to it, if there is one: the
+* index of test.sym is test.symidx, and an index older than its symbol file is refused rather than
+* listing the old symbols.
+* @param index: The contents of the index.
+* @param indexFile: Its path.
+* @param error: Receives a description of the failure, if any.
+* @return False if the symbol file beside the index has changed since the index was written.
+*/
+bool check_index_source(std::string_view index, const std::string& indexFile, std::string& error){
+    const char* extension = ".symidx";
+    size_t length = std::strlen(extension);
+    if(index.size() < sizeof(SymbolIndexHeader) || indexFile.size() <= length ||
+       indexFile.compare(indexFile.size() - length, length, extension) != 0){
+        return true;
+    }
+    std::string symFile = indexFile.substr(0, indexFile.size() - 3);       // test.symidx becomes test.sym.
+    InputFile source;
+    std::string ignored;
+    if(!source.open(symFile, ignored)){                                     // Only the index was kept.
+        return true;
+    }
+    SymbolIndexHeader header;
+    std::memcpy(&header, index.data(), sizeof(header));
+    if(header.sourceSize != source.text().size() || header.sourceHash != hash_text(source.text())){
+        error = indexFile + " was built from another version of " + symFile + "; run ./dissem index-sym " +
+                symFile + " again";
+        return false;
+    }
+    return true;
+}
+
+
+/**
+* Checks one table of a loaded index: ascending addresses without duplicates, and valid ids.
+* @param addrs: The table's addresses.
+* @param ids: The symbol id at each.
+* @param count: The number of addresses.
+* @param symbolCount: The number of symbols in the index.
+* @return True if a search of the table stays within the index.
+*/
+static bool valid_table(const uint32_t* addrs, const uint32_t* ids, uint32_t count, uint32_t symbolCount){
+    for(uint32_t i = 0; i < count; i++){
+        if(ids[i] >= symbolCount || (i > 0 && addrs[i] <= addrs[i - 1])){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+* Points the table at arrays held elsewhere, or copies them into the table.
+* @param addrs: Ascending addresses.
+* @param symbolIds: The symbol id at each address.
+* @param count: The number of addresses.
+* @param copy: Whether to copy the arrays rather than use them in place.
+*/
+void SymbolTable::assign(const uint32_t* addrs, const uint32_t* symbolIds, size_t count, bool copy){
+    if(copy){
+        m_addresses.assign(addrs, addrs + count);
+        m_ids.assign(symbolIds, symbolIds + count);
+        publish();
+        return;
+    }
+    m_addresses.clear();
+    m_ids.clear();
+    addresses = ArrayView<uint32_t>{addrs, count};
+    ids = ArrayView<uint32_t>{symbolIds, count};
+}
+
+
+/**
+* Sorts the given symbols into a table. When several share an address the one added first is kept.
+* Symbol files list their symbols in address order, so the sort is usually skipped.
+* @param ids: Symbol ids in the order they were added; sorted in place.
+* @param symAddrs: The address of every symbol id.
+* @param table: Receives the sorted table.
+*/
+static void build_table(MemVector<uint32_t, MEM_SYMBOLS>& ids, const MemVector<uint32_t, MEM_SYMBOLS>& symAddrs,
+                        SymbolTable& table){
+    // Ties go to the lower id, as stable_sort would, without the buffer stable_sort allocates.
+    auto before = [&](uint32_t a, uint32_t b){
+        return symAddrs[a] < symAddrs[b] || (symAddrs[a] == symAddrs[b] && a < b);
+    };
+    if(!std::is_sorted(ids.begin(), ids.end(), before)){
+        std::sort(ids.begin(), ids.end(), before);
+    }
+    table.clear();
+    for(size_t i = 0; i < ids.size(); i++){
+        if(i == 0 || symAddrs[ids[i]] != symAddrs[ids[i - 1]]){
+            table.push_back(symAddrs[ids[i]], ids[i]);
+        }
+    }
+    table.publish();
+}
+
+
+/**
+* Merges the label and literal tables into the combined table. At a shared address the symbol
+* added first wins, as if the combined table had been sorted from scratch.
+* @param labels: The label table.
+* @param literals: The literal table.
+* @param all: Receives the combined table.
+*/
+static void merge_tables(const SymbolTable& labels, const SymbolTable& literals, SymbolTable& all){
+    all.clear();
+    size_t i = 0;
+    size_t j = 0;
+    while(i < labels.size() || j < literals.size()){
+        if(j == literals.size() || (i < labels.size() && labels.addresses[i] < literals.addresses[j])){
+            all.push_back(labels.addresses[i], labels.ids[i]);
+            i++;
+        }
+        else if(i == labels.size() || literals.addresses[j] < labels.addresses[i]){
+            all.push_back(literals.addresses[j], literals.ids[j]);
+            j++;
+        }
+        else{
+            all.push_back(labels.addresses[i], std::min(labels.ids[i], literals.ids[j]));
+            i++;
+            j++;
+        }
+    }
+    all.publish();
+}
+
+
+/**
+* Points the lookups at the index's own arrays.
+*/
+void SymbolIndex::publish(){
+    m_names = m_arena.data();
+    m_nameOffsets = m_offsets.data();
+    m_kinds = ArrayView<uint8_t>{m_kindValues.data(), m_kindValues.size()};
+    m_direct = ArrayView<uint32_t>{m_directIds.data(), m_directIds.size()};
+}
+
+
+/**
+* Removes every symbol.
+*/
+void SymbolIndex::clear(){
+    m_arena.clear();
+    m_offsets.assign(1, 0);
+    m_kindValues.clear();
+    m_symAddrs.clear();
+    m_all.clear();
+    m_labels.clear();
+    m_literals.clear();
+    m_directIds.clear();
+    m_directStart = 0;
+    m_mapped = false;
+    publish();
+}
+
+
+/**
+* Adds a symbol. Lookups only see it after the next call to build().
+* @param name: The symbol's name, copied into the arena.
+* @param addr: The symbol's address.
+* @param kind: The SymbolKind.
+* @return The symbol's id.
+*/
+uint32_t SymbolIndex::add(std::string_view name, uint32_t addr, uint8_t kind){
+    m_arena.append(name);
+    m_offsets.push_back(m_arena.size());
+    m_kindValues.push_back(kind);
+    m_symAddrs.push_back(addr);
+    return m_kindValues.size() - 1;
+}
+
+
+/**
+* Builds the lookup tables from the symbols added so far.
+* @param allowDirect: Whether a direct table may be built when the symbols are dense enough.
+*/
+void SymbolIndex::build(bool allowDirect){
+    for(uint8_t kind : {SYMBOL_LABEL, SYMBOL_LITERAL}){
+        m_order.clear();
+        for(uint32_t id = 0; id < m_kindValues.size(); id++){
+            if(m_kindValues[id] == kind){
+                m_order.push_back(id);
+            }
+        }
+        build_table(m_order, m_symAddrs, kind == SYMBOL_LITERAL ? m_literals : m_labels);
+    }
+    merge_tables(m_labels, m_literals, m_all);
+
+    m_directIds.clear();
+    m_directStart = 0;
+    publish();
+    if(!allowDirect || m_all.size() == 0){
+        return;
+    }
+    uint32_t first = m_all.addresses.front();
+    uint64_t span = uint64_t(m_all.addresses.back()) - first + 1;
+    if(span > MAX_DIRECT_SPAN || span > uint64_t(MAX_DIRECT_SPARSENESS) * m_all.size()){
+        return;
+    }
+    m_directStart = first;
+    m_directIds.assign(span, NO_SYMBOL);
+    for(size_t i = 0; i < m_all.size(); i++){
+        m_directIds[m_all.addresses[i] - first] = m_all.ids[i];
+    }
+    publish();
+}
+
+
+/**
+* Loads an index written by write_symbol_index() (see SymbolIndexHeader), replacing this one.
+* @param data: The contents of the .symidx file.
+* @param copy: Whether to copy the arrays; if not, data must outlive the index (or its next clear()).
+* @param error: Receives a description of the failure, if any.
+* @return False if the data is not a well-formed symbol index.
+*/
+bool SymbolIndex::load(std::string_view data, bool copy, std::string& error){
+    clear();
+    const SymbolIndexHeader* header = reinterpret_cast<const SymbolIndexHeader*>(data.data());
+    if(data.size() < sizeof(SymbolIndexHeader) || std::memcmp(header->magic, "DSSY", 4) != 0 || header->version != 2){
+        error = "not a symbol index";
+        return false;
+    }
+    uint64_t words = uint64_t(header->symbolCount) + 1 + 2 * (uint64_t(header->allCount) + header->labelCount +
+                     header->literalCount) + header->directCount;
+    if(sizeof(SymbolIndexHeader) + words * 4 + header->symbolCount + header->nameBytes > data.size() ||
+       reinterpret_cast<uintptr_t>(data.data()) % alignof(uint32_t) != 0){
+        error = "truncated symbol index";
+        return false;
+    }
+
+    const SymbolIndexHeader& h = *header;
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(header + 1);
+    const uint32_t* tables = offsets + h.symbolCount + 1;
+    const uint32_t* direct = tables + 2 * (uint64_t(h.allCount) + h.labelCount + h.literalCount);
+    const uint8_t* kinds = reinterpret_cast<const uint8_t*>(direct + h.directCount);
+    const char* names = reinterpret_cast<const char*>(kinds + h.symbolCount);
+
+    // Everything a lookup indexes by is checked once here, so a damaged or hand-made index is
+    // refused rather than read out of bounds or searched out of order.
+    bool valid = offsets[0] == 0 && offsets[h.symbolCount] == h.nameBytes;
+    for(uint32_t id = 0; valid && id < h.symbolCount; id++){
+        valid = offsets[id] <= offsets[id + 1] && kinds[id] <= SYMBOL_LITERAL;
+    }
+    const uint32_t* p = tables;
+    for(uint32_t count : {h.allCount, h.labelCount, h.literalCount}){
+        valid = valid && valid_table(p, p + count, count, h.symbolCount);
+        p += 2 * count;
+    }
+    for(uint32_t i = 0; valid && i < h.directCount; i++){
+        valid = direct[i] < h.symbolCount || direct[i] == NO_SYMBOL;
+    }
+    if(!valid){
+        error = "corrupt symbol index";
+        return false;
+    }
+
+    p = tables;
+    for(auto [table, count] : {std::pair<SymbolTable*, uint32_t>{&m_all, h.allCount}, {&m_labels, h.labelCount},
+                               {&m_literals, h.literalCount}}){
+        table->assign(p, p + count, count, copy);
+        p += 2 * count;
+    }
+    m_directStart = h.directStart;
+    if(copy){
+        m_offsets.assign(offsets, offsets + h.symbolCount + 1);
+        m_kindValues.assign(kinds, kinds + h.symbolCount);
+        m_directIds.assign(direct, direct + h.directCount);
+        m_arena.assign(names, h.nameBytes);
+        publish();
+        return true;
+    }
+    m_mapped = true;
+    m_names = names;
+    m_nameOffsets = offsets;
+    m_kinds = ArrayView<uint8_t>{kinds, h.symbolCount};
+    m_direct = ArrayView<uint32_t>{direct, h.directCount};
+    return true;
+}
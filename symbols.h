@@ -0,0 +1,184 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "memstats.h"
+#include "view.h"
+
+const uint32_t NO_SYMBOL = 0xFFFFFFFF;         // Returned by every lookup that finds nothing.
+
+enum SymbolKind : uint8_t {
+    SYMBOL_LABEL,       // A label from the symbol table.
+    SYMBOL_LITERAL      // A literal from the literal table (=X'..' or =C'..').
+};
+
+/**
+* Symbols sorted by address in flat arrays. Addresses and ids are kept apart so a search only
+* touches the address array.
+*/
+struct SymbolTable {
+    ArrayView<uint32_t> addresses;              // Ascending, without duplicates.
+    ArrayView<uint32_t> ids;                    // Symbol id at each address.
+
+    void clear(){
+        m_addresses.clear();
+        m_ids.clear();
+        addresses = ArrayView<uint32_t>();
+        ids = ArrayView<uint32_t>();
+    }
+    void push_back(uint32_t addr, uint32_t id){ // Only seen once published.
+        m_addresses.push_back(addr);
+        m_ids.push_back(id);
+    }
+    void publish(){
+        addresses = ArrayView<uint32_t>{m_addresses.data(), m_addresses.size()};
+        ids = ArrayView<uint32_t>{m_ids.data(), m_ids.size()};
+    }
+    void assign(const uint32_t* addrs, const uint32_t* symbolIds, size_t count, bool copy);
+
+    size_t lower_bound(uint32_t addr) const;
+    uint32_t find(uint32_t addr) const;
+    size_t size() const {
+        return addresses.size();
+    }
+
+private:
+    MemVector<uint32_t, MEM_SYMBOLS> m_addresses;
+    MemVector<uint32_t, MEM_SYMBOLS> m_ids;
+};
+
+/**
+* Layout of a precompiled symbol index (.symidx), in host byte order. The header is followed by
+* symbolCount + 1 uint32_t offsets into the name arena, the address and id arrays of the combined,
+* label and literal tables (allCount, labelCount and literalCount of each), directCount uint32_t
+* ids of the direct table, symbolCount uint8_t kinds and nameBytes of names. The uint32_t arrays
+* come first and stay 4-byte aligned, so they are used in place when the file is mapped. The
+* source fields identify the symbol file it was built from.
+*/
+struct SymbolIndexHeader {
+    char magic[4];                  // "DSSY"
+    uint32_t version;
+    uint64_t sourceHash;            // hash_text() of the symbol file.
+    uint64_t sourceSize;
+    uint32_t symbolCount;
+    uint32_t nameBytes;
+    uint32_t allCount;
+    uint32_t labelCount;
+    uint32_t literalCount;
+    uint32_t directCount;
+    uint32_t directStart;
+};
+
+/**
+* Immutable-once-built index of the symbol file. Names are interned in one arena and addressed
+* by symbol id; labels and literals are held in separate tables, plus a combined table where the
+* symbol listed first wins an address. Dense programs also get a direct address-to-symbol table.
+* Clearing keeps every buffer, so an index reused for files of similar size stops allocating.
+* An index can also be loaded from a .symidx file, in place if the file outlives it.
+*/
+class SymbolIndex {
+public:
+    SymbolIndex(){
+        publish();
+    }
+    SymbolIndex(const SymbolIndex&) = delete;               // The views point into the index itself.
+    SymbolIndex& operator=(const SymbolIndex&) = delete;
+
+    void clear();
+    uint32_t add(std::string_view name, uint32_t addr, uint8_t kind);
+    void build(bool allowDirect = true);
+    bool load(std::string_view data, bool copy, std::string& error);
+
+    /**
+    * @return The id of the symbol at the address (label or literal), NO_SYMBOL if there is none.
+    */
+    uint32_t find(uint32_t addr) const {
+        if(!m_direct.empty()){
+            uint32_t offset = addr - m_directStart;
+            return offset < m_direct.size() ? m_direct[offset] : NO_SYMBOL;
+        }
+        return m_all.find(addr);
+    }
+
+    uint32_t find_label(uint32_t addr) const {
+        return m_labels.find(addr);
+    }
+
+    uint32_t find_literal(uint32_t addr) const {
+        return m_literals.find(addr);
+    }
+
+    std::string_view name(uint32_t id) const {
+        return std::string_view(m_names + m_nameOffsets[id], m_nameOffsets[id + 1] - m_nameOffsets[id]);
+    }
+
+    uint8_t kind(uint32_t id) const {
+        return m_kinds[id];
+    }
+
+    bool is_literal(uint32_t id) const {
+        return id != NO_SYMBOL && m_kinds[id] == SYMBOL_LITERAL;
+    }
+
+    uint32_t size() const {
+        return m_kinds.size();
+    }
+
+    const SymbolTable& all() const {
+        return m_all;
+    }
+    const SymbolTable& labels() const {
+        return m_labels;
+    }
+    const SymbolTable& literals() const {
+        return m_literals;
+    }
+    std::string_view arena() const {            // Every name back to back.
+        return std::string_view(m_names, m_nameOffsets[size()]);
+    }
+    ArrayView<uint32_t> name_offsets() const {  // Start of each name in the arena, plus the end of the last.
+        return ArrayView<uint32_t>{m_nameOffsets, size() + 1};
+    }
+    ArrayView<uint32_t> direct_table() const {
+        return m_direct;
+    }
+    uint32_t direct_start() const {
+        return m_directStart;
+    }
+    bool has_direct_table() const {
+        return !m_direct.empty();
+    }
+    bool is_mapped() const {                    // Whether the arrays are those of a loaded file.
+        return m_mapped;
+    }
+
+private:
+    void publish();
+
+    const char* m_names;                        // Views of the arrays below, or of a loaded file.
+    const uint32_t* m_nameOffsets;
+    ArrayView<uint8_t> m_kinds;
+    ArrayView<uint32_t> m_direct;               // Symbol id of every address from m_directStart, if dense.
+    uint32_t m_directStart = 0;
+    bool m_mapped = false;
+    SymbolTable m_all;
+    SymbolTable m_labels;
+    SymbolTable m_literals;
+
+    MemString<MEM_SYMBOLS> m_arena;
+    MemVector<uint32_t, MEM_SYMBOLS> m_offsets{0};
+    MemVector<uint8_t, MEM_SYMBOLS> m_kindValues;   // SymbolKind of each id.
+    MemVector<uint32_t, MEM_SYMBOLS> m_symAddrs;    // Address of each id, in file order.
+    MemVector<uint32_t, MEM_SYMBOLS> m_directIds;
+    MemVector<uint32_t, MEM_SYMBOLS> m_order;   // Scratch ids for build(), kept to reuse the buffer.
+};
+
+bool check_index_source(std::string_view index, const std::string& indexFile, std::string& error);
+void parse_symbols(std::string_view text, SymbolIndex& symbols);
+void add_symbols(std::string_view text, SymbolIndex& symbols, ArrayView<uint32_t> offsets);
+bool is_symbol_index(std::string_view data);
+
+#endif
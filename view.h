@@ -0,0 +1,40 @@
+#ifndef VIEW_H
+#define VIEW_H
+
+#include <cstddef>
+
+/**
+* Read-only view of an array, either one its owner built itself or one in a mapped file.
+*/
+template<class T>
+struct ArrayView {
+    const T* ptr = nullptr;
+    size_t count = 0;
+
+    const T& operator[](size_t i) const {
+        return ptr[i];
+    }
+    const T* data() const {
+        return ptr;
+    }
+    size_t size() const {
+        return count;
+    }
+    bool empty() const {
+        return count == 0;
+    }
+    const T* begin() const {
+        return ptr;
+    }
+    const T* end() const {
+        return ptr + count;
+    }
+    const T& front() const {
+        return ptr[0];
+    }
+    const T& back() const {
+        return ptr[count - 1];
+    }
+};
+
+#endif
@@ -0,0 +1,480 @@
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <map>
+#include <memory>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "watch.h"
+#include "batch.h"
+#include "output.h"
+
+const int WATCH_SETTLE_MS = 10;                     // Events closer together than this are one change.
+const uint32_t WATCH_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF |
+                              IN_MOVE_SELF;
+const size_t NO_OFFSET = size_t(-1);
+
+enum WatchState {
+    WATCH_RUNNING,
+    WATCH_GONE,         // The directory was removed or moved away.
+    WATCH_FAILED        // The inotify descriptor could not be read.
+};
+
+/**
+* A listing file as it was last written, kept rendered along with where each line ends, so that
+* after an update only the bytes that changed are written again. Once a line comes out longer or
+* shorter, everything after it is written again, as it has moved.
+*/
+class ListingFile {
+public:
+    ListingFile(const std::string& path, uint8_t format) : m_path(path), m_format(format) {}
+
+    bool write(const Disassembler& disassembler, std::string& error);
+    bool patch(const Disassembler& disassembler, const std::vector<ListingEdit>& edits, size_t& written,
+               std::string& error);
+
+    size_t size() const {
+        return m_text.size();
+    }
+
+private:
+    /**
+    * A run of bytes to write again.
+    */
+    struct ByteRange {
+        size_t first;
+        size_t last;
+    };
+
+    bool write_file(int fd, const MemVector<char, MEM_OUTPUT>& text, size_t& written);
+    size_t line_start(size_t line) const {
+        return line == 0 ? m_linesStart : m_lineEnds[line - 1];
+    }
+
+    std::string m_path;
+    uint8_t m_format;
+    MemVector<char, MEM_OUTPUT> m_text;             // The whole file: what begin(), the lines and end() render.
+    MemVector<size_t, MEM_OUTPUT> m_lineEnds;       // Offset just past each line.
+    size_t m_linesStart = 0;                        // Where the first line starts.
+    MemVector<char, MEM_OUTPUT> m_next;             // The same after an update, while it is being patched.
+    MemVector<size_t, MEM_OUTPUT> m_nextEnds;
+    std::vector<ByteRange> m_changed;               // Bytes to write again, in order.
+    size_t m_moved = NO_OFFSET;                     // Where the bytes stop lining up with the file's.
+    struct stat m_written;                          // The file as last written, to tell if anything else has.
+    bool m_known = false;                           // Whether it is.
+};
+
+
+/**
+* Renders the whole listing and writes it over the file.
+* @param disassembler: Holds the listing, after decode() or update().
+* @param error: Receives a description of the failure, if any.
+* @return True if the file was written.
+*/
+bool ListingFile::write(const Disassembler& disassembler, std::string& error){
+    const Listing& listing = disassembler.listing();
+    RenderContext ctx{&disassembler.image(), &disassembler.symbols()};
+    std::unique_ptr<ListingFormatter> formatter(make_formatter(m_format, ctx));
+    m_text.clear();
+    m_lineEnds.clear();
+    m_lineEnds.reserve(listing.size());
+    {
+        OutputBuffer out(&m_text);
+        formatter->begin(listing, out);
+        m_linesStart = out.position();
+        for(const ListingLine& line : listing){
+            formatter->line(line, out);
+            m_lineEnds.push_back(out.position());
+        }
+        formatter->end(listing, out);
+        out.flush();
+    }
+
+    m_known = false;
+    OutputOptions options;
+    options.path = m_path;
+    std::string path;
+    int fd = open_output(options, path, error);
+    if(fd < 0){
+        return false;
+    }
+    m_changed.clear();
+    m_moved = 0;
+    size_t written;
+    bool ok = write_file(fd, m_text, written);
+    return close_output(fd, path, ok, error);
+}
+
+
+/**
+* Brings the file up to date with the listing after update(). The lines that changed are rendered
+* again, each run starting from the formatter's state at its first line, and the rest is copied
+* from the file as last written. Only the bytes that differ are written, unless the file has been
+* changed by something else since, in which case it is written whole.
+* @param disassembler: Holds the listing, after update().
+* @param edits: The runs of lines update() changed.
+* @param written: Receives the bytes written.
+* @param error: Receives a description of the failure, if any.
+* @return True if the file is up to date.
+*/
+bool ListingFile::patch(const Disassembler& disassembler, const std::vector<ListingEdit>& edits, size_t& written,
+                        std::string& error){
+    struct stat now;
+    if(!m_known || ::stat(m_path.c_str(), &now) != 0 || now.st_ino != m_written.st_ino ||
+       now.st_size != m_written.st_size || now.st_mtim.tv_sec != m_written.st_mtim.tv_sec ||
+       now.st_mtim.tv_nsec != m_written.st_mtim.tv_nsec){
+        written = 0;
+        if(!write(disassembler, error)){
+            return false;
+        }
+        written = m_text.size();
+        return true;
+    }
+
+    const Listing& listing = disassembler.listing();
+    RenderContext ctx{&disassembler.image(), &disassembler.symbols()};
+    std::unique_ptr<ListingFormatter> formatter(make_formatter(m_format, ctx));
+    RenderPlan plan = plan_render(listing);
+    m_next.clear();
+    m_nextEnds.clear();
+    m_nextEnds.reserve(listing.size());
+    m_changed.clear();
+    m_moved = NO_OFFSET;
+    auto add_change = [&](size_t first, size_t last){
+        if(!m_changed.empty() && m_changed.back().last >= first){
+            m_changed.back().last = std::max(m_changed.back().last, last);
+        }
+        else if(first < last){
+            m_changed.push_back(ByteRange{first, last});
+        }
+    };
+    size_t linesStart;
+    {
+        OutputBuffer out(&m_next);
+        formatter->begin(listing, out);
+        out.flush();
+        linesStart = out.position();
+        if(linesStart != m_linesStart){
+            m_moved = 0;
+        }
+        else if(std::memcmp(m_next.data(), m_text.data(), linesStart) != 0){
+            add_change(0, linesStart);
+        }
+
+        size_t oldLine = 0;
+        auto copy_lines = [&](size_t last){                         // The old lines up to last, unchanged.
+            size_t first = line_start(oldLine);
+            size_t at = out.position();
+            out.append(m_text.data() + first, line_start(last) - first);
+            for(; oldLine < last; oldLine++){
+                m_nextEnds.push_back(m_lineEnds[oldLine] - first + at);
+            }
+        };
+        for(size_t e = 0; e < edits.size(); e++){
+            const ListingEdit& edit = edits[e];
+            copy_lines(edit.oldFirst);
+            size_t start = out.position();
+            formatter->resume(plan, edit.newFirst);
+            for(size_t i = edit.newFirst; i < edit.newLast; i++){
+                formatter->line(listing[i], out);
+                m_nextEnds.push_back(out.position());
+            }
+            oldLine = edit.oldLast;
+            size_t next = e + 1 < edits.size() ? edits[e + 1].newFirst : listing.size();
+            for(size_t i = edit.newLast; i < next; i++){            // The lines after it may render differently
+                size_t first = out.position();                      // from the formatter's state, until one
+                formatter->line(listing[i], out);                   // comes out as before.
+                m_nextEnds.push_back(out.position());
+                out.flush();
+                size_t oldFirst = line_start(oldLine++);
+                size_t length = out.position() - first;
+                if(length == m_lineEnds[oldLine - 1] - oldFirst &&
+                   std::memcmp(m_next.data() + first, m_text.data() + oldFirst, length) == 0){
+                    break;
+                }
+            }
+            if(m_moved == NO_OFFSET && out.position() != line_start(oldLine)){
+                m_moved = start;
+            }
+            add_change(start, out.position());
+        }
+        copy_lines(m_lineEnds.size());
+        size_t linesEnd = out.position();
+        formatter->end(listing, out);
+        out.flush();
+        size_t oldEnd = line_start(m_lineEnds.size());
+        if(m_moved == NO_OFFSET && m_next.size() - linesEnd != m_text.size() - oldEnd){
+            m_moved = linesEnd;
+        }
+        else if(m_moved == NO_OFFSET && std::memcmp(m_next.data() + linesEnd, m_text.data() + oldEnd,
+                                                    m_next.size() - linesEnd) != 0){
+            add_change(linesEnd, m_next.size());
+        }
+    }
+
+    int fd = ::open(m_path.c_str(), O_WRONLY);
+    bool ok = fd >= 0 && write_file(fd, m_next, written);
+    if(ok && m_next.size() < m_text.size() && ::ftruncate(fd, m_next.size()) != 0){
+        ok = false;
+    }
+    if(fd < 0 || (::close(fd) != 0 && ok)){
+        ok = false;
+    }
+    if(!ok){
+        m_known = false;
+        error = "cannot write " + m_path + ": " + std::strerror(errno);
+        return false;
+    }
+    std::swap(m_text, m_next);
+    std::swap(m_lineEnds, m_nextEnds);
+    m_linesStart = linesStart;
+    return true;
+}
+
+
+/**
+* Writes the changed ranges of the listing in place, and everything from where its bytes moved on.
+* @param fd: The listing file, open for writing.
+* @param text: The whole listing, as rendered.
+* @param written: Receives the bytes written.
+* @return True if everything was written.
+*/
+bool ListingFile::write_file(int fd, const MemVector<char, MEM_OUTPUT>& text, size_t& written){
+    written = 0;
+    auto write_at = [&](size_t first, size_t last){
+        while(first < last){
+            ssize_t count = ::pwrite(fd, text.data() + first, last - first, first);
+            if(count < 0){
+                if(errno == EINTR){
+                    continue;
+                }
+                return false;
+            }
+            first += count;
+            written += count;
+        }
+        return true;
+    };
+    size_t moved = std::min(m_moved, text.size());
+    for(const ByteRange& range : m_changed){
+        if(range.first < moved && !write_at(range.first, std::min(range.last, moved))){
+            return false;
+        }
+    }
+    if(!write_at(moved, text.size()) || ::fstat(fd, &m_written) != 0){
+        return false;
+    }
+    m_known = true;
+    return true;
+}
+
+
+/**
+* An object file being watched, with what its listing was last decoded and rendered from.
+*/
+struct WatchedProgram {
+    std::string objFile;
+    std::string symFile;
+    Disassembler disassembler;
+    ListingFile listing;
+    bool decoded = false;                           // Whether the disassembler holds its listing, for update().
+
+    WatchedProgram(const std::string& obj, const std::string& sym, uint8_t format, int threads)
+        : objFile(obj), symFile(sym), disassembler(threads), listing(batch_output_path(obj, format), format) {}
+};
+
+
+/**
+* Disassembles a program again after its files changed: an object file alone through update(),
+* which decodes just the text records that changed, and anything else in full, as is a program of
+* several control sections, whose sections may all have moved. Prints a line on what was done, or
+* the error.
+* @param program: The program.
+* @param full: Whether the symbol file changed too, or the program has not been decoded yet.
+* @param printStats: Whether to print the figures of the update, on standard error.
+* @param statsJson: Whether to print them as JSON.
+*/
+static void refresh(WatchedProgram& program, bool full, bool printStats, bool statsJson){
+    auto started = std::chrono::steady_clock::now();
+    InputFile obj;
+    InputFile sym;
+    std::string error;
+    std::vector<ListingEdit> edits;
+    size_t lines = 0;
+    size_t written = 0;
+    bool ok = obj.open(program.objFile, error, false);                  // Not mapped: the assembler may be
+    if(ok && (full || !program.decoded || program.disassembler.is_linked() || has_control_sections(obj.text()))){
+        ok = sym.open(program.symFile, error, false) &&                 // rewriting them in place.
+             program.disassembler.decode(obj.text(), sym.text(), error);
+        program.decoded = ok;
+        ok = ok && program.listing.write(program.disassembler, error);
+        lines = program.disassembler.listing().size();
+        written = program.listing.size();
+    }
+    else if(ok){
+        ok = program.disassembler.update(obj.text(), edits, error);
+        ok = ok && (edits.empty() || program.listing.patch(program.disassembler, edits, written, error));
+        for(const ListingEdit& edit : edits){
+            lines += edit.newLast - edit.newFirst;
+        }
+    }
+    if(!ok){
+        std::cerr << "ERROR: " << program.objFile << ": " << error << std::endl;
+        return;
+    }
+    if(!program.disassembler.warning().empty()){
+        std::cerr << "WARNING: " << program.objFile << ": " << program.disassembler.warning() << "." << std::endl;
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - started;
+    std::cout << program.objFile << ": " << lines << " lines changed, " << written << " bytes written in "
+              << std::fixed << std::setprecision(1) << elapsed.count() << " ms" << std::endl;
+    if(printStats){
+        print_stats(std::cerr, program.disassembler.stats(), statsJson);
+    }
+}
+
+
+/**
+* @param name: A file name.
+* @param extension: An extension, with the dot.
+* @param stem: Receives the name without the extension, if it has it.
+* @return True if the name ends with the extension.
+*/
+static bool split_extension(const std::string& name, const char* extension, std::string& stem){
+    size_t length = std::strlen(extension);
+    if(name.size() <= length || name.compare(name.size() - length, length, extension) != 0){
+        return false;
+    }
+    stem = name.substr(0, name.size() - length);
+    return true;
+}
+
+
+/**
+* Notes the programs a batch of inotify events touched.
+* @param fd: The inotify descriptor.
+* @param changed: Receives the stem of each program whose files changed, and whether its symbol
+*                 file did.
+* @param rescan: Set if events were lost, so every program has to be looked at.
+* @return The WatchState: WATCH_GONE if the directory itself went away, WATCH_FAILED (with the
+*         reason printed) if the events cannot be read.
+*/
+static int read_events(int fd, std::map<std::string, bool>& changed, bool& rescan){
+    alignas(struct inotify_event) char buffer[16384];
+    ssize_t count = ::read(fd, buffer, sizeof(buffer));
+    if(count < 0){
+        if(errno == EINTR || errno == EAGAIN){
+            return WATCH_RUNNING;
+        }
+        std::cerr << "ERROR: cannot read the events of the watched directory: " << std::strerror(errno) << std::endl;
+        return WATCH_FAILED;
+    }
+    for(char* next = buffer; next < buffer + count; ){
+        const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(next);
+        next += sizeof(struct inotify_event) + event->len;
+        if(event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)){
+            return WATCH_GONE;
+        }
+        if(event->mask & IN_Q_OVERFLOW){
+            rescan = true;
+        }
+        std::string stem;
+        if(event->len == 0){
+            continue;
+        }
+        if(split_extension(event->name, ".obj", stem)){
+            changed.emplace(stem, false);
+        }
+        else if(split_extension(event->name, ".sym", stem)){
+            changed[stem] = true;
+        }
+    }
+    return WATCH_RUNNING;
+}
+
+
+/**
+* Lists every program in the directory: each a.obj with an a.sym next to it.
+* @param dir: The directory.
+* @param changed: Receives the stem of each, to be decoded in full.
+*/
+static void scan_directory(const std::string& dir, std::map<std::string, bool>& changed){
+    DIR* entries = ::opendir(dir.c_str());
+    if(!entries){
+        return;
+    }
+    while(struct dirent* entry = ::readdir(entries)){
+        std::string stem;
+        if(split_extension(entry->d_name, ".obj", stem)){
+            changed[stem] = true;
+        }
+    }
+    ::closedir(entries);
+}
+
+
+/**
+* Keeps the listings of every program in a directory up to date: ./dissem --watch DIR. Each a.obj
+* with an a.sym is disassembled into a.FORMAT, and then watched through inotify. The programs stay
+* decoded in memory, so when an object file is written again only the text records whose object
+* code changed are decoded, and only the bytes of the listing that changed are written (see
+* Disassembler::update() and ListingFile). A new symbol file means a full decode of its program.
+* Runs until the directory goes away, or its events cannot be read.
+* @param dir: The directory to watch.
+* @param output: The format of the listings; each goes next to its object file.
+* @param threads: Threads decoding a large program in full; 0 uses one per hardware thread.
+* @param printStats: Whether to print the figures of every update, on standard error.
+* @param statsJson: Whether to print them as JSON.
+* @return False if the directory cannot be watched, or stops being readable.
+*/
+bool run_watch(const std::string& dir, const OutputOptions& output, int threads, bool printStats, bool statsJson){
+    int fd = ::inotify_init1(IN_CLOEXEC);
+    if(fd < 0 || ::inotify_add_watch(fd, dir.c_str(), WATCH_EVENTS | IN_ONLYDIR) < 0){
+        std::cerr << "ERROR: cannot watch " << dir << ": " << std::strerror(errno) << std::endl;
+        if(fd >= 0){
+            ::close(fd);
+        }
+        return false;
+    }
+
+    std::map<std::string, std::unique_ptr<WatchedProgram>> programs;
+    std::map<std::string, bool> changed;
+    bool rescan = true;
+    int state = WATCH_RUNNING;
+    while(state == WATCH_RUNNING){
+        if(rescan){
+            scan_directory(dir, changed);
+            rescan = false;
+        }
+        for(const auto& [stem, symbols] : changed){
+            std::string objFile = dir + "/" + stem + ".obj";
+            std::string symFile = dir + "/" + stem + ".sym";
+            if(::access(objFile.c_str(), R_OK) != 0 || ::access(symFile.c_str(), R_OK) != 0){
+                programs.erase(stem);                               // Gone, or waiting for its symbols.
+                continue;
+            }
+            std::unique_ptr<WatchedProgram>& program = programs[stem];
+            if(!program){
+                program.reset(new WatchedProgram(objFile, symFile, output.format, threads));
+            }
+            refresh(*program, symbols, printStats, statsJson);
+        }
+        changed.clear();
+
+        state = read_events(fd, changed, rescan);                   // Waits for the next change, and then
+        struct pollfd more{fd, POLLIN, 0};                          // for the files written with it.
+        while(state == WATCH_RUNNING && ::poll(&more, 1, WATCH_SETTLE_MS) > 0){
+            state = read_events(fd, changed, rescan);
+        }
+    }
+    ::close(fd);
+    if(state == WATCH_FAILED){
+        return false;
+    }
+    std::cout << dir << " is gone; no longer watching." << std::endl;
+    return true;
+}
@@ -0,0 +1,10 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <string>
+
+struct OutputOptions;
+
+bool run_watch(const std::string& dir, const OutputOptions& output, int threads, bool printStats, bool statsJson);
+
+#endif
@@ -0,0 +1,483 @@
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include "xref.h"
+#include "output.h"
+
+/**
+* Finds the references of one kind to a target address in CSR arrays.
+* @param targets: The target addresses, ascending.
+* @param count: The number of targets.
+* @param offsets: The start of each target's group of each kind in sources, plus the end.
+* @param sources: The referencing instruction addresses.
+* @param target: The address referred to.
+* @param kind: The XrefKind.
+* @param last: Receives the end of the references.
+* @return The first reference; equal to last if there are none.
+*/
+static const uint32_t* find_references(const uint32_t* targets, size_t count, const uint32_t* offsets,
+                                       const uint32_t* sources, uint32_t target, int kind, const uint32_t*& last){
+    const uint32_t* found = std::lower_bound(targets, targets + count, target);
+    if(found == targets + count || *found != target){
+        last = sources;
+        return sources;
+    }
+    size_t group = (found - targets) * XREF_KINDS + kind;
+    last = sources + offsets[group + 1];
+    return sources + offsets[group];
+}
+
+
+/**
+* @param line: A listing line.
+* @return The XrefKind of the line's reference to its target address, or XREF_KINDS if it does
+*         not refer to a known address.
+*/
+int xref_kind(const ListingLine& line){
+    if(line.kind != LINE_INSTRUCTION || g_operandKinds[line.mnemonic] != OPERAND_MEMORY){
+        return XREF_KINDS;
+    }
+    OperandMode mode = operand_mode(line.flags);
+    if(has_constant_operand(line.flags) && (mode == OP_IMMEDIATE || (line.flags & FLAG_X))){
+        return XREF_KINDS;                                              // A number, or an address plus X.
+    }
+    if(mode == OP_IMMEDIATE){
+        return XREF_IMMEDIATE;
+    }
+    if(mode == OP_INDIRECT){                                            // The operand is only read, to find
+        return XREF_READ;                                               // the address that is really used.
+    }
+    switch(line.mnemonic){
+    case MN_J:
+    case MN_JEQ:
+    case MN_JGT:
+    case MN_JLT:
+    case MN_JSUB:
+        return XREF_JUMP;
+    case MN_STA:
+    case MN_STB:
+    case MN_STCH:
+    case MN_STF:
+    case MN_STI:
+    case MN_STL:
+    case MN_STS:
+    case MN_STSW:
+    case MN_STT:
+    case MN_STX:
+        return XREF_WRITE;
+    default:
+        return XREF_READ;
+    }
+}
+
+
+/**
+* Empties the index but keeps its buffers for the next program.
+*/
+void XrefIndex::clear(){
+    m_targets.clear();
+    m_offsets.clear();
+    m_sources.clear();
+}
+
+
+/**
+* Indexes every reference in a decoded listing. Target addresses that depend on the B and X
+* registers must have been resolved.
+* @param listing: The listing.
+*/
+void XrefIndex::build(const Listing& listing){
+    clear();
+    m_keys.clear();
+    m_keys.reserve(listing.size());
+    for(const ListingLine& line : listing){                             // Target, kind and source in one key, so
+        int kind = xref_kind(line);                                     // a single sort groups them all.
+        if(kind != XREF_KINDS){
+            m_keys.push_back(uint64_t(line.value) << 32 | uint64_t(kind) << 30 | line.address);
+        }
+    }
+    sort_keys();
+
+    for(uint64_t key : m_keys){
+        uint32_t target = key >> 32;
+        if(m_targets.empty() || m_targets.back() != target){
+            m_targets.push_back(target);
+        }
+    }
+    m_offsets.assign(m_targets.size() * XREF_KINDS + 1, 0);
+    size_t t = 0;
+    for(uint64_t key : m_keys){                                         // Count each group, then turn the counts
+        while(m_targets[t] != key >> 32){                               // into offsets.
+            t++;
+        }
+        m_offsets[t * XREF_KINDS + ((key >> 30) & 0x03) + 1]++;
+        m_sources.push_back(key & 0x3FFFFFFF);
+    }
+    for(size_t i = 1; i < m_offsets.size(); i++){
+        m_offsets[i] += m_offsets[i - 1];
+    }
+}
+
+
+/**
+* Sorts m_keys with an LSD radix sort on bytes. Bytes every key shares (such as the high byte of
+* 24-bit addresses) are skipped. The listing is usually in address order already, and then the
+* sort being stable means the source bytes need no passes either.
+*/
+void XrefIndex::sort_keys(){
+    const uint32_t RADIX = 256;
+    uint64_t anyBits = 0;
+    uint64_t allBits = ~uint64_t(0);
+    bool inOrder = true;
+    uint32_t prevSource = 0;
+    for(uint64_t key : m_keys){
+        anyBits |= key;
+        allBits &= key;
+        inOrder = inOrder && (key & 0x3FFFFFFF) >= prevSource;
+        prevSource = key & 0x3FFFFFFF;
+    }
+    int digits[8];
+    int numDigits = 0;
+    for(int d = inOrder ? 3 : 0; d < 8; d++){                           // Byte 3 holds the kind.
+        if(((anyBits ^ allBits) >> (8 * d)) & 0xFF){
+            digits[numDigits++] = d;
+        }
+    }
+
+    m_counts.assign(numDigits * RADIX, 0);
+    for(uint64_t key : m_keys){                                         // Every histogram in one pass.
+        for(int i = 0; i < numDigits; i++){
+            m_counts[i * RADIX + ((key >> (8 * digits[i])) & 0xFF)]++;
+        }
+    }
+    m_sorted.resize(m_keys.size());
+    for(int i = 0; i < numDigits; i++){
+        uint32_t* counts = m_counts.data() + i * RADIX;
+        uint32_t offset = 0;
+        for(uint32_t b = 0; b < RADIX; b++){
+            uint32_t count = counts[b];
+            counts[b] = offset;
+            offset += count;
+        }
+        int shift = 8 * digits[i];
+        for(uint64_t key : m_keys){
+            m_sorted[counts[(key >> shift) & 0xFF]++] = key;
+        }
+        m_keys.swap(m_sorted);
+    }
+}
+
+
+/**
+* @param target: An address.
+* @param kind: The XrefKind.
+* @param last: Receives the end of the references.
+* @return The first instruction address that refers to the target in that way; equal to last if
+*         there are none.
+*/
+const uint32_t* XrefIndex::find(uint32_t target, int kind, const uint32_t*& last) const {
+    return find_references(m_targets.data(), m_targets.size(), m_offsets.data(), m_sources.data(), target, kind, last);
+}
+
+
+template<class Array>
+static void append_array(OutputBuffer& out, const Array& values){
+    out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(values[0]));
+}
+
+
+/**
+* Writes the index as a cross-reference file (see XrefHeader), with the line numbers of the
+* listing and the symbol names queries need.
+* @param path: The file to write, or "-" for stdout.
+* @param listing: The listing the index was built from.
+* @param symbols: The symbols of the program.
+* @param program: The program name.
+* @param error: Receives a description of the failure, if any.
+* @return True if the whole file was written.
+*/
+bool XrefIndex::write(const std::string& path, const Listing& listing, const SymbolIndex& symbols,
+                      const std::string& program, std::string& error) const {
+    MemVector<XrefLine, MEM_XREF> lines;
+    for(size_t i = 0; i < listing.size(); i++){
+        const ListingLine& line = listing[i];
+        if(line.kind != LINE_BASE && line.kind != LINE_LTORG && line.kind != LINE_END){
+            lines.push_back(XrefLine{line.address, uint32_t(i + 1), line.kind, line.mnemonic, line.length, 0});
+        }
+    }
+    std::sort(lines.begin(), lines.end(), [](const XrefLine& a, const XrefLine& b){
+        return a.address != b.address ? a.address < b.address : a.line < b.line;
+    });
+
+    const SymbolTable& table = symbols.all();
+    MemVector<uint32_t, MEM_XREF> nameOffsets{0};
+    MemVector<uint32_t, MEM_XREF> byName(table.size());
+    for(size_t i = 0; i < table.size(); i++){
+        nameOffsets.push_back(nameOffsets.back() + symbols.name(table.ids[i]).size());
+        byName[i] = i;
+    }
+    std::sort(byName.begin(), byName.end(), [&](uint32_t a, uint32_t b){
+        std::string_view nameA = symbols.name(table.ids[a]);
+        std::string_view nameB = symbols.name(table.ids[b]);
+        return nameA != nameB ? nameA < nameB : a < b;
+    });
+
+    XrefHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "DSXR", 4);
+    header.version = 1;
+    header.targetCount = m_targets.size();
+    header.refCount = m_sources.size();
+    header.lineCount = lines.size();
+    header.symbolCount = table.size();
+    header.nameBytes = nameOffsets.back();
+    std::memcpy(header.program, program.data(), std::min<size_t>(program.size(), 8));
+
+    OutputOptions options;
+    options.path = path;
+    std::string opened;
+    int fd = open_output(options, opened, error);
+    if(fd < 0){
+        return false;
+    }
+    bool ok;
+    {
+        OutputBuffer out(fd);
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        append_array(out, m_targets);
+        append_array(out, m_offsets.empty() ? MemVector<uint32_t, MEM_XREF>{0} : m_offsets);
+        append_array(out, m_sources);
+        append_array(out, lines);
+        append_array(out, table.addresses);
+        append_array(out, byName);
+        append_array(out, nameOffsets);
+        for(uint32_t id : table.ids){
+            out.append(symbols.name(id));
+        }
+        ok = out.flush();
+    }
+    return close_output(fd, opened, ok, error);
+}
+
+
+/**
+* Opens a cross-reference file and checks that its arrays fit in it.
+* @param path: The file written by XrefIndex::write(), or "-" for stdin.
+* @param error: Receives a description of the failure, if any.
+* @return True if the file can be queried.
+*/
+bool XrefFile::open(const std::string& path, std::string& error){
+    if(!m_input.open(path, error)){
+        return false;
+    }
+    std::string_view data = m_input.text();
+    const XrefHeader* header = reinterpret_cast<const XrefHeader*>(data.data());
+    if(data.size() < sizeof(XrefHeader) || std::memcmp(header->magic, "DSXR", 4) != 0 || header->version != 1){
+        error = path + ": not a cross-reference file";
+        return false;
+    }
+    uint64_t words = uint64_t(header->targetCount) * (XREF_KINDS + 1) + 1 + header->refCount +
+                     uint64_t(header->lineCount) * sizeof(XrefLine) / 4 + uint64_t(header->symbolCount) * 3 + 1;
+    if(sizeof(XrefHeader) + words * 4 + header->nameBytes > data.size()){
+        error = path + ": truncated cross-reference file";
+        return false;
+    }
+
+    const uint32_t* p = reinterpret_cast<const uint32_t*>(header + 1);
+    m_targets = p;
+    m_offsets = m_targets + header->targetCount;
+    m_sources = m_offsets + header->targetCount * XREF_KINDS + 1;
+    m_lines = reinterpret_cast<const XrefLine*>(m_sources + header->refCount);
+    m_symAddrs = reinterpret_cast<const uint32_t*>(m_lines + header->lineCount);
+    m_byName = m_symAddrs + header->symbolCount;
+    m_nameOffsets = m_byName + header->symbolCount;
+    m_names = reinterpret_cast<const char*>(m_nameOffsets + header->symbolCount + 1);
+    if(m_offsets[header->targetCount * XREF_KINDS] != header->refCount ||
+       m_nameOffsets[header->symbolCount] != header->nameBytes){
+        error = path + ": corrupt cross-reference file";
+        return false;
+    }
+    m_header = header;
+    return true;
+}
+
+
+/**
+* @return The program name from the header record.
+*/
+std::string_view XrefFile::program() const {
+    return std::string_view(m_header->program, strnlen(m_header->program, sizeof(m_header->program)));
+}
+
+
+std::string_view XrefFile::name(uint32_t index) const {
+    return std::string_view(m_names + m_nameOffsets[index], m_nameOffsets[index + 1] - m_nameOffsets[index]);
+}
+
+
+/**
+* Turns a query's target into an address.
+* @param target: A symbol name, or else a hexadecimal address with or without 0x.
+* @param address: Receives the address.
+* @return False if the target is neither.
+*/
+bool XrefFile::resolve(std::string_view target, uint32_t& address) const {
+    const uint32_t* byName = m_byName;
+    const uint32_t* found = std::lower_bound(byName, byName + m_header->symbolCount, target,
+                                             [&](uint32_t index, std::string_view key){
+        return name(index) < key;
+    });
+    if(found != byName + m_header->symbolCount && name(*found) == target){
+        address = m_symAddrs[*found];
+        return true;
+    }
+
+    if(target.size() > 2 && target[0] == '0' && (target[1] == 'x' || target[1] == 'X')){
+        target.remove_prefix(2);
+    }
+    if(target.empty() || target.size() > 8){
+        return false;
+    }
+    address = 0;
+    for(char c : target){
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'A' && c <= 'F' ? c - 'A' + 10 : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if(digit < 0){
+            return false;
+        }
+        address = address << 4 | digit;
+    }
+    return true;
+}
+
+
+/**
+* @param target: An address.
+* @param kind: The XrefKind.
+* @param last: Receives the end of the references.
+* @return The first instruction address that refers to the target in that way; equal to last if
+*         there are none.
+*/
+const uint32_t* XrefFile::find(uint32_t target, int kind, const uint32_t*& last) const {
+    return find_references(m_targets, m_header->targetCount, m_offsets, m_sources, target, kind, last);
+}
+
+
+/**
+* @param address: An address in the program.
+* @return The last listing line at or before the address, or nullptr if there is none.
+*/
+const XrefLine* XrefFile::line_at(uint32_t address) const {
+    const XrefLine* end = m_lines + m_header->lineCount;
+    const XrefLine* found = std::upper_bound(m_lines, end, address, [](uint32_t addr, const XrefLine& line){
+        return addr < line.address;
+    });
+    return found == m_lines ? nullptr : found - 1;
+}
+
+
+/**
+* @param address: An address in the program.
+* @return The address as the nearest symbol at or before it plus an offset, such as LOOP+6.
+*/
+std::string XrefFile::location(uint32_t address) const {
+    const uint32_t* end = m_symAddrs + m_header->symbolCount;
+    const uint32_t* found = std::upper_bound(m_symAddrs, end, address);
+    std::ostringstream text;
+    text << std::uppercase << std::hex;
+    if(found == m_symAddrs){
+        text << address;
+        return text.str();
+    }
+    text << name(found - 1 - m_symAddrs);
+    if(address != *(found - 1)){
+        text << '+' << address - *(found - 1);
+    }
+    return text.str();
+}
+
+
+static const char* const g_xrefKindNames[XREF_KINDS] = {
+    "read", "write", "jump", "immediate"
+};
+
+
+/**
+* Prints one listing line of a query's answer: its line number, address, operation and where
+* it is, e.g. "12 00001E +JSUB RDREC+3".
+*/
+static void print_line(std::ostream& out, const XrefFile& file, const XrefLine& line){
+    out << std::dec << line.line << ' ' << std::hex << std::setw(6) << line.address << ' ';
+    switch(line.kind){
+    case LINE_START:
+        out << "START";
+        break;
+    case LINE_CSECT:
+        out << "CSECT";
+        break;
+    case LINE_INSTRUCTION:
+        out << (line.length == 4 ? "+" : "") << g_mnemonicNames[line.mnemonic];
+        break;
+    case LINE_LITERAL:
+        out << '*';
+        break;
+    default:
+        out << (line.kind == LINE_RESW ? "RESW" : "RESB");
+        break;
+    }
+    out << ' ' << file.location(line.address) << '\n';
+}
+
+
+/**
+* Answers one query about a cross-reference file:
+*   FILE xref TARGET     every reference to TARGET, as "KIND LINE ADDRESS OPERATION LOCATION";
+*   FILE callers TARGET  the jumps to TARGET only;
+*   FILE line ADDRESS    the listing line that holds ADDRESS.
+* TARGET and ADDRESS are symbol names or hexadecimal addresses.
+* @param args: The arguments after "query".
+* @param out: Where the answer goes.
+* @param error: Receives a description of the failure, if any.
+* @return True if the query was answered, even if nothing matched.
+*/
+bool run_query(const std::vector<std::string>& args, std::ostream& out, std::string& error){
+    if(args.size() != 3 || (args[1] != "xref" && args[1] != "callers" && args[1] != "line")){
+        error = "usage: dissem query FILE.xref (xref | callers | line) TARGET";
+        return false;
+    }
+    XrefFile file;
+    if(!file.open(args[0], error)){
+        return false;
+    }
+    uint32_t address;
+    if(!file.resolve(args[2], address)){
+        error = "no symbol or address " + args[2] + " in " + std::string(file.program());
+        return false;
+    }
+
+    std::ios_base::fmtflags flags = out.flags();
+    char fill = out.fill('0');
+    out << std::uppercase;
+    if(args[1] == "line"){
+        const XrefLine* line = file.line_at(address);
+        if(line){
+            print_line(out, file, *line);
+        }
+    }
+    else{
+        for(int kind = args[1] == "callers" ? XREF_JUMP : XREF_READ; kind < XREF_KINDS; kind++){
+            const uint32_t* last;
+            for(const uint32_t* source = file.find(address, kind, last); source != last; source++){
+                out << g_xrefKindNames[kind] << ' ';
+                print_line(out, file, *file.line_at(*source));
+            }
+            if(args[1] == "callers"){
+                break;
+            }
+        }
+    }
+    out.flags(flags);
+    out.fill(fill);
+    out.flush();
+    return true;
+}
@@ -0,0 +1,120 @@
+#ifndef XREF_H
+#define XREF_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "input.h"
+#include "listing.h"
+#include "symbols.h"
+#include "memstats.h"
+
+/**
+* How an instruction refers to its target address.
+*/
+enum XrefKind : uint8_t {
+    XREF_READ,          // Loads, arithmetic, comparisons and I/O, and every indirect (@) operand.
+    XREF_WRITE,         // Stores.
+    XREF_JUMP,          // J, JEQ, JGT, JLT and JSUB.
+    XREF_IMMEDIATE,     // #LABEL: the address itself is the operand.
+    XREF_KINDS
+};
+
+/**
+* Layout of a cross-reference file, in host byte order. The header is followed by
+*   targetCount uint32_t target addresses, ascending;
+*   targetCount * XREF_KINDS + 1 uint32_t offsets: the references of kind k to target t are
+*     sources[offsets[t * XREF_KINDS + k], offsets[t * XREF_KINDS + k + 1]);
+*   refCount uint32_t sources: addresses of the referencing instructions, ascending per group;
+*   lineCount XrefLine, the listing lines that have an address, ordered by address;
+*   symbolCount uint32_t symbol addresses, ascending;
+*   symbolCount uint32_t indices into them, ordered by name;
+*   symbolCount + 1 uint32_t offsets into the name arena, and nameBytes of symbol names.
+* Everything is 4-byte aligned, so readers can map the file and use the arrays directly.
+*/
+struct XrefHeader {
+    char magic[4];                  // "DSXR"
+    uint32_t version;
+    uint32_t targetCount;
+    uint32_t refCount;
+    uint32_t lineCount;
+    uint32_t symbolCount;
+    uint32_t nameBytes;
+    char program[8];                // Program name from the header record, padded with NULs.
+};
+
+struct XrefLine {
+    uint32_t address;
+    uint32_t line;                  // Line number in the lst listing, counting from 1.
+    uint8_t kind;                   // LineKind.
+    uint8_t mnemonic;
+    uint8_t length;
+    uint8_t reserved;
+};
+
+/**
+* Cross-reference index of a decoded program: for every target address, the instructions that
+* refer to it, grouped by XrefKind. The groups are held CSR-style in three flat arrays, so a
+* lookup is one binary search over the targets and the references come out as one range.
+*/
+class XrefIndex {
+public:
+    void clear();
+    void build(const Listing& listing);
+    bool write(const std::string& path, const Listing& listing, const SymbolIndex& symbols,
+               const std::string& program, std::string& error) const;
+
+    uint32_t size() const {                     // Distinct target addresses.
+        return m_targets.size();
+    }
+    uint32_t references() const {
+        return m_sources.size();
+    }
+    const uint32_t* find(uint32_t target, int kind, const uint32_t*& last) const;
+
+private:
+    void sort_keys();
+
+    MemVector<uint32_t, MEM_XREF> m_targets;    // Ascending, without duplicates.
+    MemVector<uint32_t, MEM_XREF> m_offsets;    // Start of each target's group of each kind in m_sources.
+    MemVector<uint32_t, MEM_XREF> m_sources;    // Referencing instruction addresses.
+    MemVector<uint64_t, MEM_XREF> m_keys;       // Scratch for build(): target, kind and source packed,
+    MemVector<uint64_t, MEM_XREF> m_sorted;     // the same keys sorted,
+    MemVector<uint32_t, MEM_XREF> m_counts;     // and a histogram of each digit of them.
+};
+
+/**
+* A cross-reference file opened for queries. The file is mapped, so opening it costs the same
+* whatever its size and each query only touches the pages it searches.
+*/
+class XrefFile {
+public:
+    bool open(const std::string& path, std::string& error);
+
+    std::string_view program() const;
+    bool resolve(std::string_view target, uint32_t& address) const;
+    const uint32_t* find(uint32_t target, int kind, const uint32_t*& last) const;
+    const XrefLine* line_at(uint32_t address) const;
+    std::string location(uint32_t address) const;
+
+private:
+    std::string_view name(uint32_t index) const;
+
+    InputFile m_input;
+    const XrefHeader* m_header = nullptr;
+    const uint32_t* m_targets;
+    const uint32_t* m_offsets;
+    const uint32_t* m_sources;
+    const XrefLine* m_lines;
+    const uint32_t* m_symAddrs;
+    const uint32_t* m_byName;
+    const uint32_t* m_nameOffsets;
+    const char* m_names;
+};
+
+int xref_kind(const ListingLine& line);
+bool run_query(const std::vector<std::string>& args, std::ostream& out, std::string& error);
+
+#endif